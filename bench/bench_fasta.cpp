@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/fasta.h"
+#include "bench_helpers.h"
+
+namespace {
+
+const std::string INPUT = "bench/.fasta_bench_input.fasta";
+
+/* The reader Msa used before FastaReader, kept here as the reference
+ * point: getline() on an ifstream, each line appended to a growing
+ * std::string copied on every line. */
+size_t read_with_getline(const std::string & fname)
+{
+	std::vector<std::string> seqs;
+	std::ifstream file(fname.c_str());
+	std::string s, tmp_seq;
+	bool in_record = false;
+	while (file.good()){
+		getline(file, s);
+		if (s[0] == '>'){
+			if (in_record){
+				seqs.push_back(tmp_seq);
+			}
+			in_record = true;
+			tmp_seq.clear();
+		} else {
+			tmp_seq = tmp_seq + s;
+		}
+	}
+	seqs.push_back(tmp_seq);
+	size_t total = 0;
+	for (const auto & seq : seqs){
+		total += seq.size();
+	}
+	return total;
+}
+
+/* The mapped reader, as Msa uses it: index, then copy every record in
+ * one preallocated buffer. */
+size_t read_with_mapping(const std::string & fname)
+{
+	MappedFile file(fname);
+	FastaReader reader(file, 1 << 30);
+	size_t total = 0;
+	for (int i = 0; i < reader.size(); ++i){
+		total += reader.getLength(i);
+	}
+	std::vector<char> residues(total);
+	size_t offset = 0;
+	for (int i = 0; i < reader.size(); ++i){
+		reader.copySequence(i, residues.data() + offset);
+		offset += reader.getLength(i);
+	}
+	return total;
+}
+
+template <typename F>
+void run(const std::string & name, F reader, size_t bytes, int reps)
+{
+	size_t residues = reader(INPUT); // warm the page cache
+	Timer timer;
+	for (int r = 0; r < reps; ++r){
+		residues = reader(INPUT);
+	}
+	double mb = static_cast<double>(bytes) * reps / (1024.0 * 1024.0);
+	report(name + " (" + std::to_string(residues) + " residues)", mb / timer.seconds(), "MB/s");
+}
+
+} // namespace
+
+/* Usage: bench_fasta [nseq [ncol [reps]]] (default 4000 x 3000, 3 reps) */
+int main(int argc, char ** argv)
+{
+	int nseq = argc > 1 ? std::atoi(argv[1]) : 4000;
+	int ncol = argc > 2 ? std::atoi(argv[2]) : 3000;
+	int reps = argc > 3 ? std::atoi(argv[3]) : 3;
+
+	size_t bytes = write_random_fasta(INPUT, nseq, ncol);
+	std::printf("FASTA parsing, %d x %d alignment, %.1f MB\n", nseq, ncol, bytes / (1024.0 * 1024.0));
+	run("getline reader", read_with_getline, bytes, reps);
+	run("mapped reader",  read_with_mapping, bytes, reps);
+	std::remove(INPUT.c_str());
+	return 0;
+}
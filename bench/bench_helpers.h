@@ -0,0 +1,136 @@
+/* Shared helpers for bench/bench_*.cpp.
+ *
+ * Same layout as tests/test_helpers.h: every bench/bench_XXX.cpp is a
+ * standalone binary (its own main()) built and run by `make bench`.
+ * Benchmarks build their input themselves from a fixed seed, so two
+ * runs on the same machine measure exactly the same work.
+ */
+
+#ifndef __BENCH_HELPERS_H__
+#define __BENCH_HELPERS_H__
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench_helpers {
+
+/* Wall-clock stopwatch, started on construction. */
+class Timer
+{
+	std::chrono::steady_clock::time_point start;
+public:
+	Timer() : start(std::chrono::steady_clock::now()) {}
+	double seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+
+/* Writes a random protein alignment of nseq sequences x ncol columns
+ * in multi-fasta format, sequences wrapped every `wrap` residues like
+ * most aligners do. Returns the size of the file in bytes. */
+inline size_t write_random_fasta(const std::string & path, int nseq, int ncol, int wrap = 60, unsigned seed = 42)
+{
+	static const char SYMBOLS[] = "ARNDCQEGHILKMFPSTWYV-";
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> pick(0, static_cast<int>(sizeof(SYMBOLS)) - 2);
+
+	std::ofstream file(path.c_str());
+	for (int i = 0; i < nseq; ++i) {
+		file << ">seq" << i << " synthetic sequence\n";
+		for (int j = 0; j < ncol; ++j) {
+			file << SYMBOLS[pick(rng)];
+			if ((j + 1) % wrap == 0 || j + 1 == ncol) {
+				file << "\n";
+			}
+		}
+	}
+	return static_cast<size_t>(file.tellp());
+}
+
+/* A synthetic alignment, see write_synthetic_fasta(). */
+struct SyntheticMsa
+{
+	int         nseq         = 1000;
+	int         ncol         = 1000;
+	std::string alphabet     = "protein";	/* "protein" (20 amino acids) or "dna" (ACGT) */
+	double      gap_rate     = 0.1;		/* Probability of a gap at each position */
+	double      conservation = 0.5;		/* Probability that a residue is the one of its column (see profile) */
+	std::string profile      = "flat";	/* "flat": every column has `conservation`;
+						 * "blocks": blocks of 20 columns, conserved ones
+						 * (`conservation`) between variable ones (0);
+						 * "gradient": from 0 at the first column up to
+						 * `conservation` at the last one */
+	unsigned    seed         = 42;
+
+	/* e.g. "protein 1000x1000 gap 0.1 flat 0.5" */
+	std::string name() const
+	{
+		char buffer[128];
+		std::snprintf(buffer, sizeof(buffer), "%s %dx%d gap %.2g %s %.2g", alphabet.c_str(), nseq, ncol, gap_rate, profile.c_str(), conservation);
+		return buffer;
+	}
+};
+
+/* Writes the synthetic alignment msa in multi-fasta format, sequences
+ * wrapped every 60 residues. Each column has its own residue, which a
+ * sequence has with the conservation of the column, or else a residue
+ * drawn at random; then a gap replaces it with probability gap_rate.
+ * Returns the size of the file in bytes. */
+inline size_t write_synthetic_fasta(const std::string & path, const SyntheticMsa & msa)
+{
+	const std::string symbols = msa.alphabet == "dna" ? "ACGT" : "ARNDCQEGHILKMFPSTWYV";
+	std::mt19937 rng(msa.seed);
+	std::uniform_int_distribution<int> pick(0, static_cast<int>(symbols.size()) - 1);
+	std::uniform_real_distribution<double> draw(0.0, 1.0);
+
+	std::vector<char> consensus(msa.ncol);
+	std::vector<double> conservation(msa.ncol);
+	for (int j = 0; j < msa.ncol; ++j) {
+		consensus[j] = symbols[pick(rng)];
+		if (msa.profile == "blocks") {
+			conservation[j] = (j / 20) % 2 ? msa.conservation : 0.0;
+		} else if (msa.profile == "gradient") {
+			conservation[j] = msa.ncol > 1 ? msa.conservation * j / (msa.ncol - 1) : msa.conservation;
+		} else {
+			conservation[j] = msa.conservation;
+		}
+	}
+
+	std::ofstream file(path.c_str());
+	std::string line;
+	for (int i = 0; i < msa.nseq; ++i) {
+		file << ">seq" << i << " synthetic sequence\n";
+		line.clear();
+		for (int j = 0; j < msa.ncol; ++j) {
+			char c = draw(rng) < conservation[j] ? consensus[j] : symbols[pick(rng)];
+			line += draw(rng) < msa.gap_rate ? '-' : c;
+			if ((j + 1) % 60 == 0 || j + 1 == msa.ncol) {
+				file << line << "\n";
+				line.clear();
+			}
+		}
+	}
+	return static_cast<size_t>(file.tellp());
+}
+
+/* One result line: "<name> <value> <unit>". */
+inline void report(const std::string & name, double value, const std::string & unit)
+{
+	std::printf("%-40s %12.2f %s\n", name.c_str(), value, unit.c_str());
+}
+
+} // namespace bench_helpers
+
+using bench_helpers::Timer;
+using bench_helpers::report;
+using bench_helpers::write_random_fasta;
+using bench_helpers::SyntheticMsa;
+using bench_helpers::write_synthetic_fasta;
+
+#endif
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../src/mi.h"
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "bench_helpers.h"
+
+namespace {
+
+const std::string INPUT  = "bench/.mi_bench_input.fasta";
+const std::string OUTPUT = "bench/.mi_bench_output.txt";
+
+void parse_options(int nseq, int threads)
+{
+	std::vector<std::string> args = {"bench_mi", "-i", INPUT, "-o", OUTPUT, "-s", "mi", "-n", std::to_string(nseq), "-j", std::to_string(threads)};
+	std::vector<char *> argv;
+	for (auto & arg : args){
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	Options::Parse(static_cast<int>(argv.size()), argv.data());
+}
+
+/* MI as it is usually first written, kept here as the reference point:
+ * the symbols of both columns looked up for every sequence, then the
+ * whole K x K joint table and its logarithms, pair after pair. */
+double naive_mi(Msa & msa, int x, int y)
+{
+	const std::string alphabet = msa.getAlphabet();
+	int K = static_cast<int>(alphabet.size());
+	const std::vector<float> & w = msa.getSeqWeights();
+	std::vector<double> px(K, 0.0), py(K, 0.0), pxy(K * K, 0.0);
+	for (int s = 0; s < msa.getNseq(); ++s){
+		int a = msa.getAaPos(msa.getSymbol(s, x));
+		int b = msa.getAaPos(msa.getSymbol(s, y));
+		px[a] += w[s];
+		py[b] += w[s];
+		pxy[a * K + b] += w[s];
+	}
+	double mi = 0.0;
+	for (int a = 0; a < K; ++a){
+		for (int b = 0; b < K; ++b){
+			if (pxy[a * K + b] > 0.0){
+				mi += pxy[a * K + b] * std::log(pxy[a * K + b] / (px[a] * py[b]));
+			}
+		}
+	}
+	return mi;
+}
+
+} // namespace
+
+/* Usage: bench_mi [nseq [ncol [threads]]] (default 1000 x 2000, 4 threads) */
+int main(int argc, char ** argv)
+{
+	int nseq    = argc > 1 ? std::atoi(argv[1]) : 1000;
+	int ncol    = argc > 2 ? std::atoi(argv[2]) : 2000;
+	int threads = argc > 3 ? std::atoi(argv[3]) : 4;
+
+	write_random_fasta(INPUT, nseq, ncol);
+	std::printf("Mutual information of every pair of columns, %d x %d alignment\n", nseq, ncol);
+	double pairs = 0.5 * ncol * (ncol - 1) / 1e6;
+
+	{
+		/* The pairs of the first columns only: the rate is what matters */
+		parse_options(nseq, 1);
+		Msa msa(INPUT);
+		int sub = std::min(ncol, 200);
+		double sum = 0.0;
+		Timer timer;
+		for (int x = 0; x < sub; ++x){
+			for (int y = x + 1; y < sub; ++y){
+				sum += naive_mi(msa, x, y);
+			}
+		}
+		double rate = 0.5 * sub * (sub - 1) / 1e6 / timer.seconds();
+		report("naive reference (sum " + std::to_string(static_cast<long>(sum)) + ")", rate, "M pairs/s");
+		report("  -> all the pairs", pairs / rate, "s");
+	}
+	for (int j : {1, threads}){
+		parse_options(nseq, j);
+		Msa msa(INPUT);
+		msa.getSeqWeights();
+		MIStat stat;
+		Timer timer;
+		stat.calculate(msa);
+		double seconds = timer.seconds();
+		report("MIStat -j " + std::to_string(j), pairs / seconds, "M pairs/s");
+		report("  -> all the pairs", seconds, "s");
+	}
+	std::remove(INPUT.c_str());
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/statistic.h"
+#include "bench_helpers.h"
+
+namespace {
+
+const std::string INPUT  = "bench/.output_bench_input.fasta";
+const std::string OUTPUT = "bench/.output_bench_output";
+
+void parse_options(const std::string & format)
+{
+	std::vector<std::string> args = {"bench_output", "-i", INPUT, "-o", OUTPUT, "-F", format};
+	std::vector<char *> argv;
+	for (auto & arg : args){
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	Options::Parse(static_cast<int>(argv.size()), argv.data());
+}
+
+/* A column statistic holding random scores, whatever the alignment */
+class RandomStat : public Stat1D
+{
+public:
+	explicit RandomStat(int ncol)
+	{
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> score(0.0f, 1.0f);
+		col_stat.resize(ncol);
+		for (float & x : col_stat){
+			x = score(rng);
+		}
+	}
+};
+
+/* Stat1D::write() as it was before TextWriter, kept here as the
+ * reference point: every number through the ofstream */
+void ofstream_write(const std::vector<float> & col_stat, const std::string & fname)
+{
+	std::ofstream file(fname.c_str());
+	for (int col(0); col < static_cast<int>(col_stat.size()); ++col){
+		file << col + 1 << "\t" << col_stat[col] << "\n";
+	}
+	file.close();
+}
+
+} // namespace
+
+/* Usage: bench_output [ncol] (default 1000000 columns) */
+int main(int argc, char ** argv)
+{
+	int ncol = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+	write_random_fasta(INPUT, 2, 10);
+	parse_options("text");
+	Msa msa(INPUT);
+	RandomStat stat(ncol);
+	std::printf("Writing the scores of %d columns\n", ncol);
+	double mcol = ncol / 1e6;
+	{
+		Timer timer;
+		ofstream_write(stat.getColStat(), OUTPUT);
+		report("ofstream reference", mcol / timer.seconds(), "M columns/s");
+	}
+	for (const std::string format : {"text", "bin"}){
+		parse_options(format);
+		Timer timer;
+		stat.write(msa, OUTPUT);
+		report("Stat1D::write --format " + format, mcol / timer.seconds(), "M columns/s");
+	}
+	std::remove(INPUT.c_str());
+	std::remove(OUTPUT.c_str());
+	return 0;
+}
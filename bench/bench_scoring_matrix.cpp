@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/scoring_matrix.h"
+#include "bench_helpers.h"
+
+namespace {
+
+const std::string MATRIX = "data/aaindex/HENS920102.mat";
+
+/* The lookup ScoringMatrix used before its byte tables, kept here as
+ * the reference point: alphabet.find() on both symbols, then the
+ * triangular matrix read with the larger index first. */
+class TriangularMatrix
+{
+	std::string alphabet;
+	std::vector<std::vector<float> > matrix;
+public:
+	explicit TriangularMatrix(const ScoringMatrix & sm) : alphabet(sm.getAlphabet())
+	{
+		for (int i = 0; i < static_cast<int>(alphabet.size()); ++i){
+			matrix.push_back(std::vector<float>(i + 1));
+			for (int j = 0; j <= i; ++j){
+				matrix[i][j] = sm.score(alphabet[i], alphabet[j]);
+			}
+		}
+	}
+	float score(char aa1, char aa2) const
+	{
+		int pos1 = static_cast<int>(alphabet.find(aa1));
+		int pos2 = static_cast<int>(alphabet.find(aa2));
+		return pos1 > pos2 ? matrix[pos1][pos2] : matrix[pos2][pos1];
+	}
+};
+
+template <typename F>
+void run(const std::string & name, F lookup, const std::vector<char> & pairs, int reps)
+{
+	float sum = 0.0f;
+	Timer timer;
+	for (int r = 0; r < reps; ++r){
+		for (size_t i = 0; i + 1 < pairs.size(); i += 2){
+			sum += lookup(pairs[i], pairs[i + 1]);
+		}
+	}
+	double lookups = static_cast<double>(pairs.size() / 2) * reps;
+	/* The sum is printed so that the lookups cannot be optimized away */
+	report(name + " (sum " + std::to_string(static_cast<long>(sum)) + ")", lookups / timer.seconds() / 1e6, "M lookups/s");
+}
+
+} // namespace
+
+/* Usage: bench_scoring_matrix [npairs [reps]] (default 1000000 pairs, 20 reps) */
+int main(int argc, char ** argv)
+{
+	int npairs = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	int reps   = argc > 2 ? std::atoi(argv[2]) : 20;
+
+	const ScoringMatrix & sm = ScoringMatrix::Get(MATRIX);
+	TriangularMatrix triangular(sm);
+	const std::string alphabet = sm.getAlphabet();
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> pick(0, static_cast<int>(alphabet.size()) - 1);
+	std::vector<char> pairs(2 * static_cast<size_t>(npairs));
+	for (char & c : pairs){
+		c = alphabet[pick(rng)];
+	}
+
+	std::printf("Scoring matrix lookups, %d random pairs of %s, %d reps\n", npairs, MATRIX.c_str(), reps);
+	run("alphabet.find + triangular matrix", [&](char a, char b){return triangular.score(a, b);}, pairs, reps);
+	run("checked score()", [&](char a, char b){return sm.score(a, b);}, pairs, reps);
+	run("lookupScore()", [&](char a, char b){return sm.lookupScore(a, b);}, pairs, reps);
+	run("lookupNormScore()", [&](char a, char b){return sm.lookupNormScore(a, b);}, pairs, reps);
+	return 0;
+}
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/profile.h"
+#include "../src/statistic.h"
+#include "bench_helpers.h"
+
+namespace {
+
+const std::string INPUT  = "bench/.suite_bench_input";	/* + the number of the scenario + ".fasta" */
+const std::string OUTPUT = "bench/.suite_bench_output.txt";
+
+/* Every column statistic, and mvector */
+const std::vector<std::string> STATISTICS = {"wentropy", "trident", "jensen", "kabat", "gap", "sumofpairs", "mvector"};
+
+/* The alignments measured: a reference one, then many sequences with
+ * conserved blocks, many columns with many gaps, and a DNA one */
+std::vector<SyntheticMsa> scenarios()
+{
+	std::vector<SyntheticMsa> list(4);
+	list[1].nseq = 4000;
+	list[1].profile = "blocks";
+	list[1].conservation = 0.9;
+	list[2].ncol = 4000;
+	list[2].gap_rate = 0.4;
+	list[2].conservation = 0.3;
+	list[3].alphabet = "dna";
+	list[3].nseq = 2000;
+	list[3].ncol = 4000;
+	list[3].gap_rate = 0.05;
+	list[3].profile = "gradient";
+	list[3].conservation = 0.9;
+	return list;
+}
+
+std::string input_fname(size_t scenario)
+{
+	return INPUT + std::to_string(scenario) + ".fasta";
+}
+
+void parse_options(const std::string & input, const SyntheticMsa & msa, int threads)
+{
+	std::vector<std::string> args = {"bench_suite", "-i", input, "-o", OUTPUT, "-n", std::to_string(msa.nseq), "-j", std::to_string(threads),
+	                                 "-m", msa.alphabet == "dna" ? "DNA" : "HENS920102"};
+	std::vector<char *> argv;
+	for (auto & arg : args){
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	Options::Parse(static_cast<int>(argv.size()), argv.data());
+}
+
+/* The phases of one run on the alignment, as --profile records them:
+ * reading and analysing it (and each pass of the analysis), the
+ * weights and the weighted counts, then calculating and writing each
+ * statistic. Milliseconds by phase. */
+std::vector<std::pair<std::string, double> > run_phases(const std::string & input, const SyntheticMsa & scenario, int threads)
+{
+	parse_options(input, scenario, threads);
+	Profiler::Get().enable();
+	{
+		Msa msa(input);
+		{
+			ProfileScope phase("weights");
+			msa.getSeqWeights();
+		}
+		{
+			ProfileScope phase("weighted counts");
+			msa.getWeightedCounts();
+		}
+		for (const std::string & name : STATISTICS){
+			std::unique_ptr<Statistic> stat(StatisticFactory::CreateByName(name));
+			{
+				ProfileScope phase("calculate " + name);
+				stat->calculate(msa);
+			}
+			ProfileScope phase("write " + name);
+			stat->write(msa, OUTPUT);
+		}
+	}
+	/* The top-level phases and the passes of the analysis; the
+	 * others (e.g. loading the matrix, once) are within them */
+	std::vector<std::pair<std::string, double> > phases;
+	for (const Profiler::Phase & phase : Profiler::Get().getPhases()){
+		if (phase.depth == 0 || phase.path.compare(0, 8, "analyse/") == 0){
+			phases.push_back(std::make_pair(phase.path, phase.wall * 1e3));
+		}
+	}
+	return phases;
+}
+
+/* Baseline file: one "<name>\t<milliseconds>" line per measurement */
+std::map<std::string, double> read_baseline(const std::string & path)
+{
+	std::map<std::string, double> baseline;
+	std::ifstream file(path.c_str());
+	std::string line;
+	while (std::getline(file, line)){
+		size_t tab = line.find('\t');
+		if (line.empty() || line[0] == '#' || tab == std::string::npos){
+			continue;
+		}
+		baseline[line.substr(0, tab)] = std::atof(line.c_str() + tab + 1);
+	}
+	return baseline;
+}
+
+void write_baseline(const std::string & path, const std::vector<std::pair<std::string, double> > & results)
+{
+	std::ofstream file(path.c_str());
+	file << "# bench_suite baseline: <scenario / phase> TAB <milliseconds>, see bench/bench_suite.cpp\n";
+	for (const auto & result : results){
+		char ms[32];
+		std::snprintf(ms, sizeof(ms), "%.3f", result.second);
+		file << result.first << "\t" << ms << "\n";
+	}
+}
+
+} // namespace
+
+/* Usage: bench_suite [--baseline FILE] [--save FILE] [--tolerance T] [--strict] [--threads J] [--repeat R]
+ *   --baseline  compare with the times of FILE: a phase slower by more
+ *               than T (default 0.25, i.e. 25%, and by 2 ms at least)
+ *               is flagged as a REGRESSION
+ *   --save      write the times measured in FILE, the next baseline
+ *   --strict    exit with status 1 if a regression was flagged
+ *   --threads   -j of the runs (default 1)
+ *   --repeat    runs of each scenario, the best time is kept (default 5);
+ *               the scenarios take turns, so that the runs of each one
+ *               are spread over the whole benchmark rather than all
+ *               caught in the same busy moment of the machine */
+int main(int argc, char ** argv)
+{
+	std::string baseline_path, save_path;
+	double tolerance = 0.25;
+	bool strict = false;
+	int threads = 1, repeat = 5;
+	for (int i = 1; i < argc; ++i){
+		std::string arg = argv[i];
+		if (arg == "--strict"){
+			strict = true;
+		} else if (i + 1 < argc && arg == "--baseline"){
+			baseline_path = argv[++i];
+		} else if (i + 1 < argc && arg == "--save"){
+			save_path = argv[++i];
+		} else if (i + 1 < argc && arg == "--tolerance"){
+			tolerance = std::atof(argv[++i]);
+		} else if (i + 1 < argc && arg == "--threads"){
+			threads = std::atoi(argv[++i]);
+		} else if (i + 1 < argc && arg == "--repeat"){
+			repeat = std::max(1, std::atoi(argv[++i]));
+		} else {
+			std::fprintf(stderr, "Unknown argument %s\n", arg.c_str());
+			return 2;
+		}
+	}
+
+	std::map<std::string, double> baseline;
+	if (!baseline_path.empty()){
+		baseline = read_baseline(baseline_path);
+		if (baseline.empty()){
+			std::printf("No baseline in %s: nothing to compare with\n", baseline_path.c_str());
+		}
+	}
+
+	AddAllStatistics();
+	std::vector<SyntheticMsa> msas = scenarios();
+	for (size_t i = 0; i < msas.size(); ++i){
+		write_synthetic_fasta(input_fname(i), msas[i]);
+	}
+	std::vector<std::vector<std::pair<std::string, double> > > best(msas.size());
+	for (int run = 0; run < repeat; ++run){
+		for (size_t i = 0; i < msas.size(); ++i){
+			std::vector<std::pair<std::string, double> > phases = run_phases(input_fname(i), msas[i], threads);
+			if (run == 0){
+				best[i] = phases;
+			}
+			for (size_t p = 0; p < best[i].size() && p < phases.size(); ++p){
+				best[i][p].second = std::min(best[i][p].second, phases[p].second);
+			}
+		}
+	}
+
+	std::vector<std::pair<std::string, double> > results;
+	int regressions = 0;
+	for (size_t i = 0; i < msas.size(); ++i){
+		std::printf("%s, -j %d, best of %d\n", msas[i].name().c_str(), threads, repeat);
+		double residues = static_cast<double>(msas[i].nseq) * msas[i].ncol / 1e6;
+		for (const auto & phase : best[i]){
+			std::string name = msas[i].name() + " / " + phase.first;
+			results.push_back(std::make_pair(name, phase.second));
+			double rate = phase.second > 0.0 ? residues / (phase.second / 1e3) : 0.0;
+			std::printf("  %-24s %10.3f ms %12.1f M residues/s", phase.first.c_str(), phase.second, rate);
+			auto base = baseline.find(name);
+			if (base != baseline.end() && base->second > 0.0){
+				double change = phase.second / base->second - 1.0;
+				bool regression = change > tolerance && phase.second - base->second > 2.0;
+				std::printf("  %+7.1f%% vs baseline%s", 100.0 * change, regression ? "  REGRESSION" : "");
+				regressions += regression;
+			}
+			std::printf("\n");
+		}
+		std::remove(input_fname(i).c_str());
+	}
+	if (!baseline.empty()){
+		std::printf("%d regression%s beyond %.0f%% of %s\n", regressions, regressions != 1 ? "s" : "", 100.0 * tolerance, baseline_path.c_str());
+	}
+	if (!save_path.empty()){
+		write_baseline(save_path, results);
+		std::printf("Times written in %s\n", save_path.c_str());
+	}
+	std::remove(OUTPUT.c_str());
+	return strict && regressions > 0 ? 1 : 0;
+}
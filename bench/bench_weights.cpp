@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "bench_helpers.h"
+
+namespace {
+
+const std::string INPUT = "bench/.weights_bench_input.fasta";
+
+void parse_options(int nseq, int threads, const std::string & weights = "henikoff")
+{
+	std::vector<std::string> args = {"bench_weights", "-i", INPUT, "-n", std::to_string(nseq), "-j", std::to_string(threads), "-W", weights};
+	std::vector<char *> argv;
+	for (auto & arg : args){
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	Options::Parse(static_cast<int>(argv.size()), argv.data());
+}
+
+/* The weights as Msa computed them before, kept here as the reference
+ * point: one thread, a float sum, and getAaPos() on every symbol. */
+std::vector<float> serial_weights(Msa & msa)
+{
+	int nseq = msa.getNseq();
+	int K = static_cast<int>(msa.getAlphabet().size());
+	const std::vector<int> & counts = msa.getCounts();
+	std::vector<float> weights(nseq, 0.0f);
+	for (int col = 0; col < msa.getNcol(); ++col){
+		for (int seq = 0; seq < nseq; ++seq){
+			int n = counts[static_cast<size_t>(col) * K + msa.getAaPos(msa.getSymbol(seq, col))];
+			weights[seq] += 1.0 / (float) (n * msa.getNtype(col));
+		}
+	}
+	for (float & w : weights){
+		w /= static_cast<float>(msa.getNcol());
+	}
+	return weights;
+}
+
+/* The identity weights on each code path, the scalar one being the
+ * reference point: the rate is in sequence pairs compared per second */
+void bench_identity(int nseq, int threads)
+{
+	std::printf("Identity weights, first %d sequences\n", nseq);
+	double pairs = static_cast<double>(nseq) * (nseq - 1) / 2 / 1e6;
+	float reference = 0.0f;
+	for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2}){
+		for (int j : {1, threads}){
+			if (level != SimdLevel::AVX2 && j != 1){
+				continue;
+			}
+			parse_options(nseq, j, "identity");
+			Msa msa(INPUT);
+			msa.setSimdLevel(level);
+			Timer timer;
+			float neff = msa.getNeff();
+			double rate = pairs / timer.seconds();
+			if (level == SimdLevel::Scalar){
+				reference = neff;
+			}
+			const char * name = level == SimdLevel::Scalar ? "scalar" : level == SimdLevel::SSE ? "SSE2" : "AVX2";
+			report(std::string(name) + " -j " + std::to_string(j) + (neff == reference ? " (same Neff)" : " (Neff DIFFERS)"), rate, "M pairs/s");
+		}
+	}
+}
+
+} // namespace
+
+/* Usage: bench_weights [nseq [ncol [threads [identity_nseq]]]] (default 20000 x 2000, 4 threads, 4000) */
+int main(int argc, char ** argv)
+{
+	int nseq    = argc > 1 ? std::atoi(argv[1]) : 20000;
+	int ncol    = argc > 2 ? std::atoi(argv[2]) : 2000;
+	int threads = argc > 3 ? std::atoi(argv[3]) : 4;
+	int identity_nseq = argc > 4 ? std::atoi(argv[4]) : 4000;
+
+	write_random_fasta(INPUT, nseq, ncol);
+	std::printf("Henikoff sequence weights, %d x %d alignment\n", nseq, ncol);
+	parse_options(nseq, 1);
+	double cells = static_cast<double>(nseq) * ncol / 1e6;
+
+	std::vector<float> reference;
+	{
+		Msa msa(INPUT);
+		msa.getCounts();
+		Timer timer;
+		reference = serial_weights(msa);
+		report("serial float reference", cells / timer.seconds(), "M residues/s");
+	}
+	for (int j : {1, threads}){
+		parse_options(nseq, j);
+		Msa msa(INPUT);
+		msa.getCounts();
+		Timer timer;
+		const std::vector<float> & weights = msa.getSeqWeights();
+		double rate = cells / timer.seconds();
+		float largest = 0.0f;
+		for (int seq = 0; seq < nseq; ++seq){
+			largest = std::max(largest, std::fabs(weights[seq] - reference[seq]) / reference[seq]);
+		}
+		report("getSeqWeights() -j " + std::to_string(j) + " (rel. diff " + std::to_string(largest) + ")", rate, "M residues/s");
+	}
+	bench_identity(std::min(nseq, identity_nseq), threads);
+	std::remove(INPUT.c_str());
+	return 0;
+}
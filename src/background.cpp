@@ -1,6 +1,8 @@
 #include "background.h"
 
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 
@@ -101,6 +103,19 @@ BackgroundDistribution :: BackgroundDistribution(const std::string & spec)
 	}
 }
 
+const BackgroundDistribution &
+BackgroundDistribution :: Get(const std::string & spec)
+{
+	static std::mutex mtx;
+	static std::map<std::string, std::unique_ptr<BackgroundDistribution> > distributions;
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = distributions.find(spec);
+	if (it == distributions.end()){
+		it = distributions.emplace(spec, std::make_unique<BackgroundDistribution>(spec)).first;
+	}
+	return *it->second;
+}
+
 float
 BackgroundDistribution :: getFreq(char aa) const
 {
@@ -44,6 +44,14 @@ public:
 	 */
 	explicit BackgroundDistribution(const std::string & spec);
 
+	/**
+	 * Returns the distribution of spec, built on the first call only
+	 * and then shared read-only by every statistic (and thread) of the
+	 * process, so a batch does not re-read a background file for each
+	 * alignment.
+	 */
+	static const BackgroundDistribution & Get(const std::string & spec);
+
 	/**
 	 * Returns the background frequency of amino acid aa.
 	 * Throws std::runtime_error if aa isn't covered by this
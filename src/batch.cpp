@@ -0,0 +1,233 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+#include "batch.h"
+#include "msa.h"
+#include "options.h"
+#include "profile.h"
+#include "sampling.h"
+#include "statistic.h"
+#include "thread_pool.h"
+
+namespace fs = std::filesystem;
+
+
+/**************************************************************
+ * BatchScheduler deals the jobs, sorted by decreasing size,
+ * to the workers in turn: worker 0 gets the largest job,
+ * worker 1 the second one... Ties keep the input order.
+ **************************************************************/
+BatchScheduler :: BatchScheduler(const std::vector<uintmax_t> & sizes, int nworkers) : queues(std::max(1, nworkers))
+{
+	std::vector<int> order(sizes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sizes](int a, int b){
+		return sizes[a] > sizes[b];
+	});
+	for (size_t i(0); i < order.size(); ++i){
+		queues[i % queues.size()].jobs.push_back(order[i]);
+	}
+}
+
+/**************************************************************
+ * next() takes the largest job left in the worker's own
+ * deque, or else steals the largest job left in the deque
+ * of another worker, looking at them from the next worker on.
+ **************************************************************/
+bool
+BatchScheduler :: next(int worker, int & job)
+{
+	int n = static_cast<int>(queues.size());
+	for (int i(0); i < n; ++i){
+		WorkerQueue & queue = queues[(worker + i) % n];
+		std::lock_guard<std::mutex> lock(queue.mtx);
+		if (!queue.jobs.empty()){
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/**************************************************************
+ * ReadBatchInputs
+ **************************************************************/
+std::vector<std::string>
+ReadBatchInputs(const std::string & spec)
+{
+	std::vector<std::string> inputs;
+	std::error_code ec;
+	if (fs::is_directory(spec, ec)){
+		for (const fs::directory_entry & entry : fs::directory_iterator(spec)){
+			if (entry.is_regular_file() && !Msa::IsCacheName(entry.path().string())){
+				inputs.push_back(entry.path().string());
+			}
+		}
+		std::sort(inputs.begin(), inputs.end());
+	} else {
+		std::ifstream file(spec.c_str());
+		if (!file.is_open()){
+			throw std::runtime_error("Cannot open file " + spec);
+		}
+		std::string line;
+		while (std::getline(file, line)){
+			/* Trim the blanks (and the '\r' of Windows files) around the path */
+			std::string::size_type first = line.find_first_not_of(" \t\r");
+			if (first == std::string::npos || line[first] == '#'){
+				continue;
+			}
+			std::string::size_type last = line.find_last_not_of(" \t\r");
+			inputs.push_back(line.substr(first, last - first + 1));
+		}
+	}
+	if (inputs.empty()){
+		throw std::runtime_error("No input file found in " + spec);
+	}
+	return inputs;
+}
+
+
+namespace {
+
+/* Computes the statistics of -s on one alignment, as main() does
+ * for a single input, and records what happened in result. */
+void process(BatchResult & result)
+{
+	auto start = std::chrono::steady_clock::now();
+	TraceScope span("alignment", "alignment");
+	span.arg("file", result.input);
+	try {
+		const std::vector<std::string> & names = Options::Get().statistics;
+		std::vector<std::unique_ptr<Statistic> > stats;
+		for (const std::string & name : names){
+			stats.push_back(std::unique_ptr<Statistic>(StatisticFactory::CreateByName(name)));
+		}
+		std::unique_ptr<Msa> msa;
+		if (Options::Get().tolerance > 0.0){
+			msa = SampleAndCalculate(result.input, stats);
+		} else {
+			msa.reset(new Msa(result.input));
+			for (size_t s(0); s < stats.size(); ++s){
+				ProfileScope phase("calculate " + names[s]);
+				stats[s]->calculate(*msa);
+			}
+		}
+		result.nseq = msa->getNseq();
+		result.ncol = msa->getNcol();
+		Profiler::Get().addAlignment(result.nseq, result.ncol);
+		PrintStatistics(*msa, names, stats, result.output);
+	} catch (std::exception & e) {
+		result.error = e.what();
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Error messages may end with (or contain) a newline: the
+ * summary keeps one line per input */
+std::string one_line(std::string message)
+{
+	std::replace(message.begin(), message.end(), '\n', ' ');
+	std::string::size_type last = message.find_last_not_of(' ');
+	return message.substr(0, last == std::string::npos ? 0 : last + 1);
+}
+
+} // namespace
+
+
+/**************************************************************
+ * RunBatch starts -j/--threads workers on the thread pool:
+ * each one processes alignments until the scheduler has none
+ * left. Running inside the pool, the column loops of the
+ * statistics stay in their worker (see ThreadPool).
+ **************************************************************/
+std::vector<BatchResult>
+RunBatch(const std::vector<std::string> & inputs, const std::string & out_dir)
+{
+	fs::create_directories(out_dir);
+
+	/* One output per input, named after it: two inputs with the same
+	 * name would overwrite each other. The extension is that of -F
+	 * (.txt, .bin or .npy), and so is the one of the derived files
+	 * (e.g. PF00001.mvector.npy) */
+	const std::string extension = Options::Get().format == "text" ? ".txt" : "." + Options::Get().format;
+	std::map<std::string, std::string> outputs;
+	std::vector<BatchResult> results(inputs.size());
+	std::vector<uintmax_t> sizes(inputs.size(), 0);
+	for (size_t i(0); i < inputs.size(); ++i){
+		std::string output = (fs::path(out_dir) / fs::path(inputs[i]).stem()).string() + extension;
+		auto known = outputs.emplace(output, inputs[i]);
+		if (!known.second){
+			throw std::runtime_error("Inputs " + known.first->second + " and " + inputs[i] + " would both be written in " + output);
+		}
+		results[i].input   = inputs[i];
+		results[i].output  = output;
+		std::error_code ec;
+		uintmax_t size = fs::file_size(inputs[i], ec);
+		sizes[i] = ec ? 0 : size;
+		results[i].bytes   = sizes[i];
+		results[i].nseq    = 0;
+		results[i].ncol    = 0;
+		results[i].seconds = 0.0;
+	}
+
+	int nworkers = std::min(Options::Get().threads, static_cast<int>(inputs.size()));
+	BatchScheduler scheduler(sizes, nworkers);
+	ThreadPool::Get().parallelFor(0, nworkers, nworkers, [&](int worker_begin, int worker_end){
+		for (int worker(worker_begin); worker < worker_end; ++worker){
+			int job;
+			while (scheduler.next(worker, job)){
+				process(results[job]);
+			}
+		}
+	});
+	return results;
+}
+
+
+/**************************************************************
+ * WriteBatchSummary
+ **************************************************************/
+void
+WriteBatchSummary(const std::vector<BatchResult> & results, const std::string & fname)
+{
+	std::ofstream file(fname.c_str());
+	if (!file.is_open()){
+		throw std::runtime_error("Cannot open file " + fname);
+	}
+	file << "#input\toutput\tbytes\tnb_seq\tnb_col\tseconds\tstatus\n";
+	for (const BatchResult & result : results){
+		file << result.input << "\t" << result.output << "\t" << result.bytes << "\t"
+		     << result.nseq << "\t" << result.ncol << "\t" << result.seconds << "\t"
+		     << (result.error.empty() ? "ok" : "error: " + one_line(result.error)) << "\n";
+	}
+	file.close();
+}
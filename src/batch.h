@@ -0,0 +1,86 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Batch mode (-B/--batch): the statistics of -s are computed on many
+ * alignments in one process. The options, the scoring matrix and the
+ * background distribution are read once and shared (read-only) by all
+ * the alignments, see ScoringMatrix::Get() and BackgroundDistribution::Get().
+ *
+ * The alignments are processed by -j/--threads workers at the same
+ * time, each alignment by a single worker (the column loops of its
+ * statistics then run in that worker only).
+ */
+
+/** Result of one alignment of a batch */
+struct BatchResult
+{
+	std::string input;        /**< Alignment file */
+	std::string output;       /**< Output file of its statistics */
+	uintmax_t   bytes;        /**< Size of the alignment file */
+	int         nseq;         /**< Number of sequences read */
+	int         ncol;         /**< Number of columns */
+	double      seconds;      /**< Wall-clock time spent on this alignment */
+	std::string error;        /**< Why the alignment failed (empty if it did not) */
+};
+
+/**
+ * BatchScheduler hands out jobs (indices) to workers, largest jobs
+ * first. Jobs are dealt in decreasing size to one deque per worker;
+ * a worker takes the front of its own deque, and when it is empty,
+ * steals the front (the largest job left) of another worker's deque.
+ */
+class BatchScheduler
+{
+protected:
+	struct WorkerQueue {
+		std::mutex      mtx;
+		std::deque<int> jobs;
+	};
+	std::vector<WorkerQueue> queues;
+
+public:
+	BatchScheduler(const std::vector<uintmax_t> & sizes, int nworkers);
+	bool next(int worker, int & job);		/**< Give the next job of worker, false when there is none left */
+};
+
+/** Input files of a batch. spec is either a directory (all its regular
+ *  files, in name order, but the .msx caches of -C) or a manifest file
+ *  (one path per line; empty lines and lines starting with '#' are
+ *  ignored). */
+std::vector<std::string> ReadBatchInputs(const std::string & spec);
+
+/** Compute and print the statistics of -s on every input, writing the
+ *  results of an input "dir/name.ext" in "out_dir/name.txt". Failures
+ *  are recorded in the results, in input order, not thrown. */
+std::vector<BatchResult> RunBatch(const std::vector<std::string> & inputs, const std::string & out_dir);
+
+/** Print the per-file timings of a batch in fname: a '#' header, then
+ *  one tab-separated line per input, in input order. */
+void WriteBatchSummary(const std::vector<BatchResult> & results, const std::string & fname);
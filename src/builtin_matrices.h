@@ -0,0 +1,179 @@
+/* Copyright (c) 2012 Guillaume Collet
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE. 
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+
+/* The substitution matrices built in mstatx, selected by name with -m
+ * (e.g. "-m HENS920102") instead of a file name: a run using them reads
+ * no file, and does not depend on the data directory being installed.
+ * Each one is a verbatim copy of the bundled file it comes from.
+ *
+ * The alphabet size K is a template parameter, so that the matrices
+ * (and the kernels using them, see ScoringMatrix::Stride()) are known
+ * at compile time.
+ */
+template <int K>
+struct BuiltinMatrix
+{
+	const char * name;                        /**< Name given to -m */
+	const char * alphabet;                    /**< The K symbols, in the order of the rows */
+	std::array<float, K * (K + 1) / 2> values; /**< Lower triangle, row by row, like in the AAindex files */
+};
+
+/* BLOSUM45 substitution matrix (Henikoff-Henikoff, 1992), from data/aaindex/HENS920101.mat */
+constexpr BuiltinMatrix<20> MATRIX_HENS920101 = {"HENS920101", "ARNDCQEGHILKMFPSTWYV", {{
+	  5.0f,
+	 -2.0f,  7.0f,
+	 -1.0f,  0.0f,  6.0f,
+	 -2.0f, -1.0f,  2.0f,  7.0f,
+	 -1.0f, -3.0f, -2.0f, -3.0f, 12.0f,
+	 -1.0f,  1.0f,  0.0f,  0.0f, -3.0f,  6.0f,
+	 -1.0f,  0.0f,  0.0f,  2.0f, -3.0f,  2.0f,  6.0f,
+	  0.0f, -2.0f,  0.0f, -1.0f, -3.0f, -2.0f, -2.0f,  7.0f,
+	 -2.0f,  0.0f,  1.0f,  0.0f, -3.0f,  1.0f,  0.0f, -2.0f, 10.0f,
+	 -1.0f, -3.0f, -2.0f, -4.0f, -3.0f, -2.0f, -3.0f, -4.0f, -3.0f,  5.0f,
+	 -1.0f, -2.0f, -3.0f, -3.0f, -2.0f, -2.0f, -2.0f, -3.0f, -2.0f,  2.0f,  5.0f,
+	 -1.0f,  3.0f,  0.0f,  0.0f, -3.0f,  1.0f,  1.0f, -2.0f, -1.0f, -3.0f, -3.0f,  5.0f,
+	 -1.0f, -1.0f, -2.0f, -3.0f, -2.0f,  0.0f, -2.0f, -2.0f,  0.0f,  2.0f,  2.0f, -1.0f,  6.0f,
+	 -2.0f, -2.0f, -2.0f, -4.0f, -2.0f, -4.0f, -3.0f, -3.0f, -2.0f,  0.0f,  1.0f, -3.0f,  0.0f,  8.0f,
+	 -1.0f, -2.0f, -2.0f, -1.0f, -4.0f, -1.0f,  0.0f, -2.0f, -2.0f, -2.0f, -3.0f, -1.0f, -2.0f, -3.0f,  9.0f,
+	  1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f, -1.0f, -2.0f, -3.0f, -1.0f, -2.0f, -2.0f, -1.0f,  4.0f,
+	  0.0f, -1.0f,  0.0f, -1.0f, -1.0f, -1.0f, -1.0f, -2.0f, -2.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f,  2.0f,  5.0f,
+	 -2.0f, -2.0f, -4.0f, -4.0f, -5.0f, -2.0f, -3.0f, -2.0f, -3.0f, -2.0f, -2.0f, -2.0f, -2.0f,  1.0f, -3.0f, -4.0f, -3.0f, 15.0f,
+	 -2.0f, -1.0f, -2.0f, -2.0f, -3.0f, -1.0f, -2.0f, -3.0f,  2.0f,  0.0f,  0.0f, -1.0f,  0.0f,  3.0f, -3.0f, -2.0f, -1.0f,  3.0f,  8.0f,
+	  0.0f, -2.0f, -3.0f, -3.0f, -1.0f, -3.0f, -3.0f, -3.0f, -3.0f,  3.0f,  1.0f, -2.0f,  1.0f,  0.0f, -3.0f, -1.0f,  0.0f, -3.0f, -1.0f,  5.0f
+}}};
+
+/* BLOSUM62 substitution matrix (Henikoff-Henikoff, 1992), from data/aaindex/HENS920102.mat */
+constexpr BuiltinMatrix<20> MATRIX_HENS920102 = {"HENS920102", "ARNDCQEGHILKMFPSTWYV", {{
+	  6.0f,
+	 -2.0f,  8.0f,
+	 -2.0f, -1.0f,  8.0f,
+	 -3.0f, -2.0f,  2.0f,  9.0f,
+	 -1.0f, -5.0f, -4.0f, -5.0f, 13.0f,
+	 -1.0f,  1.0f,  0.0f,  0.0f, -4.0f,  8.0f,
+	 -1.0f,  0.0f,  0.0f,  2.0f, -5.0f,  3.0f,  7.0f,
+	  0.0f, -3.0f, -1.0f, -2.0f, -4.0f, -3.0f, -3.0f,  8.0f,
+	 -2.0f,  0.0f,  1.0f, -2.0f, -4.0f,  1.0f,  0.0f, -3.0f, 11.0f,
+	 -2.0f, -4.0f, -5.0f, -5.0f, -2.0f, -4.0f, -5.0f, -6.0f, -5.0f,  6.0f,
+	 -2.0f, -3.0f, -5.0f, -5.0f, -2.0f, -3.0f, -4.0f, -5.0f, -4.0f,  2.0f,  6.0f,
+	 -1.0f,  3.0f,  0.0f, -1.0f, -5.0f,  2.0f,  1.0f, -2.0f, -1.0f, -4.0f, -4.0f,  7.0f,
+	 -1.0f, -2.0f, -3.0f, -5.0f, -2.0f, -1.0f, -3.0f, -4.0f, -2.0f,  2.0f,  3.0f, -2.0f,  8.0f,
+	 -3.0f, -4.0f, -4.0f, -5.0f, -4.0f, -5.0f, -5.0f, -5.0f, -2.0f,  0.0f,  1.0f, -5.0f,  0.0f,  9.0f,
+	 -1.0f, -3.0f, -3.0f, -2.0f, -4.0f, -2.0f, -2.0f, -3.0f, -3.0f, -4.0f, -4.0f, -2.0f, -4.0f, -5.0f, 11.0f,
+	  2.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f, -1.0f, -4.0f, -4.0f,  0.0f, -2.0f, -4.0f, -1.0f,  6.0f,
+	  0.0f, -2.0f,  0.0f, -2.0f, -1.0f, -1.0f, -1.0f, -2.0f, -3.0f, -1.0f, -2.0f, -1.0f, -1.0f, -3.0f, -2.0f,  2.0f,  7.0f,
+	 -4.0f, -4.0f, -6.0f, -6.0f, -3.0f, -3.0f, -4.0f, -4.0f, -4.0f, -4.0f, -2.0f, -4.0f, -2.0f,  1.0f, -5.0f, -4.0f, -4.0f, 16.0f,
+	 -3.0f, -3.0f, -3.0f, -5.0f, -4.0f, -2.0f, -3.0f, -5.0f,  3.0f, -2.0f, -2.0f, -3.0f, -1.0f,  4.0f, -4.0f, -3.0f, -2.0f,  3.0f, 10.0f,
+	  0.0f, -4.0f, -4.0f, -5.0f, -1.0f, -3.0f, -4.0f, -5.0f, -5.0f,  4.0f,  1.0f, -3.0f,  1.0f, -1.0f, -4.0f, -2.0f,  0.0f, -4.0f, -2.0f,  6.0f
+}}};
+
+/* BLOSUM80 substitution matrix (Henikoff-Henikoff, 1992), from data/aaindex/HENS920103.mat */
+constexpr BuiltinMatrix<20> MATRIX_HENS920103 = {"HENS920103", "ARNDCQEGHILKMFPSTWYV", {{
+	  7.0f,
+	 -3.0f,  9.0f,
+	 -3.0f, -1.0f,  9.0f,
+	 -3.0f, -3.0f,  2.0f, 10.0f,
+	 -1.0f, -6.0f, -5.0f, -7.0f, 13.0f,
+	 -2.0f,  1.0f,  0.0f, -1.0f, -5.0f,  9.0f,
+	 -2.0f, -1.0f, -1.0f,  2.0f, -7.0f,  3.0f,  8.0f,
+	  0.0f, -4.0f, -1.0f, -3.0f, -6.0f, -4.0f, -4.0f,  9.0f,
+	 -3.0f,  0.0f,  1.0f, -2.0f, -7.0f,  1.0f,  0.0f, -4.0f, 12.0f,
+	 -3.0f, -5.0f, -6.0f, -7.0f, -2.0f, -5.0f, -6.0f, -7.0f, -6.0f,  7.0f,
+	 -3.0f, -4.0f, -6.0f, -7.0f, -3.0f, -4.0f, -6.0f, -7.0f, -5.0f,  2.0f,  6.0f,
+	 -1.0f,  3.0f,  0.0f, -2.0f, -6.0f,  2.0f,  1.0f, -3.0f, -1.0f, -5.0f, -4.0f,  8.0f,
+	 -2.0f, -3.0f, -4.0f, -6.0f, -3.0f, -1.0f, -4.0f, -5.0f, -4.0f,  2.0f,  3.0f, -3.0f,  9.0f,
+	 -4.0f, -5.0f, -6.0f, -6.0f, -4.0f, -5.0f, -6.0f, -6.0f, -2.0f, -1.0f,  0.0f, -5.0f,  0.0f, 10.0f,
+	 -1.0f, -3.0f, -4.0f, -3.0f, -6.0f, -3.0f, -2.0f, -5.0f, -4.0f, -5.0f, -5.0f, -2.0f, -4.0f, -6.0f, 12.0f,
+	  2.0f, -2.0f,  1.0f, -1.0f, -2.0f, -1.0f, -1.0f, -1.0f, -2.0f, -4.0f, -4.0f, -1.0f, -3.0f, -4.0f, -2.0f,  7.0f,
+	  0.0f, -2.0f,  0.0f, -2.0f, -2.0f, -1.0f, -2.0f, -3.0f, -3.0f, -2.0f, -3.0f, -1.0f, -1.0f, -4.0f, -3.0f,  2.0f,  8.0f,
+	 -5.0f, -5.0f, -7.0f, -8.0f, -5.0f, -4.0f, -6.0f, -6.0f, -4.0f, -5.0f, -4.0f, -6.0f, -3.0f,  0.0f, -7.0f, -6.0f, -5.0f, 16.0f,
+	 -4.0f, -4.0f, -4.0f, -6.0f, -5.0f, -3.0f, -5.0f, -6.0f,  3.0f, -3.0f, -2.0f, -4.0f, -3.0f,  4.0f, -6.0f, -3.0f, -3.0f,  3.0f, 11.0f,
+	 -1.0f, -4.0f, -5.0f, -6.0f, -2.0f, -4.0f, -4.0f, -6.0f, -5.0f,  4.0f,  1.0f, -4.0f,  1.0f, -2.0f, -4.0f, -3.0f,  0.0f, -5.0f, -3.0f,  7.0f
+}}};
+
+/* BLOSUM50 substitution matrix (Henikoff-Henikoff, 1992), from data/aaindex/HENS920104.mat */
+constexpr BuiltinMatrix<20> MATRIX_HENS920104 = {"HENS920104", "ARNDCQEGHILKMFPSTWYV", {{
+	  5.0f,
+	 -2.0f,  7.0f,
+	 -1.0f, -1.0f,  7.0f,
+	 -2.0f, -2.0f,  2.0f,  8.0f,
+	 -1.0f, -4.0f, -2.0f, -4.0f, 13.0f,
+	 -1.0f,  1.0f,  0.0f,  0.0f, -3.0f,  7.0f,
+	 -1.0f,  0.0f,  0.0f,  2.0f, -3.0f,  2.0f,  6.0f,
+	  0.0f, -3.0f,  0.0f, -1.0f, -3.0f, -2.0f, -3.0f,  8.0f,
+	 -2.0f,  0.0f,  1.0f, -1.0f, -3.0f,  1.0f,  0.0f, -2.0f, 10.0f,
+	 -1.0f, -4.0f, -3.0f, -4.0f, -2.0f, -3.0f, -4.0f, -4.0f, -4.0f,  5.0f,
+	 -2.0f, -3.0f, -4.0f, -4.0f, -2.0f, -2.0f, -3.0f, -4.0f, -3.0f,  2.0f,  5.0f,
+	 -1.0f,  3.0f,  0.0f, -1.0f, -3.0f,  2.0f,  1.0f, -2.0f,  0.0f, -3.0f, -3.0f,  6.0f,
+	 -1.0f, -2.0f, -2.0f, -4.0f, -2.0f,  0.0f, -2.0f, -3.0f, -1.0f,  2.0f,  3.0f, -2.0f,  7.0f,
+	 -3.0f, -3.0f, -4.0f, -5.0f, -2.0f, -4.0f, -3.0f, -4.0f, -1.0f,  0.0f,  1.0f, -4.0f,  0.0f,  8.0f,
+	 -1.0f, -3.0f, -2.0f, -1.0f, -4.0f, -1.0f, -1.0f, -2.0f, -2.0f, -3.0f, -4.0f, -1.0f, -3.0f, -4.0f, 10.0f,
+	  1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, -1.0f,  0.0f, -1.0f, -3.0f, -3.0f,  0.0f, -2.0f, -3.0f, -1.0f,  5.0f,
+	  0.0f, -1.0f,  0.0f, -1.0f, -1.0f, -1.0f, -1.0f, -2.0f, -2.0f, -1.0f, -1.0f, -1.0f, -1.0f, -2.0f, -1.0f,  2.0f,  5.0f,
+	 -3.0f, -3.0f, -4.0f, -5.0f, -5.0f, -1.0f, -3.0f, -3.0f, -3.0f, -3.0f, -2.0f, -3.0f, -1.0f,  1.0f, -4.0f, -4.0f, -3.0f, 15.0f,
+	 -2.0f, -1.0f, -2.0f, -3.0f, -3.0f, -1.0f, -2.0f, -3.0f,  2.0f, -1.0f, -1.0f, -2.0f,  0.0f,  4.0f, -3.0f, -2.0f, -2.0f,  2.0f,  8.0f,
+	  0.0f, -3.0f, -3.0f, -4.0f, -1.0f, -3.0f, -3.0f, -4.0f, -4.0f,  4.0f,  1.0f, -3.0f,  1.0f, -1.0f, -3.0f, -2.0f,  0.0f, -3.0f, -1.0f,  5.0f
+}}};
+
+/* DNA matrix by Lee Katz, from data/DNA.mat */
+constexpr BuiltinMatrix<6> MATRIX_DNA = {"DNA", "ATCGN-", {{
+	  2.0f,
+	 -1.0f,  2.0f,
+	 -1.0f, -1.0f,  2.0f,
+	 -1.0f, -1.0f, -1.0f,  2.0f,
+	 -1.0f, -1.0f, -1.0f, -1.0f, -2.0f,
+	 -2.0f, -2.0f, -2.0f, -2.0f, -2.0f, -2.0f
+}}};
+
+/* RNA matrix by Mobarak Saif (copy from Lee Katz dna.mat), from data/RNA.mat */
+constexpr BuiltinMatrix<6> MATRIX_RNA = {"RNA", "AUCGN-", {{
+	  2.0f,
+	 -1.0f,  2.0f,
+	 -1.0f, -1.0f,  2.0f,
+	 -1.0f, -1.0f, -1.0f,  2.0f,
+	 -1.0f, -1.0f, -1.0f, -1.0f, -2.0f,
+	 -2.0f, -2.0f, -2.0f, -2.0f, -2.0f, -2.0f
+}}};
+
+/** ForBuiltinMatrix(name, f) calls f(matrix) with the built-in matrix
+ *  of that name, and returns false if there is none
+ */
+template <typename F>
+bool ForBuiltinMatrix(const std::string & name, F f)
+{
+	if (name == MATRIX_HENS920101.name) {f(MATRIX_HENS920101); return true;}
+	if (name == MATRIX_HENS920102.name) {f(MATRIX_HENS920102); return true;}
+	if (name == MATRIX_HENS920103.name) {f(MATRIX_HENS920103); return true;}
+	if (name == MATRIX_HENS920104.name) {f(MATRIX_HENS920104); return true;}
+	if (name == MATRIX_DNA.name) {f(MATRIX_DNA); return true;}
+	if (name == MATRIX_RNA.name) {f(MATRIX_RNA); return true;}
+	return false;
+}
+
+/* Names of the built-in matrices, for the help and the error messages */
+inline std::string BuiltinMatrixNames()
+{
+	return "HENS920101 (BLOSUM45), HENS920102 (BLOSUM62), HENS920103 (BLOSUM80), HENS920104 (BLOSUM50), DNA, RNA";
+}
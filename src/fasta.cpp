@@ -0,0 +1,243 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fasta.h"
+
+namespace {
+
+/* Upper case conversion table, so copySequence() does not call the
+ * locale-aware toupper() once per residue. */
+std::array<char,256> make_upper_table()
+{
+	std::array<char,256> table;
+	for (int c(0); c < 256; ++c){
+		table[c] = static_cast<char>(toupper(c));
+	}
+	return table;
+}
+
+const std::array<char,256> UPPER = make_upper_table();
+
+/* Returns the end of the line starting at pos (the '\n' or the end of
+ * the data), and sets content_end to the end of its content, i.e.
+ * without a trailing '\r' left by a file written on Windows. */
+size_t line_end(const char * data, size_t size, size_t pos, size_t & content_end)
+{
+	const void * nl = memchr(data + pos, '\n', size - pos);
+	size_t end = nl ? static_cast<size_t>(static_cast<const char *>(nl) - data) : size;
+	content_end = end;
+	if (content_end > pos && data[content_end - 1] == '\r'){
+		content_end--;
+	}
+	return end;
+}
+
+} // namespace
+
+
+/**************************************************************
+ * MappedFile
+ **************************************************************/
+MappedFile :: MappedFile() : addr(nullptr), len(0), mapped(false)
+{
+}
+
+MappedFile :: MappedFile(const std::string & fname) : addr(nullptr), len(0), mapped(false)
+{
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd < 0){
+		throw std::runtime_error("Cannot open file " + fname);
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+		void * p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED){
+			addr   = static_cast<const char *>(p);
+			len    = static_cast<size_t>(st.st_size);
+			mapped = true;
+			madvise(p, len, MADV_SEQUENTIAL);
+		}
+	}
+	close(fd);
+
+	/* Not mappable: read it whole instead */
+	if (!mapped){
+		std::ifstream file(fname.c_str(), std::ios::binary);
+		if (!file.good()){
+			throw std::runtime_error("Cannot open file " + fname);
+		}
+		buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		addr = buffer.data();
+		len  = buffer.size();
+	}
+}
+
+MappedFile :: MappedFile(MappedFile && other) noexcept
+	: addr(other.addr), len(other.len), mapped(other.mapped), buffer(std::move(other.buffer))
+{
+	other.addr   = nullptr;
+	other.len    = 0;
+	other.mapped = false;
+}
+
+MappedFile &
+MappedFile :: operator=(MappedFile && other) noexcept
+{
+	if (this != &other){
+		release();
+		addr   = other.addr;
+		len    = other.len;
+		mapped = other.mapped;
+		buffer = std::move(other.buffer);
+		other.addr   = nullptr;
+		other.len    = 0;
+		other.mapped = false;
+	}
+	return *this;
+}
+
+MappedFile :: ~MappedFile()
+{
+	release();
+}
+
+void
+MappedFile :: release()
+{
+	if (mapped){
+		munmap(const_cast<char *>(addr), len);
+	}
+	addr   = nullptr;
+	len    = 0;
+	mapped = false;
+	buffer.clear();
+}
+
+
+/**************************************************************
+ * FastaReader constructor scans the lines of the file once.
+ * A line starting with '>' opens a new record, every other
+ * line is appended to the current record. Text before the
+ * first header is ignored. Only line boundaries are looked at
+ * (memchr), residues themselves are not touched yet.
+ **************************************************************/
+FastaReader :: FastaReader(const MappedFile & f, int max_seq) : file(f)
+{
+	const char * data = file.data();
+	size_t size = file.size();
+	size_t pos = 0;
+
+	while (pos < size){
+		size_t content_end;
+		size_t end = line_end(data, size, pos, content_end);
+		if (data[pos] == '>'){
+			if (static_cast<int>(records.size()) >= max_seq){
+				break;
+			}
+			size_t name_end = pos + 1;
+			while (name_end < content_end && data[name_end] != ' ' && data[name_end] != '\t'){
+				name_end++;
+			}
+			Record rec;
+			rec.name   = std::string_view(data + pos + 1, name_end - pos - 1);
+			rec.begin  = end < size ? end + 1 : size;
+			rec.end    = rec.begin;
+			rec.length = 0;
+			records.push_back(rec);
+		} else if (!records.empty()){
+			records.back().length += static_cast<int>(content_end - pos);
+			records.back().end = end < size ? end + 1 : size;
+		}
+		pos = end + 1;
+	}
+}
+
+
+/**************************************************************
+ * copySequence(rec, out) copies the residues of the record
+ * rec in out, which must hold at least getLength(rec) chars.
+ **************************************************************/
+void
+FastaReader :: copySequence(int rec, char * out) const
+{
+	const char * data = file.data();
+	size_t pos = records[rec].begin;
+	size_t end = records[rec].end;
+
+	while (pos < end){
+		size_t content_end;
+		size_t eol = line_end(data, end, pos, content_end);
+		for (size_t i(pos); i < content_end; ++i){
+			*out++ = UPPER[static_cast<unsigned char>(data[i])];
+		}
+		pos = eol + 1;
+	}
+}
+
+
+/**************************************************************
+ * copyResidues(rec, pos, count, out) copies count residues of
+ * the record rec, starting at the offset pos, in out, and
+ * returns the offset of the residue after them: the sequence
+ * can be read piece by piece (one chunk of columns at a time)
+ * starting from getBegin(rec). Only the lines of these
+ * residues are scanned, never the rest of a long line.
+ **************************************************************/
+size_t
+FastaReader :: copyResidues(int rec, size_t pos, int count, char * out) const
+{
+	const char * data = file.data();
+	size_t end = records[rec].end;
+
+	while (count > 0 && pos < end){
+		/* A line break in the next count + 1 chars ends the residues
+		 * taken from this line (the +1 finds a "\r\n" right after them) */
+		size_t stop = std::min(end, pos + count + 1);
+		const void * nl = memchr(data + pos, '\n', stop - pos);
+		size_t content_end = nl ? static_cast<size_t>(static_cast<const char *>(nl) - data) : stop;
+		if ((nl || stop == file.size()) && content_end > pos && data[content_end - 1] == '\r'){
+			content_end--;
+		}
+		size_t n = std::min(content_end - pos, static_cast<size_t>(count));
+		for (size_t i(pos); i < pos + n; ++i){
+			*out++ = UPPER[static_cast<unsigned char>(data[i])];
+		}
+		pos   += n;
+		count -= static_cast<int>(n);
+		if (nl && pos == content_end){
+			pos = static_cast<size_t>(static_cast<const char *>(nl) - data) + 1;
+		}
+	}
+	return pos;
+}
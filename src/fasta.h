@@ -0,0 +1,89 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * MappedFile maps a whole file read-only in memory (mmap), so that it
+ * can be scanned in place instead of being copied line by line through
+ * an ifstream. When the file cannot be mapped (empty file, pipe...),
+ * its content is read once in a private buffer instead: callers only
+ * ever see data()/size().
+ */
+class MappedFile
+{
+protected:
+	const char *      addr;     /**< First byte of the file content */
+	size_t            len;      /**< Size of the file content in bytes */
+	bool              mapped;   /**< True if addr comes from mmap (and must be unmapped) */
+	std::vector<char> buffer;   /**< File content when it could not be mapped */
+
+	void release();
+
+public:
+	MappedFile();
+	explicit MappedFile(const std::string & fname);
+	MappedFile(MappedFile && other) noexcept;
+	MappedFile & operator=(MappedFile && other) noexcept;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	const char * data() const {return addr;};
+	size_t       size() const {return len;};
+};
+
+/**
+ * FastaReader indexes the records of a multi-fasta file held in a
+ * MappedFile: one scan over the lines finds the '>' headers and counts
+ * the residues of each record, without copying anything. Sequences are
+ * then copied (in upper case) straight into a buffer the caller has
+ * preallocated from these counts. Names are views into the mapping, so
+ * the MappedFile must outlive them.
+ */
+class FastaReader
+{
+protected:
+	struct Record {
+		std::string_view name;   /**< Name of the sequence (header up to the first blank) */
+		size_t begin;            /**< Offset of the first sequence line in the file */
+		size_t end;              /**< Offset just past the last sequence line */
+		int    length;           /**< Number of residues of the sequence */
+	};
+
+	const MappedFile &  file;
+	std::vector<Record> records;
+
+public:
+	FastaReader(const MappedFile & file, int max_seq);	/**< Index at most max_seq records of file */
+
+	int size() const {return static_cast<int>(records.size());};		/**< Number of indexed records */
+	std::string_view getName(int rec) const {return records[rec].name;};	/**< Name of the record rec */
+	int getLength(int rec) const {return records[rec].length;};			/**< Number of residues of the record rec */
+	void copySequence(int rec, char * out) const;		/**< Copy the getLength(rec) residues of rec, in upper case, in out */
+	size_t getBegin(int rec) const {return records[rec].begin;};		/**< Offset of the first residue of rec, see copyResidues() */
+	size_t copyResidues(int rec, size_t pos, int count, char * out) const;	/**< Copy (in upper case) the next count residues of rec from the offset pos, returns the offset after them */
+};
@@ -21,6 +21,7 @@
 
 #include "gap.h"
 #include "options.h"
+#include "thread_pool.h"
 
 #include <fstream>
 
@@ -29,7 +30,10 @@ GapStat :: calculate(Msa & msa)
 {
 	int L = msa.getNcol();
 	int N = msa.getNseq();
-	for (int x(0); x < L; ++x){
-		col_stat.push_back(static_cast<float>(msa.getGap(x)) / static_cast<float>(N));
-	}
+	col_stat.assign(L, 0.0);
+	ParallelFor(0, L, [&](int x_begin, int x_end){
+		for (int x(x_begin); x < x_end; ++x){
+			col_stat[x] = static_cast<float>(msa.getGap(x)) / static_cast<float>(N);
+		}
+	});
 }
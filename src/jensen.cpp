@@ -23,6 +23,7 @@
 #include "options.h"
 #include "scoring_matrix.h"
 #include "background.h"
+#include "thread_pool.h"
 
 #include <cmath>
 #include <fstream>
@@ -59,69 +60,61 @@ JensenStat :: calculate(Msa & msa)
 	int N = msa.getNseq();
 	int K = static_cast<int>(alphabet.size());
 	
-	/* Allocate proba array */
-	std::vector<std::vector<float> > proba(L, std::vector<float>(K, 0.0f));
-
-	/* Calculate Sequence Weights */
-	const vector<float> & w = msa.getSeqWeights();
+	/* Weighted aa proba of each column (p[x * K + a]), shared by all statistics */
+	const vector<float> & p = msa.getWeightedCounts();
 
 	/* Background distribution of amino acids: -k/--background lets the
 	 * user pick "uniform", the historical "legacy" Capra & Singh (2007)
 	 * table (the default, preserving past behavior), or a custom file. */
-	BackgroundDistribution q(Options::Get().background);
+	const BackgroundDistribution & q = BackgroundDistribution::Get(Options::Get().background);
+
+	/* Background frequency of each symbol of the alphabet, looked up once
+	 * instead of three times per symbol and column. Gaps and ambiguous
+	 * symbols do not take part in the score. */
+	std::vector<bool>  scored(K, false);
+	std::vector<float> q_a(K, 0.0f);
+	for (int a(0); a < K; a++){
+		char aa = alphabet[a];
+		if (aa != '-' && aa != 'X' && aa != 'Z' && aa != 'B'){
+			scored[a] = true;
+			q_a[a] = q.getFreq(aa);
+		}
+	}
 	
-	/* Calculate aa proba by columns */
 	float lambda = 0.5;
 	
-  for (int x(0); x < L; ++x){
-		int nb_abs = 0;
-		for (int a(0); a < K; a++){
-		  for (int j(0); j < N; ++j){
-				if(msa.getSymbol(j, x) == alphabet[a]){
-					proba[x][a] += w[j];
+	/* Columns are independent: each thread takes a range of them */
+	col_stat.assign(L, 0.0);
+	ParallelFor(0, L, [&](int x_begin, int x_end){
+		std::vector<float> proba(K);
+		for (int x(x_begin); x < x_end; ++x){
+			/* Calculate aa proba of the column */
+			int nb_abs = 0;
+			proba.assign(p.begin() + x * K, p.begin() + (x + 1) * K);
+			for (int a(0); a < K; a++){
+				if (proba[a] == 0.0){
+					proba[a] = PSEUDO_COUNT;
+					nb_abs++;
 				}
 			}
-			if (proba[x][a] == 0.0){
-				proba[x][a] = PSEUDO_COUNT;
-				nb_abs++;
-			}
-		}
-		/* reduce by the pseudo counts in order to have sum-of-proba = 1 */
-		float pseudo_counts = static_cast<float>(nb_abs) * PSEUDO_COUNT / static_cast<float>(K - nb_abs);
-		for (int a(0); a < K; a++){
-			if (proba[x][a] > PSEUDO_COUNT){
-				proba[x][a] -= pseudo_counts;
+			/* reduce by the pseudo counts in order to have sum-of-proba = 1 */
+			float pseudo_counts = static_cast<float>(nb_abs) * PSEUDO_COUNT / static_cast<float>(K - nb_abs);
+			for (int a(0); a < K; a++){
+				if (proba[a] > PSEUDO_COUNT){
+					proba[a] -= pseudo_counts;
+				}
 			}
-		}
-	}
-	
-	/* Calculate conservation score by columns */
-	for (int x(0); x < L; ++x){
-		float score_left = 0.0;
-		float score_right = 0.0;
-		for (int a(0); a < K; a++){
-			char aa = alphabet[a];
-			if (aa != '-' && aa != 'X' && aa != 'Z' && aa != 'B'){
-				score_left  += proba[x][a] * log(proba[x][a] / (lambda * proba[x][a] + (1.0 - lambda) * q.getFreq(aa)));
-				score_right += q.getFreq(aa) * log(q.getFreq(aa) / (lambda * proba[x][a] + (1.0 - lambda) * q.getFreq(aa)));
+			
+			/* Calculate conservation score of the column */
+			float score_left = 0.0;
+			float score_right = 0.0;
+			for (int a(0); a < K; a++){
+				if (scored[a]){
+					score_left  += proba[a] * log(proba[a] / (lambda * proba[a] + (1.0 - lambda) * q_a[a]));
+					score_right += q_a[a] * log(q_a[a] / (lambda * proba[a] + (1.0 - lambda) * q_a[a]));
+				}
 			}
+			col_stat[x] = (1 - (lambda * score_left + (1.0 - lambda) * score_right)) * (1 - (static_cast<float>(msa.getGap(x)) / static_cast<float>(N)));
 		}
-		col_stat.push_back((1 - (lambda * score_left + (1.0 - lambda) * score_right)) * (1 - (static_cast<float>(msa.getGap(x)) / static_cast<float>(N))));
-	}
-	
-	/* Add Side columns effect */
-	/*int window = Options::Get().window;
-	for (int x(0); x < L; ++x){
-		float score = col_stat[x];
-		float side_score = 0.0;
-		for (int i(x-1); i >= 0 && i >= x - window; i--) {
-			side_score += col_stat[i];
-		}
-		for (int i(x+1); i < L && i <= x + window; i++) {
-			side_score += col_stat[i];
-		}
-		side_score /= (2 * window);
-		cout << 0.5 * (score + side_score) <<"\n";
-		col_stat[x] = 0.5 * (score + side_score);
-	}*/
+	});
 }
@@ -21,6 +21,7 @@
 
 #include "options.h"
 #include "kabat.h"
+#include "thread_pool.h"
 
 #include <cmath>
 #include <fstream>
@@ -35,25 +36,21 @@ using namespace std;
 void
 KabatStat :: calculate(Msa & msa)
 {
-	int k;                    // number of amino acid types in a given column
-	int n1;                   // number of occurences of the most represented residue in a column
-	int N = msa.getNseq();    // number of sequences in the msa
 	int ncol = msa.getNcol(); // number of columns in the multiple alignment
-	vector<int> naa;
+	int K = static_cast<int>(msa.getAlphabet().size());
+	const vector<int> & nb_aa = msa.getCounts(); // nb_aa[x * K + a] = occurences of alphabet[a] in column x
 
-	for (int x(0); x < ncol; ++x){
-		k = msa.getNtype(x);
-  	/* Find the most represented amino acid type (n1) */
-		string aa_type = msa.getTypeList(x);
-		vector<int> nb_aa(aa_type.size(), 0);
-		for (int s(0); s < N; ++s){
-			nb_aa[aa_type.find(msa.getSymbol(s, x))]++;
+	col_stat.assign(ncol, 0.0);
+	ParallelFor(0, ncol, [&](int x_begin, int x_end){
+		for (int x(x_begin); x < x_end; ++x){
+			int k = msa.getNtype(x); // number of amino acid types in a given column
+			/* Find the most represented amino acid type (n1) */
+			int n1 = 0;              // number of occurences of the most represented residue in a column
+			for (int a(0); a < K; ++a)
+				if (nb_aa[x * K + a] > n1)
+					n1 = nb_aa[x * K + a];
+			/* Calculate conservation from Wu & Kabat formula */
+			col_stat[x] = static_cast<float>(k) / static_cast<float>(n1);
 		}
-		n1 = 0;
-		for (int i(0); i < static_cast<int>(nb_aa.size()); ++i)
-			if (nb_aa[i] > n1)
-				n1 = nb_aa[i];
-		/* Calculate conservation from Wu & Kabat formula */
-		col_stat.push_back(static_cast<float>(k) / static_cast<float>(n1));
-	}
+	});
 }
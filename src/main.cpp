@@ -20,18 +20,54 @@
  */
 
 #include <iostream>
-#include <ctime>
+#include <chrono>
 #include <memory>
 
+#include "batch.h"
 #include "msa.h"
 #include "options.h"
+#include "profile.h"
+#include "sampling.h"
 #include "statistic.h"
 #include "scoring_matrix.h"
 
+/* With --profile, prints the phases of the run and writes them in
+ * the JSON file; with --trace, writes the timeline. Returns false
+ * if a file cannot be written */
+static bool report_profile(int argc, char **argv)
+{
+	if (Tracer::Get().isEnabled()){
+		try {
+			Tracer::Get().write(Options::Get().trace);
+		} catch (std::exception &e) {
+			std::cerr << e.what() << "\n";
+			return false;
+		}
+		std::cout << "Trace written in " << Options::Get().trace << "\n\n";
+	}
+	if (!Profiler::Get().isEnabled()){
+		return true;
+	}
+	std::string command(argv[0]);
+	for (int i = 1; i < argc; i++){
+		command += std::string(" ") + argv[i];
+	}
+	std::cout << "Profile:\n";
+	Profiler::Get().writeTable(std::cout);
+	try {
+		Profiler::Get().writeJson(Options::Get().profile, command);
+	} catch (std::exception &e) {
+		std::cerr << e.what() << "\n";
+		return false;
+	}
+	std::cout << "Profile written in " << Options::Get().profile << "\n\n";
+	return true;
+}
+
 int main (int argc, char **argv)
 {
-	clock_t t1,t2;
-	t1 = clock();
+	/* Wall-clock time: clock() would add up the time of every thread */
+	auto t1 = std::chrono::steady_clock::now();
 	
 	/* 
 	 * Parses command line 
@@ -44,6 +80,12 @@ int main (int argc, char **argv)
 		Options::Get().print_usage();
 		return 1;
 	}
+	if (!Options::Get().profile.empty()){
+		Profiler::Get().enable();
+	}
+	if (!Options::Get().trace.empty()){
+		Tracer::Get().enable();
+	}
 	std::cout << "Statistic: " << Options::Get().statistic << "\n";
 	/* 
 	 * Initiates Statistic factory
@@ -56,14 +98,62 @@ int main (int argc, char **argv)
 	}
 	
 	/*
-	 * Read the multiple alignment, calculate the statistic & print it
+	 * Batch mode: the same statistics on every input listed by
+	 * --batch, with one output per input in the -o directory
+	 */
+	if (!Options::Get().batch.empty()){
+		try {
+			std::vector<BatchResult> results = RunBatch(ReadBatchInputs(Options::Get().batch), Options::Get().output_fname);
+			std::string summary = Options::Get().output_fname + "/batch_summary.txt";
+			WriteBatchSummary(results, summary);
+			int nb_failed = 0;
+			for (const BatchResult & result : results){
+				if (!result.error.empty()){
+					std::cerr << result.input << ": " << result.error << "\n";
+					nb_failed++;
+				}
+			}
+			auto t2 = std::chrono::steady_clock::now();
+			std::cout << "Mstatx computed " << results.size() << " alignments (" << nb_failed << " failed) in "
+			          << std::chrono::duration<double>(t2 - t1).count() << " seconds\nResults are written in "
+			          << Options::Get().output_fname << ", timings in " << summary << "\n\n";
+			if (!report_profile(argc, argv)){
+				return 1;
+			}
+			return nb_failed ? 1 : 0;
+		} catch (std::exception &e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+	}
+
+	/*
+	 * Read the multiple alignment once, calculate every statistic
+	 * on it & print them
 	 */
 	try {
-		Msa msa(Options::Get().input_fname);
+		const std::vector<std::string> & names = Options::Get().statistics;
+		std::vector<std::unique_ptr<Statistic> > stats;
+		for (const std::string & name : names){
+			stats.push_back(std::unique_ptr<Statistic>(StatisticFactory::CreateByName(name)));
+		}
 
-		std::unique_ptr<Statistic> stat(StatisticFactory::CreateByName(Options::Get().statistic));
-		stat->calculate(msa);
-		stat->print(msa);
+		/* With --tolerance, on growing samples of the sequences */
+		std::unique_ptr<Msa> msa;
+		if (Options::Get().tolerance > 0.0){
+			msa = SampleAndCalculate(Options::Get().input_fname, stats);
+		} else {
+			msa.reset(new Msa(Options::Get().input_fname));
+			for (size_t s(0); s < stats.size(); ++s){
+				ProfileScope phase("calculate " + names[s]);
+				stats[s]->calculate(*msa);
+			}
+		}
+		Profiler::Get().addAlignment(msa->getNseq(), msa->getNcol());
+		if (Options::Get().weights == "identity"){
+			std::cout << "Neff: " << msa->getNeff() << " (" << msa->getNseq() << " sequences, clusters at " << Options::Get().identity << " identity)\n";
+		}
+		PrintStatistics(*msa, names, stats);
 	} catch (std::exception &e) {
 		std::cerr << e.what() << "\n";
 		return 1;
@@ -72,7 +162,7 @@ int main (int argc, char **argv)
 	/*
 	 * Print time
 	 */
-	t2 = clock();		
-	std::cout << "Mstatx computed in "<< (t2 - t1) / static_cast<double>(CLOCKS_PER_SEC) <<" seconds\nResults are written in " << Options::Get().output_fname << "\n\n";
-	return 0;
+	auto t2 = std::chrono::steady_clock::now();
+	std::cout << "Mstatx computed in "<< std::chrono::duration<double>(t2 - t1).count() <<" seconds\nResults are written in " << Options::Get().output_fname << "\n\n";
+	return report_profile(argc, argv) ? 0 : 1;
 }
@@ -0,0 +1,243 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mi.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+/* Bytes of codes of a block of rows: they stay in the L1/L2 cache
+ * while the columns they are paired with go by */
+const int TILE_BYTES = 1 << 15;
+
+/* Buffers of entropy(), one per thread */
+struct Scratch
+{
+	vector<uint64_t> mantissa, exponent;
+	vector<double>   m, e;
+	explicit Scratch(int n) : mantissa(n), exponent(n), m(n), e(n) {}
+};
+
+/* -sum p log p of the n probabilities of p, 0 log 0 being 0.
+ *
+ * std::log() costs as much as the counts of a pair: the logarithms
+ * are computed here from the bits of p = m 2^e, m in [sqrt(1/2),
+ * sqrt(2)), log p = e log 2 + 2 atanh((m - 1) / (m + 1)), the series
+ * of atanh stopping at the 11th power (relative error below 1e-13).
+ * Each loop is element by element, without branches, so that the
+ * compiler vectorizes it, and the sum is split in 4 fixed partial
+ * sums: every code path gives the same bits. */
+inline __attribute__((always_inline))
+double entropy_of(const double * p, int n, Scratch & scratch)
+{
+	uint64_t * mantissa = scratch.mantissa.data();
+	uint64_t * exponent = scratch.exponent.data();
+	double * m = scratch.m.data();
+	double * e = scratch.e.data();
+	memcpy(mantissa, p, n * sizeof(double));
+	for (int a(0); a < n; ++a){
+		uint64_t bits = mantissa[a];
+		uint64_t above = (bits & 0x000fffffffffffffULL) > 0x6a09e667f3bcdULL;	/* mantissa of sqrt(2) */
+		mantissa[a] = ((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL) - (above << 52);
+		exponent[a] = ((bits >> 52) | 0x4330000000000000ULL) + above;	/* 2^52 + biased exponent, as a double */
+	}
+	memcpy(m, mantissa, n * sizeof(double));
+	memcpy(e, exponent, n * sizeof(double));
+	for (int a(0); a < n; ++a){
+		double s  = (m[a] - 1.0) / (m[a] + 1.0);
+		double s2 = s * s;
+		double log_m = 2.0 * s * (1.0 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7 + s2 * (1.0 / 9 + s2 * (1.0 / 11))))));
+		double log_p = (e[a] - 4503599627371519.0) * 0.6931471805599453 + log_m;	/* 2^52 + 1023 */
+		m[a] = p[a] * log_p;	/* 0 for p = 0: log_p is then finite */
+	}
+	double h[4] = {0.0, 0.0, 0.0, 0.0};
+	int a(0);
+	for (; a + 4 <= n; a += 4){
+		h[0] -= m[a]; h[1] -= m[a + 1]; h[2] -= m[a + 2]; h[3] -= m[a + 3];
+	}
+	for (; a < n; ++a){
+		h[0] -= m[a];
+	}
+	return (h[0] + h[1]) + (h[2] + h[3]);
+}
+
+double entropy_default(const double * p, int n, Scratch & scratch)
+{
+	return entropy_of(p, n, scratch);
+}
+
+#ifdef MSTATX_X86
+__attribute__((target("avx2")))
+double entropy_avx2(const double * p, int n, Scratch & scratch)
+{
+	return entropy_of(p, n, scratch);
+}
+#endif
+
+typedef double (*EntropyKernel)(const double *, int, Scratch &);
+
+EntropyKernel entropy_kernel(SimdLevel simd)
+{
+#ifdef MSTATX_X86
+	if (simd == SimdLevel::AVX2){
+		return entropy_avx2;
+	}
+#endif
+	return entropy_default;
+}
+
+} // namespace
+
+
+/** calculate(Msa & msa)
+ *
+ * MI(x,y) = \sum_{a,b} p_{ab} log(p_{ab} / (p_a p_b)) = H(x) + H(y) - H(x,y)
+ * with p the weighted frequencies of the symbols (of the pairs of
+ * symbols) in the columns.
+ *
+ * Each column is first recoded with the symbols it contains only
+ * (0 .. k_x - 1), so that the joint frequencies of a pair of columns
+ * fill a k_x * k_y table: one pass over the sequences, then the
+ * entropy of the (small) table.
+ *
+ * The correction needs the mean MI of every column: the MI of all
+ * the pairs is computed a first time here, only to sum it, then a
+ * second time by forEachRow(), which subtracts the correction and
+ * hands the rows over. The L x L matrix is never held.
+ */
+void
+MIStat :: calculate(Msa & msa)
+{
+	L = msa.getNcol();
+	N = msa.getNseq();
+	const vector<float> & w = msa.getSeqWeights();
+	EntropyKernel entropy = entropy_kernel(simd);
+	int K = static_cast<int>(msa.getAlphabet().size());
+
+	/* Local codes, types and entropy of each column */
+	codes.assign(static_cast<size_t>(L) * N, 0);
+	ntype.assign(L, 0);
+	h.assign(L, 0.0);
+	msa.forColumnChunks([&](int col_begin, int col_end){
+		ParallelFor(col_begin, col_end, [&](int x_begin, int x_end){
+			Scratch scratch(K);
+			for (int x(x_begin); x < x_end; ++x){
+				const uint8_t * col = msa.getColCodes(x);
+				uint8_t * local = &codes[static_cast<size_t>(x) * N];
+				array<int,256> index;
+				index.fill(-1);
+				vector<double> p;
+				for (int s(0); s < N; ++s){
+					if (index[col[s]] < 0){
+						index[col[s]] = static_cast<int>(p.size());
+						p.push_back(0.0);
+					}
+					local[s] = static_cast<uint8_t>(index[col[s]]);
+					p[local[s]] += w[s];
+				}
+				ntype[x] = static_cast<int>(p.size());
+				h[x] = entropy(p.data(), ntype[x], scratch);
+			}
+		});
+	});
+
+	/* Mean MI of each column, and of all the pairs */
+	mean.assign(L, 0.0);
+	total = 0.0;
+	forEachMIRow(w, [&](int x, const vector<float> & mi){
+		for (int y(x + 1); y < L; ++y){
+			mean[x] += mi[y];
+			mean[y] += mi[y];
+			total   += mi[y];
+		}
+	});
+	if (L > 1){
+		for (double & m : mean){
+			m /= L - 1;
+		}
+		total /= 0.5 * L * (L - 1);
+	}
+}
+
+
+/**
+ * forEachRow() subtracts the average product correction from the MI
+ * rows: MIp(x,y) = MI(x,y) - mean_x mean_y / total.
+ */
+void
+MIStat :: forEachRow(Msa & msa, const function<void(int, const vector<float> &)> & row)
+{
+	vector<float> mip(L, 0.0);
+	forEachMIRow(msa.getSeqWeights(), [&](int x, const vector<float> & mi){
+		for (int y(x + 1); y < L; ++y){
+			mip[y] = total > 0.0 ? mi[y] - static_cast<float>(mean[x] * mean[y] / total) : mi[y];
+		}
+		row(x, mip);
+	});
+}
+
+
+/**
+ * forEachMIRow() computes the MI of the pairs (x, y > x) rows by rows:
+ * a block of `tile` rows at a time, their codes staying in the cache
+ * while the columns y > x go by, split between the threads. Every
+ * pair is computed by a single thread, so the scores do not depend on
+ * -j. Only the block of rows is held (tile * L scores).
+ */
+void
+MIStat :: forEachMIRow(const vector<float> & w, const function<void(int, const vector<float> &)> & row) const
+{
+	EntropyKernel entropy = entropy_kernel(simd);
+	int K = L > 0 ? *max_element(ntype.begin(), ntype.end()) : 0;
+	int tile = max(1, min(64, TILE_BYTES / max(1, N)));
+	vector<vector<float> > block(tile, vector<float>(L, 0.0));
+	for (int x_begin(0); x_begin + 1 < L; x_begin += tile){
+		int x_end = min(L - 1, x_begin + tile);
+		ParallelFor(x_begin + 1, L, [&](int y_begin, int y_end){
+			vector<double> joint(static_cast<size_t>(K) * K, 0.0);
+			Scratch scratch(K * K);
+			for (int y(y_begin); y < y_end; ++y){
+				const uint8_t * cy = &codes[static_cast<size_t>(y) * N];
+				int ky = ntype[y];
+				for (int x(x_begin); x < min(x_end, y); ++x){
+					const uint8_t * cx = &codes[static_cast<size_t>(x) * N];
+					for (int s(0); s < N; ++s){
+						joint[cx[s] * ky + cy[s]] += w[s];
+					}
+					int cells = ntype[x] * ky;
+					double mi = h[x] + h[y] - entropy(joint.data(), cells, scratch);
+					fill(joint.begin(), joint.begin() + cells, 0.0);
+					block[x - x_begin][y] = static_cast<float>(max(0.0, mi));
+				}
+			}
+		});
+		for (int x(x_begin); x < x_end; ++x){
+			row(x, block[x - x_begin]);
+		}
+	}
+}
@@ -0,0 +1,50 @@
+/* Copyright (c) 2012 Guillaume Collet
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE. 
+ */
+
+#pragma once
+
+#include "simd.h"
+#include "statistic.h"
+
+/** Mutual information of every pair of columns, corrected by the
+ *  average product (Dunn et al., 2008):
+ *    MIp(x,y) = MI(x,y) - MI(x,.) MI(y,.) / MI(.,.)
+ *  with MI(x,.) the mean MI of column x with the others, and MI(.,.)
+ *  the mean MI of all the pairs. The symbols are counted with the
+ *  sequence weights of --weights. */
+class MIStat : public Stat2D
+{
+private:
+	SimdLevel simd = BestSimdLevel();	/**< Code path of the entropies */
+	int L = 0;									/**< Number of columns */
+	int N = 0;									/**< Number of sequences */
+	std::vector<uint8_t> codes;		/**< Code of each symbol among the symbols of its column, column after column (size = L * N) */
+	std::vector<int>     ntype;		/**< Number of symbols of each column */
+	std::vector<double>  h;				/**< Entropy of each column */
+	std::vector<double>  mean;			/**< Mean MI of each column with the others */
+	double               total = 0.0;	/**< Mean MI of all the pairs */
+
+	void forEachMIRow(const std::vector<float> & w, const std::function<void(int, const std::vector<float> &)> & row) const;	/**< Same as forEachRow(), on the MI before correction */
+public:
+	void calculate(Msa & msa) override;
+	void forEachRow(Msa & msa, const std::function<void(int, const std::vector<float> &)> & row) override;
+	void setSimdLevel(SimdLevel level) {simd = level;};		/**< Use another code path (they all give the same results) */
+};
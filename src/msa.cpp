@@ -27,9 +27,25 @@
 
 #include "msa.h"
 #include "options.h"
+#include "profile.h"
+#include "thread_pool.h"
 
 using namespace std;
 
+namespace {
+
+/* gap_mask(alphabet)[a] is true if alphabet[a] is a gap symbol ('-' or ' ') */
+std::vector<char> gap_mask(const std::string & alphabet)
+{
+	std::vector<char> mask(alphabet.size(), 0);
+	for (int a(0); a < static_cast<int>(alphabet.size()); ++a){
+		mask[a] = (alphabet[a] == '-' || alphabet[a] == ' ');
+	}
+	return mask;
+}
+
+} // namespace
+
 
 /**************************************************************
  * This constructor of a multiple alignment reads the 
@@ -37,60 +53,54 @@ using namespace std;
  * Once read, the multiple alignment is analysed to find
  * the alphabet used, the number of gaps and the entropy of 
  * each column, and the frequency of each amino acid type.
+ * With -C, the analysed alignment is loaded from its cache
+ * file instead, when it is up to date, or else saved there
+ * for the next runs (see msa_cache.cpp).
+ * With --max-memory, it is read and analysed by chunks of
+ * columns instead, never whole in memory (see msa_stream.cpp).
  **************************************************************/
-Msa :: Msa(const std::string & fname)
+Msa :: Msa(const std::string & fname) : Msa(fname, std::vector<int>())
 {
-	seq_weight_computed = false;
-	alpha_index.fill(-1);
-	
-	/* Open file */
-	if (Options::Get().verbose){
-		std::cout << "Read Multiple Alignment in " << fname << "\n";
-	}
-	std::ifstream file(fname.c_str());
-	if (!file.good()){
-		throw std::runtime_error("Cannot open file " + fname);
-	}
+}
 
+/**************************************************************
+ * With a sample (positions of sequences in the file, see
+ * sampling.cpp), only these sequences are read, whatever
+ * -n/--nb_seq, and -C is not used (nor --max-memory, which
+ * the options reject together with --tolerance).
+ **************************************************************/
+Msa :: Msa(const std::string & fname, const std::vector<int> & sample)
+{
+	seq_weight_computed  = false;
+	identity_weight_computed = false;
+	neff = 0.0f;
+	col_counts_computed  = false;
+	col_wcounts_computed = false;
+	alpha_index.fill(-1);
+	code_matrix = nullptr;
+	chunk_begin = 0;
+	chunk_end   = 0;
+	chunk_size  = 0;
 	
-	/* Read file */
-	std::string s, tmp_seq;
-	while (file.good() && static_cast<int>(mali_seq.size()) < Options::Get().nb_seq){
-		getline(file,s);
-		if (s[0] == '>'){
-			if (mali_name.size() != 0){
-			  mali_seq.push_back(tmp_seq);	
-			}
-			if (static_cast<int>(mali_seq.size()) < Options::Get().nb_seq){
-  			mali_name.push_back(s.substr(1, s.find_first_of(' ') - 1));
-			}
-			tmp_seq.clear();
-		} else {
-			tmp_seq = tmp_seq + s;
-		}
-	}
-	if (static_cast<int>(mali_seq.size()) < Options::Get().nb_seq){
-	  mali_seq.push_back(tmp_seq);
-	}
-	
-	nseq = static_cast<int>(mali_name.size());
-	ncol = static_cast<int>(mali_seq[0].size());
-	std::cout << "\nMultiple alignment : nb seq = "<<nseq<<", nb col = "<<ncol<<"\n";
-	
-	/* Change all mali.seq in upper case*/
-	for (int i(0); i < nseq; ++i){
-		for(int j(0); j < ncol; ++j){
-			mali_seq[i][j] = toupper(mali_seq[i][j]);
+	TraceScope span("Msa", "alignment");
+	span.arg("file", fname).arg("sample", static_cast<int>(sample.size()));
+	if (!sample.empty()){
+		readFasta(fname, sample);
+		analyse();
+	} else if (Options::Get().max_memory > 0.0){
+		ProfileScope phase("stream");
+		streamFasta(fname);
+	} else if (!Options::Get().cache || !loadCache(fname)){
+		readFasta(fname, sample);
+		analyse();
+		
+		if (Options::Get().cache){
+			ProfileScope phase("save cache");
+			saveCache(fname);
 		}
 	}
-	
-	/* Analyse the multiple alignment */
-	defineAlphabet();
-	countGap();
-	countFreq();
-	countType();
-	countEntropy();
-	
+	/* One write, so the lines of alignments read at the same time (--batch) do not mix */
+	std::cout << "\nMultiple alignment : nb seq = " + std::to_string(nseq) + ", nb col = " + std::to_string(ncol) + "\n";
 	
 	/* Print if verbose mode */
 	if (Options::Get().verbose){
@@ -100,8 +110,16 @@ Msa :: Msa(const std::string & fname)
 		}
 		cout << "\n";
 		cout << "\nMultiple Alignment :\n";
-		for (const auto & seq : mali_seq){
-			cout << seq << "\n";
+		if (isChunked()){
+			cout << "(read by chunks of " << chunk_size << " columns, see --max-memory)\n";
+		} else {
+			std::string row(ncol, ' ');
+			for (int i(0); i < nseq; ++i){
+				for (int j(0); j < ncol; ++j){
+					row[j] = getSymbol(i, j);
+				}
+				cout << row << "\n";
+			}
 		}
 		cout << "\nAA Frequencies :\n";
 		for (float f : aa_freq){
@@ -131,17 +149,91 @@ Msa :: Msa(const std::string & fname)
 }
 
 
+/**************************************************************
+ * readFasta() reads the sequences of the file fname.
+ * The file is memory-mapped and indexed by FastaReader, then
+ * every sequence is copied once, in upper case, in the
+ * mali_seq buffer preallocated to nseq * ncol residues.
+ **************************************************************/
+void
+Msa :: readFasta(const std::string & fname, const std::vector<int> & sample)
+{
+	ProfileScope phase("read");
+	/* Open file */
+	if (Options::Get().verbose){
+		std::cout << "Read Multiple Alignment in " << fname << "\n";
+	}
+	source = MappedFile(fname);
+	
+	/* Read file */
+	FastaReader reader(source, sample.empty() ? Options::Get().nb_seq : sample.back() + 1);
+	if (reader.size() == 0){
+		throw std::runtime_error("No sequence found in file " + fname);
+	}
+	std::vector<int> records = sample;
+	if (records.empty()){
+		for (int i(0); i < reader.size(); ++i){
+			records.push_back(i);
+		}
+	} else if (records.back() >= reader.size()){
+		throw std::runtime_error("No sequence " + std::to_string(records.back() + 1) + " in file " + fname);
+	}
+	nseq = static_cast<int>(records.size());
+	ncol = reader.getLength(records[0]);
+	for (int rec : records){
+		if (reader.getLength(rec) != ncol){
+			throw std::runtime_error("Sequence " + std::string(reader.getName(rec)) + " has " + std::to_string(reader.getLength(rec))
+				+ " symbols, expected " + std::to_string(ncol) + " as the first sequence of " + fname);
+		}
+	}
+	mali_seq.resize(static_cast<size_t>(nseq) * ncol);
+	for (int i(0); i < nseq; ++i){
+		mali_name.push_back(reader.getName(records[i]));
+		reader.copySequence(records[i], mali_seq.data() + static_cast<size_t>(i) * ncol);
+	}
+}
+
+
+/**************************************************************
+ * analyse() finds everything the statistics need in the
+ * sequences just read in mali_seq, which is freed once they
+ * are encoded in col_codes.
+ **************************************************************/
+void
+Msa :: analyse()
+{
+	ProfileScope phase("analyse");
+	{
+		ProfileScope alphabet_phase("alphabet");
+		defineAlphabet();
+	}
+	{
+		ProfileScope encode_phase("encode");
+		encodeColumns();
+		std::vector<char>().swap(mali_seq);	// every symbol is in col_codes now
+	}
+	{
+		ProfileScope count_phase("count");
+		countGap();
+		countFreq();
+		countType();
+	}
+	ProfileScope entropy_phase("entropy");
+	countEntropy();
+}
+
+
 /**************************************************************
  * countGap() calculate the number of gaps in each column
  **************************************************************/
 void
 Msa :: countGap(){
+	std::vector<char> is_gap = gap_mask(alphabet);
 	for(int col(0); col < ncol; ++col){
+		const uint8_t * codes = getColCodes(col);
 		int gap = 0;
 		for(int row(0); row < nseq; ++row){
-			if (mali_seq[row][col] == '-' || mali_seq[row][col] == ' '){
-				gap++;
-			}
+			gap += is_gap[codes[row]];
 		}
 		gap_counts.push_back(gap);
 	}
@@ -156,19 +248,20 @@ void
 Msa :: countFreq(){
 	int total = 0;
 	std::vector<int> tmp_freq(alphabet.size(), 0);
+	std::vector<char> is_gap = gap_mask(alphabet);
 	
 	aa_freq = std::vector<float>(alphabet.size());
 	/* Count the number of each amino acid type defined in alphabet */
+	int K = static_cast<int>(alphabet.size());
+	const std::vector<int> & counts = getCounts();
 	for(int col(0); col < ncol; ++col){
-		for(int row(0); row < nseq; ++row){
-			if (mali_seq[row][col] != '-' && mali_seq[row][col] != ' '){
-				total++;
-			}
-			int pos = alpha_index[static_cast<unsigned char>(mali_seq[row][col])];
-			if (pos < 0){
-				throw std::runtime_error("symbol is not in the alphabet");
-			}
-			tmp_freq[pos]++;
+		for (int a(0); a < K; ++a){
+			tmp_freq[a] += counts[col * K + a];
+		}
+	}
+	for (int a(0); a < static_cast<int>(alphabet.size()); ++a){
+		if (!is_gap[a]){
+			total += tmp_freq[a];
 		}
 	}
 
@@ -186,11 +279,15 @@ Msa :: countFreq(){
 void
 Msa :: countType(){
 	std::string aa_types;
+	std::vector<char> seen(alphabet.size());
 	for(int col(0); col < ncol; ++col){
+		const uint8_t * codes = getColCodes(col);
 		aa_types.clear();
+		fill(seen.begin(), seen.end(), 0);
 		for(int row(0); row < nseq; ++row){
-			if (aa_types.find(mali_seq[row][col]) >= aa_types.size()){
-			  aa_types.push_back(mali_seq[row][col]);
+			if (!seen[codes[row]]){
+				seen[codes[row]] = 1;
+			  aa_types.push_back(alphabet[codes[row]]);
 			}
 		}
 		aa_type_list.push_back(aa_types);
@@ -200,22 +297,36 @@ Msa :: countType(){
 
 /**************************************************************
  * defineAlphabet() reads the multiple alignment to
- * determine all the symbols used in
+ * determine all the symbols used in.
+ * Symbols are sorted by their first occurrence when the
+ * alignment is read column by column. The buffer is scanned
+ * row by row (the order it is stored in), keeping for each
+ * symbol the smallest column-major position it appears at.
  **************************************************************/
 void
 Msa :: defineAlphabet(){
-	alphabet.clear();
-	array<bool,256> seen;
-	seen.fill(false);
-	for(int col(0); col < ncol; ++col){
-		for(int row(0); row < nseq; ++row){
-			unsigned char c = mali_seq[row][col];
-			if (!seen[c]){
-				seen[c] = true;
-				alphabet.push_back(static_cast<char>(c));
+	const size_t never = static_cast<size_t>(-1);
+	array<size_t,256> first;
+	first.fill(never);
+	for(int row(0); row < nseq; ++row){
+		const char * seq = mali_seq.data() + static_cast<size_t>(row) * ncol;
+		for(int col(0); col < ncol; ++col){
+			unsigned char c = seq[col];
+			size_t key = static_cast<size_t>(col) * nseq + row;
+			if (key < first[c]){
+				first[c] = key;
 			}
 		}
 	}
+	alphabet.clear();
+	for (int c(0); c < 256; ++c){
+		if (first[c] != never){
+			alphabet.push_back(static_cast<char>(c));
+		}
+	}
+	sort(alphabet.begin(), alphabet.end(), [&first](char a, char b){
+		return first[static_cast<unsigned char>(a)] < first[static_cast<unsigned char>(b)];
+	});
 	rebuildAlphaIndex();
 }
 
@@ -232,6 +343,34 @@ Msa :: rebuildAlphaIndex(){
 	}
 }
 
+/**************************************************************
+ * encodeColumns() transposes the alignment (mali_seq) into col_codes:
+ * the alphabet position of every symbol, stored column after
+ * column, so that a whole column can be read sequentially
+ * and used directly as an index in a per-symbol histogram.
+ * The transposition goes by square tiles so that both the
+ * rows read and the columns written stay in cache.
+ **************************************************************/
+void
+Msa :: encodeColumns(){
+	const int tile = 64;
+	col_codes.resize(static_cast<size_t>(ncol) * nseq);
+	for (int r0(0); r0 < nseq; r0 += tile){
+		int r1 = std::min(r0 + tile, nseq);
+		for (int c0(0); c0 < ncol; c0 += tile){
+			int c1 = std::min(c0 + tile, ncol);
+			for (int row(r0); row < r1; ++row){
+				const char * seq = mali_seq.data() + static_cast<size_t>(row) * ncol;
+				for (int col(c0); col < c1; ++col){
+					col_codes[static_cast<size_t>(col) * nseq + row] = static_cast<uint8_t>(alpha_index[static_cast<unsigned char>(seq[col])]);
+				}
+			}
+		}
+	}
+	code_matrix = col_codes.data();
+	chunk_end   = ncol;
+}
+
 
 /**************************************************************
  * getFreq(aa) returns the frequency of amino acid aa
@@ -277,12 +416,11 @@ Msa :: getGap(int col){
 void 
 Msa :: countEntropy(){
 	entropy = std::vector<float>(ncol,0.0);
+	int K = static_cast<int>(alphabet.size());
+	const std::vector<int> & counts = getCounts();
  
   for(int col(0); col < ncol; ++col){
-		std::vector<float> lfreq(alphabet.size(), 0.0);
-		for(int row(0); row < nseq; ++row){
-			lfreq[getAaPos(mali_seq[row][col])] += 1.0;
-		}
+		std::vector<float> lfreq(counts.begin() + col * K, counts.begin() + (col + 1) * K);
 		for (float & f : lfreq){
 		  f /= static_cast<float>(nseq);
 			if (f > 0.0){
@@ -316,8 +454,9 @@ std::string
 Msa :: getCol(int col) const
 {
   std::string column;
+	const uint8_t * codes = getColCodes(col);
 	for (int i(0); i < nseq; ++i){
-		column.push_back(mali_seq[i][col]);
+		column.push_back(alphabet[codes[i]]);
 	}
 	return column;
 }
@@ -335,25 +474,14 @@ Msa :: fitToAlphabet(const std::string & alph1){
 		allowed[static_cast<unsigned char>(alph1[i])] = true;
 	}
 
+	/* Symbols of the alignment outside alph1 (gaps excepted) */
 	std::string removed_symbols;
-	array<bool,256> seen_removed;
-	seen_removed.fill(false);
-	for (int i(0); i < nseq; ++i){
-		for (int j(0); j < ncol; ++j){
-			const char symbol = mali_seq[i][j];
-			if (symbol == '-' || symbol == ' '){
-				continue;
-			}
-			const unsigned char c = static_cast<unsigned char>(symbol);
-			if (!allowed[c]){
-				mali_seq[i][j] = '-';
-				if (!seen_removed[c]){
-					seen_removed[c] = true;
-					removed_symbols.push_back(symbol);
-				}
-			}
+	for (char symbol : alphabet){
+		if (symbol != '-' && symbol != ' ' && !allowed[static_cast<unsigned char>(symbol)]){
+			removed_symbols.push_back(symbol);
 		}
 	}
+	const std::string old_alphabet = alphabet;
 
 	for (size_t i(0); i < removed_symbols.size(); ++i){
 		const char symbol = removed_symbols[i];
@@ -369,7 +497,38 @@ Msa :: fitToAlphabet(const std::string & alph1){
 			}
 		}
 	}
+	/* Removed symbols became gaps: the gap must be part of the alphabet
+	 * for them to be encoded, even if the alignment had none before. */
+	if (!removed_symbols.empty() && alphabet.find('-') == std::string::npos){
+		alphabet.push_back('-');
+	}
 	rebuildAlphaIndex();
+
+	/* Re-encode the columns with the new alphabet: the removed symbols
+	 * become gaps, the others move to their new position */
+	std::array<uint8_t,256> recode;
+	for (size_t a(0); a < old_alphabet.size(); ++a){
+		int pos = alpha_index[static_cast<unsigned char>(old_alphabet[a])];
+		recode[a] = static_cast<uint8_t>(pos >= 0 ? pos : alpha_index['-']);
+	}
+	if (isChunked()){
+		/* The chunks are encoded when loaded: recode the symbols instead */
+		for (uint8_t & code : symbol_code){
+			code = code < old_alphabet.size() ? recode[code] : code;
+		}
+		code_matrix = nullptr;
+		chunk_begin = chunk_end = 0;
+	} else {
+		size_t size = static_cast<size_t>(ncol) * nseq;
+		col_codes.resize(size);	// a copy, if the matrix was in the mapped cache
+		for (size_t i(0); i < size; ++i){
+			col_codes[i] = recode[code_matrix[i]];
+		}
+		code_matrix = col_codes.data();
+	}
+	/* Profiles are indexed by alphabet position: recount them */
+	col_counts_computed  = false;
+	col_wcounts_computed = false;
 }
 
 
@@ -391,21 +550,23 @@ Msa :: printBasic(){
 		file << dictionary[a] << " ";
 	}
 	file << "\n";
-	for (int col(0); col < ncol; col++){
-		for (int seq(0); seq < nseq; seq++){
-			int pos = static_cast<int>(dictionary.find(mali_seq[seq][col]));
-			if (pos < static_cast<int>(dictionary.size())){
-				counts[pos]++;
-			} else {
-				cerr << mali_seq[seq][col] << " is not in the dictionary\n";
+	forColumnChunks([&](int col_begin, int col_end){
+		for (int col(col_begin); col < col_end; col++){
+			for (int seq(0); seq < nseq; seq++){
+				int pos = static_cast<int>(dictionary.find(getSymbol(seq, col)));
+				if (pos < static_cast<int>(dictionary.size())){
+					counts[pos]++;
+				} else {
+					cerr << getSymbol(seq, col) << " is not in the dictionary\n";
+				}
 			}
+			for (int a(0); a < static_cast<int>(dictionary.size()); a++) {
+				file << counts[a] << " ";
+				counts[a] = 0;
+			}
+			file << "\n";
 		}
-		for (int a(0); a < static_cast<int>(dictionary.size()); a++) {
-			file << counts[a] << " ";
-			counts[a] = 0;
-		}
-		file << "\n";
-	}
+	});
 	file.close();
 }
 
@@ -429,30 +590,150 @@ Msa :: printBasic(){
  * from several statistics) cost nothing after the first one.
  **************************************************************/
 const std::vector<float> &
-Msa :: getSeqWeights(){
+Msa :: getHenikoffWeights(){
 	if (seq_weight_computed){
 		return seq_weight;
 	}
 	
-	seq_weight = std::vector<float>(nseq, 0.0);
-	std::vector<int> col_count(alphabet.size(), 0);
-	
-	for (int col(0); col < ncol; ++col){
-		fill(col_count.begin(), col_count.end(), 0);
-		for (int seq(0); seq < nseq; ++seq){
-			col_count[getAaPos(mali_seq[seq][col])]++;
-		}
-		int k = nb_type[col];
-		for (int seq(0); seq < nseq; ++seq){
-			int n = col_count[getAaPos(mali_seq[seq][col])];
-			seq_weight[seq] += 1.0 / (float) (n * k);
-		}
-	}
+	ProfileScope phase("weights");
+	int K = static_cast<int>(alphabet.size());
+	const std::vector<int> & counts = getCounts();
+	std::vector<double> sums(nseq, 0.0);
+	forColumnChunks([&](int col_begin, int col_end){
+		addWeightTerms(sums, col_begin, col_end, &counts[static_cast<size_t>(col_begin) * K], K);
+	});
+	seq_weight.resize(nseq);
 	for (int seq(0); seq < nseq; ++seq){
-		seq_weight[seq] /= static_cast<float>(ncol);
+		seq_weight[seq] = static_cast<float>(sums[seq] / ncol);
 	}
 	
 	seq_weight_computed = true;
 	return seq_weight;
 }
 
+
+/**************************************************************
+ * getSeqWeights() returns the weights the statistics use:
+ * the Henikoff weights, the identity weights with --weights
+ * identity (see msa_identity.cpp), or 1 / nseq for every
+ * sequence with --weights none.
+ **************************************************************/
+const std::vector<float> &
+Msa :: getSeqWeights(){
+	if (Options::Get().weights == "identity"){
+		return getIdentityWeights();
+	}
+	if (Options::Get().weights == "none"){
+		uniform_weight.assign(nseq, 1.0f / nseq);
+		return uniform_weight;
+	}
+	return getHenikoffWeights();
+}
+
+
+/**************************************************************
+ * addWeightTerms() adds the terms 1 / (k_x n_{x,i}) of the
+ * columns [begin, end), loaded, to the sums of the sequences.
+ * The terms of each column are computed once per code, then
+ * the sequences are split between the threads: each one adds
+ * its terms column after column, in double, so that the sums
+ * are the same whatever the number of threads (and the same
+ * in memory and by chunks of columns).
+ **************************************************************/
+void
+Msa :: addWeightTerms(std::vector<double> & sums, int begin, int end, const int * counts, int width) const
+{
+	std::vector<double> terms(static_cast<size_t>(end - begin) * width, 0.0);
+	for (int col(begin); col < end; ++col){
+		const int * n = counts + static_cast<size_t>(col - begin) * width;
+		double * term = &terms[static_cast<size_t>(col - begin) * width];
+		for (int code(0); code < width; ++code){
+			if (n[code] > 0){
+				term[code] = 1.0 / (static_cast<double>(n[code]) * nb_type[col]);
+			}
+		}
+	}
+	ParallelFor(0, nseq, [&](int seq_begin, int seq_end){
+		for (int col(begin); col < end; ++col){
+			const uint8_t * codes = getColCodes(col);
+			const double * term = &terms[static_cast<size_t>(col - begin) * width];
+			for (int seq(seq_begin); seq < seq_end; ++seq){
+				sums[seq] += term[codes[seq]];
+			}
+		}
+	});
+}
+
+
+
+/**************************************************************
+ * getCounts() counts the symbols of every column:
+ *   counts[col * K + a] = n_{col,a}
+ * with K the size of the alphabet. One sequential pass over
+ * the encoded columns, O(nseq*ncol), cached like
+ * getSeqWeights(): every statistic reads the same table.
+ **************************************************************/
+const std::vector<int> &
+Msa :: getCounts(){
+	if (col_counts_computed){
+		return col_counts;
+	}
+	
+	ProfileScope phase("counts");
+	int K = static_cast<int>(alphabet.size());
+	col_counts.assign(static_cast<size_t>(ncol) * K, 0);
+	forColumnChunks([&](int chunk_first, int chunk_last){
+		ParallelFor(chunk_first, chunk_last, [&](int col_begin, int col_end){
+			for (int col(col_begin); col < col_end; ++col){
+				const uint8_t * codes = getColCodes(col);
+				int * count = &col_counts[static_cast<size_t>(col) * K];
+				for (int seq(0); seq < nseq; ++seq){
+					count[codes[seq]]++;
+				}
+			}
+		});
+	});
+	
+	col_counts_computed = true;
+	return col_counts;
+}
+
+
+/**************************************************************
+ * getWeightedCounts() sums the sequence weights by symbol in
+ * every column:
+ *   wcounts[col * K + a] = p_{col,a} = \sum_{i | s_i(col) = a} w_i
+ * with w_i the weights of getSeqWeights(), those of -W
+ * (Henikoff, identity or uniform). This is the weighted
+ * probability p_a used by wentropy, trident, jensen and
+ * sumofpairs, computed for all symbols in one pass
+ * over each column instead of one pass per symbol.
+ * The weights are added in sequence order, as those
+ * statistics used to do, so the sums are the same floats
+ * (columns are split between the threads, never a column).
+ **************************************************************/
+const std::vector<float> &
+Msa :: getWeightedCounts(){
+	if (col_wcounts_computed){
+		return col_wcounts;
+	}
+	
+	ProfileScope phase("weighted counts");
+	const std::vector<float> & w = getSeqWeights();
+	int K = static_cast<int>(alphabet.size());
+	col_wcounts.assign(static_cast<size_t>(ncol) * K, 0.0f);
+	forColumnChunks([&](int chunk_first, int chunk_last){
+		ParallelFor(chunk_first, chunk_last, [&](int col_begin, int col_end){
+			for (int col(col_begin); col < col_end; ++col){
+				const uint8_t * codes = getColCodes(col);
+				float * wcount = &col_wcounts[static_cast<size_t>(col) * K];
+				for (int seq(0); seq < nseq; ++seq){
+					wcount[codes[seq]] += w[seq];
+				}
+			}
+		});
+	});
+	
+	col_wcounts_computed = true;
+	return col_wcounts;
+}
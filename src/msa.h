@@ -22,23 +22,49 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
+
+#include "fasta.h"
+#include "simd.h"
 
 class Msa
 {
 protected:
 	std::string alphabet;
 	std::array<int,256> alpha_index;	/**< alpha_index[static_cast<unsigned char>(c)] = position of c in `alphabet`, or -1. O(1) replacement for alphabet.find(c) */
-	std::vector<std::string> mali_name;			/**< Name of sequences of the multiple alignment */
-	std::vector<std::string> mali_seq;			/**< Sequences of the multiple alignment */
+	MappedFile source;									/**< Memory mapping of the input file, mali_name points into it */
+	MappedFile cache;										/**< Memory mapping of the .msx cache file the msa was loaded from (see -C), if any */
+	std::vector<std::string_view> mali_name;	/**< Name of sequences of the multiple alignment */
+	std::vector<char> mali_seq;						/**< Sequences of the multiple alignment, row after row in one buffer (size = nseq * ncol), only kept until encoded in col_codes */
+	std::vector<uint8_t> col_codes;				/**< Position in `alphabet` of every symbol, column after column in one buffer (size = ncol * nseq) */
+	const uint8_t * code_matrix;					/**< col_codes.data(), or the same matrix inside the mapped cache file */
+	int chunk_begin;										/**< First column in code_matrix (0 unless the alignment is read by chunks) */
+	int chunk_end;											/**< Column after the last one in code_matrix */
+	int chunk_size;											/**< Number of columns loaded at a time (see --max-memory) */
+	std::unique_ptr<FastaReader> rows;			/**< Sequences of `source`, when the alignment is read by chunks of columns (see --max-memory) */
+	std::vector<size_t> row_pos;					/**< Offset in `source` of the next residue of each sequence to load */
+	std::array<uint8_t,256> symbol_code;		/**< Position in `alphabet` of each symbol, used to encode the chunks */
 	std::vector<std::string> aa_type_list;	/**< List of aa type in each column (size = ncol * 20) */
 	std::vector<int>    gap_counts;		/**< Number of gaps in each column */
 	std::vector<float>  aa_freq;				/**< Frequency of amino acids types in the overall multiple alignment */
 	std::vector<float>  entropy;				/**< Entropy of each column of the multiple alignment */
 	std::vector<int>    nb_type;				/**< Number of amino acid types in the column */
-	std::vector<float>  seq_weight;		/**< Cache for the Henikoff & Henikoff sequence weights, see getSeqWeights() */
+	std::vector<float>  seq_weight;		/**< Cache for the Henikoff & Henikoff sequence weights, see getHenikoffWeights() */
 	bool           seq_weight_computed;
+	std::vector<float>  identity_weight;	/**< Cache for the identity cluster weights, see getIdentityWeights() */
+	bool           identity_weight_computed;
+	float          neff;						/**< Effective number of sequences of the identity weights */
+	std::vector<float>  uniform_weight;	/**< 1 / nseq for every sequence, the weights of --weights none */
+	SimdLevel      simd = BestSimdLevel();	/**< Code path of the pairwise identities, see setSimdLevel() */
+	std::vector<int>    col_counts;		/**< Cache for getCounts() (size = ncol * alphabet size) */
+	bool           col_counts_computed;
+	std::vector<float>  col_wcounts;		/**< Cache for getWeightedCounts() (size = ncol * alphabet size) */
+	bool           col_wcounts_computed;
 	
 	int nseq;											/**< Number of sequences in the multiple alignment */
 	int ncol;											/**< Number of columns in the multiple alignment */
@@ -49,9 +75,20 @@ protected:
 	void countEntropy();					/**< Calculate the entropy of each column in the multiple alignment */
 	void defineAlphabet();				/**< Define the alphabet used in the multiple alignment */
 	void rebuildAlphaIndex();		/**< Rebuild alpha_index to match the current `alphabet` string */
+	void encodeColumns();				/**< Build col_codes from mali_seq and the current `alphabet` string */
+	void readFasta(const std::string & fname, const std::vector<int> & sample);		/**< Read the sequences of the multi-fasta file fname (those of sample, or the first -n ones) in mali_seq */
+	void analyse();							/**< Find the alphabet, encode the columns, and count gaps, frequencies, types and entropy */
+	void streamFasta(const std::string & fname);		/**< Read and analyse the multi-fasta file fname by chunks of columns */
+	void loadColumns(int begin, int end, bool encode);	/**< Load the columns [begin, end) of the sequences in col_codes, as raw symbols or encoded */
+	void addWeightTerms(std::vector<double> & sums, int begin, int end, const int * counts, int width) const;	/**< Add the Henikoff terms of the loaded columns [begin, end) to sums, counts[(col - begin) * width + code] being n_{col,code} */
+	bool loadCache(const std::string & fname);		/**< Load the analysed alignment from the cache of fname, false if there is no valid cache */
+	void saveCache(const std::string & fname);		/**< Save the analysed alignment in the cache of fname */
 	
 public:
 	explicit Msa(const std::string & fname);
+	Msa(const std::string & fname, const std::vector<int> & sample);	/**< Read only the sequences of fname at the (increasing) positions of sample, see --tolerance */
+	static std::string CacheName(const std::string & fname) {return fname + ".msx";};	/**< Name of the cache file of the alignment file fname (see -C) */
+	static bool IsCacheName(const std::string & fname);	/**< Whether fname is a cache file, or a cache file being written */
 	~Msa() = default;
 	
 	int   getAaPos(char aa) const;		/**< Converts a char in his position in alphabet */
@@ -64,16 +101,25 @@ public:
 	int   nbGap(int col) const {return gap_counts[col];};	/**< Returns the number of gaps in column col */
 	bool  isInclude(const std::string & alph1) const;												/**< True if the alphabet of the multiple alignment is included in the alphabet alph1 */
 	
-	std::string getCol(int col) const;																/**< Returns a column as a string */
+	std::string getCol(int col) const;																/**< Returns a column as a string (see forColumnChunks()) */
 	std::string getAlphabet() const{return alphabet;};					/**< Returns the alphabet of the msa */
 	
-	char getSymbol(int seq, int col){return mali_seq[seq][col];};	/**< Return symbol row seq, column col */
+	char getSymbol(int seq, int col) const {return alphabet[getColCodes(col)[seq]];};	/**< Return symbol row seq, column col (see forColumnChunks()) */
+	const uint8_t * getColCodes(int col) const {return code_matrix + static_cast<size_t>(col - chunk_begin) * nseq;};	/**< Return the nseq alphabet positions of column col, contiguous (valid until the alphabet changes, see forColumnChunks()) */
+	bool isChunked() const {return rows != nullptr;};		/**< True if the alignment is read by chunks of columns (see --max-memory) */
+	void forColumnChunks(const std::function<void(int,int)> & body);	/**< Call body(begin, end) on consecutive ranges of columns covering the alignment, the symbols of the range being loaded */
 	int getNtype(int col){return nb_type[col];};									/**< Return the number of different amino acids in the column col */
-	std::string getTypeList(int col){return aa_type_list[col];};				/**< Return the list of amino acid types in the column col */
+	const std::string & getTypeList(int col) const {return aa_type_list[col];};	/**< Return the list of amino acid types in the column col */
 	
 	void fitToAlphabet(const std::string & alph1);																		/**< if a symbol of the msa is not in alphabet alph1, then it is changed in a gap '-' */
 	void printBasic();
 	
-	const std::vector<float> & getSeqWeights();		/**< Henikoff & Henikoff (1994) sequence weights, computed once in O(nseq*ncol) and cached */
+	const std::vector<float> & getSeqWeights();		/**< The sequence weights of --weights (Henikoff by default, or identity, or uniform), summing to 1 */
+	const std::vector<float> & getHenikoffWeights();	/**< Henikoff & Henikoff (1994) sequence weights, computed once in O(nseq*ncol) and cached */
+	const std::vector<float> & getIdentityWeights();	/**< 1 / number of sequences at --identity or more of each sequence, normalized to sum to 1, computed once in O(nseq^2*ncol) and cached */
+	float getNeff();							/**< Effective number of sequences: the sum of the identity weights before normalization */
+	void setSimdLevel(SimdLevel level){simd = level; identity_weight_computed = false;};	/**< Force the code path of the pairwise identities (tests, benchmarks) */
+	const std::vector<int> &   getCounts();				/**< [col * K + a] = number of alphabet[a] in column col, computed once in O(nseq*ncol) and cached */
+	const std::vector<float> & getWeightedCounts();	/**< [col * K + a] = sum of the weights of the sequences with alphabet[a] in column col, computed once in O(nseq*ncol) and cached */
 };
 
@@ -0,0 +1,314 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**************************************************************
+ * The .msx cache file (-C/--cache) of an alignment file X is
+ * X.msx: the analysed alignment, as Msa holds it once read,
+ * so that later runs skip both the reading and the analysis.
+ *
+ * All numbers are in the byte order of the machine that wrote
+ * the file (checked on load). The file is a header followed
+ * by sections, each one starting at a multiple of 8 bytes:
+ *
+ *   header     MsxHeader (see below)
+ *   alphabet   K chars
+ *   names      nseq uint32 lengths, then the names, one after the other
+ *   gaps       ncol int32, gaps in each column
+ *   types      ncol int32 (number of types in each column),
+ *              then the type lists, one after the other
+ *   frequency  K float, frequency of each symbol
+ *   entropy    ncol float, entropy of each column
+ *   weights    nseq float, Henikoff sequence weights
+ *   codes      ncol * nseq uint8, the col_codes matrix
+ *
+ * The codes matrix is used in place, in the memory mapping of
+ * the file: only the O(ncol + nseq) summaries are copied.
+ *
+ * The cache is only used when it was written from a file of
+ * the same size and modification time as the alignment file,
+ * with the same -n/--nb_seq; otherwise (or if it cannot be
+ * read) the alignment is read again and the cache rewritten.
+ **************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "msa.h"
+#include "options.h"
+#include "profile.h"
+
+namespace {
+
+const char     MSX_MAGIC[4]   = {'M', 'S', 'X', '\0'};
+const uint32_t MSX_VERSION    = 2;	/* 2: Henikoff weights added up in double */
+const uint32_t MSX_BYTE_ORDER = 0x01020304;
+
+struct MsxHeader
+{
+	char     magic[4];
+	uint32_t version;
+	uint32_t byte_order;
+	int32_t  max_seq;        /**< -n/--nb_seq the alignment was read with */
+	uint64_t source_size;    /**< Size of the alignment file */
+	int64_t  source_mtime;   /**< Modification time of the alignment file, in ns */
+	int32_t  nseq;
+	int32_t  ncol;
+	int32_t  alphabet_size;
+	int32_t  reserved;
+};
+
+/* Size and modification time of the alignment file */
+bool source_stamp(const std::string & fname, uint64_t & size, int64_t & mtime)
+{
+	struct stat st;
+	if (stat(fname.c_str(), &st) != 0){
+		return false;
+	}
+	size  = static_cast<uint64_t>(st.st_size);
+	mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+	return true;
+}
+
+/* Writes the sections in a file, each one 8-byte aligned */
+class SectionWriter
+{
+	std::ofstream & file;
+public:
+	explicit SectionWriter(std::ofstream & f) : file(f) {}
+	void add(const void * data, size_t size)
+	{
+		static const char padding[8] = {0};
+		file.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+		file.write(padding, static_cast<std::streamsize>((8 - size % 8) % 8));
+	}
+	template <typename T>
+	void add(const std::vector<T> & v) {add(v.data(), v.size() * sizeof(T));}
+};
+
+/* Reads the sections back, checking they are inside the file */
+class SectionReader
+{
+	const char * data;
+	size_t size;
+	size_t pos;
+public:
+	SectionReader(const char * d, size_t s, size_t start) : data(d), size(s), pos(start) {}
+	const char * next(size_t bytes)
+	{
+		if (bytes > size || pos > size - bytes){
+			throw std::runtime_error("truncated cache file");
+		}
+		const char * section = data + pos;
+		pos += bytes + (8 - bytes % 8) % 8;
+		return section;
+	}
+	template <typename T>
+	void next(std::vector<T> & v, size_t n)
+	{
+		const char * section = next(n * sizeof(T));
+		v.resize(n);
+		std::memcpy(v.data(), section, n * sizeof(T));
+	}
+};
+
+} // namespace
+
+
+/**************************************************************
+ * IsCacheName(fname): X.msx, or X.msx.tmp<pid> while
+ * saveCache() writes it
+ **************************************************************/
+bool
+Msa :: IsCacheName(const std::string & fname)
+{
+	const std::string suffix = CacheName("");
+	std::string::size_type pos = fname.rfind(suffix);
+	if (pos == std::string::npos){
+		return false;
+	}
+	return pos + suffix.size() == fname.size() || fname.compare(pos + suffix.size(), 4, ".tmp") == 0;
+}
+
+
+/**************************************************************
+ * loadCache(fname) loads the analysed alignment from the
+ * cache of fname. Returns false, leaving the msa empty, when
+ * there is no cache or it does not match the alignment file.
+ **************************************************************/
+bool
+Msa :: loadCache(const std::string & fname)
+{
+	ProfileScope phase("load cache");
+	uint64_t size;
+	int64_t mtime;
+	if (!source_stamp(fname, size, mtime)){
+		return false;
+	}
+	std::string cache_fname = CacheName(fname);
+	MappedFile file;
+	try {
+		file = MappedFile(cache_fname);
+	} catch (std::runtime_error &) {
+		return false;
+	}
+
+	MsxHeader header;
+	if (file.size() < sizeof(header)){
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, MSX_MAGIC, sizeof(MSX_MAGIC)) != 0 || header.version != MSX_VERSION
+	    || header.byte_order != MSX_BYTE_ORDER || header.max_seq != Options::Get().nb_seq
+	    || header.source_size != size || header.source_mtime != mtime
+	    || header.nseq <= 0 || header.ncol <= 0 || header.alphabet_size <= 0 || header.alphabet_size > 256){
+		return false;
+	}
+
+	try {
+		int K = header.alphabet_size;
+		nseq = header.nseq;
+		ncol = header.ncol;
+		SectionReader reader(file.data(), file.size(), sizeof(header));
+
+		alphabet.assign(reader.next(K), K);
+		std::vector<uint32_t> name_length;
+		reader.next(name_length, nseq);
+		size_t names_size = 0;
+		for (uint32_t length : name_length){
+			names_size += length;
+		}
+		const char * names = reader.next(names_size);
+		mali_name.clear();
+		for (uint32_t length : name_length){
+			mali_name.push_back(std::string_view(names, length));
+			names += length;
+		}
+
+		reader.next(gap_counts, ncol);
+		reader.next(nb_type, ncol);
+		size_t types_size = 0;
+		for (int n : nb_type){
+			if (n < 0 || n > K){
+				throw std::runtime_error("bad type count");
+			}
+			types_size += n;
+		}
+		const char * types = reader.next(types_size);
+		aa_type_list.clear();
+		for (int n : nb_type){
+			aa_type_list.push_back(std::string(types, n));
+			types += n;
+		}
+
+		reader.next(aa_freq, K);
+		reader.next(entropy, ncol);
+		reader.next(seq_weight, nseq);
+		code_matrix = reinterpret_cast<const uint8_t *>(reader.next(static_cast<size_t>(ncol) * nseq));
+
+		/* A damaged matrix must not index the profiles out of bounds */
+		uint8_t max_code = 0;
+		for (size_t i(0); i < static_cast<size_t>(ncol) * nseq; ++i){
+			max_code = std::max(max_code, code_matrix[i]);
+		}
+		if (max_code >= K){
+			throw std::runtime_error("bad symbol code");
+		}
+	} catch (std::runtime_error &) {
+		mali_name.clear();
+		gap_counts.clear();
+		nb_type.clear();
+		aa_type_list.clear();
+		code_matrix = nullptr;
+		return false;
+	}
+
+	if (Options::Get().verbose){
+		std::cout << "Read Multiple Alignment in " << cache_fname << "\n";
+	}
+	seq_weight_computed = true;
+	rebuildAlphaIndex();
+	cache = std::move(file);	// keeps the mapping of mali_name and code_matrix
+	return true;
+}
+
+
+/**************************************************************
+ * saveCache(fname) writes the cache of fname, the sequence
+ * weights included (they are computed here if needed).
+ * The file is written under a temporary name then renamed,
+ * so another run never maps a half-written cache. Failing to
+ * write it is not an error: the next run reads the alignment.
+ **************************************************************/
+void
+Msa :: saveCache(const std::string & fname)
+{
+	MsxHeader header;
+	std::memcpy(header.magic, MSX_MAGIC, sizeof(MSX_MAGIC));
+	header.version       = MSX_VERSION;
+	header.byte_order    = MSX_BYTE_ORDER;
+	header.max_seq       = Options::Get().nb_seq;
+	header.nseq          = nseq;
+	header.ncol          = ncol;
+	header.alphabet_size = static_cast<int32_t>(alphabet.size());
+	header.reserved      = 0;
+	if (!source_stamp(fname, header.source_size, header.source_mtime)){
+		return;
+	}
+
+	const std::vector<float> & weights = getHenikoffWeights();
+	std::string cache_fname = CacheName(fname);
+	std::string tmp_fname = cache_fname + ".tmp" + std::to_string(getpid());
+	std::ofstream file(tmp_fname.c_str(), std::ios::binary);
+	SectionWriter writer(file);
+	writer.add(&header, sizeof(header));
+	writer.add(alphabet.data(), alphabet.size());
+	std::vector<uint32_t> name_length;
+	std::string names;
+	for (std::string_view name : mali_name){
+		name_length.push_back(static_cast<uint32_t>(name.size()));
+		names.append(name);
+	}
+	writer.add(name_length);
+	writer.add(names.data(), names.size());
+	writer.add(gap_counts);
+	writer.add(nb_type);
+	std::string types;
+	for (const std::string & list : aa_type_list){
+		types += list;
+	}
+	writer.add(types.data(), types.size());
+	writer.add(aa_freq);
+	writer.add(entropy);
+	writer.add(weights);
+	writer.add(code_matrix, static_cast<size_t>(ncol) * nseq);
+	file.close();
+	if (!file || std::rename(tmp_fname.c_str(), cache_fname.c_str()) != 0){
+		std::remove(tmp_fname.c_str());
+		std::cerr << "Warning: cannot write the cache file " << cache_fname << "\n";
+	}
+}
@@ -0,0 +1,203 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**************************************************************
+ * The identity sequence weights (-W/--weights identity), as
+ * HHblits or PSICOV weight the sequences of an alignment:
+ *   w_i = 1 / c_i
+ * with c_i the number of sequences (i included) sharing at
+ * least -I/--identity of their columns with sequence i, gaps
+ * counting as symbols. Neff = sum_i w_i is the effective
+ * number of sequences; the weights the statistics read are
+ * w_i / Neff, so that they sum to 1 like the Henikoff ones.
+ *
+ * The O(nseq^2 * ncol) comparisons are the whole cost:
+ *  - the codes are copied row after row, each row padded with
+ *    zeros to a multiple of 32 bytes, so that two sequences
+ *    are compared 32 (AVX2) or 16 (SSE2) columns at a time:
+ *    equal bytes, then a popcount of their mask (AVX2) or
+ *    byte counters (SSE2);
+ *  - the sequences are cut in tiles of TILE rows, and a tile
+ *    is compared with the following tiles while its rows are
+ *    in the cache;
+ *  - the tiles are split between the threads, tile t being
+ *    compared with the ntile / 2 tiles after it (cyclically),
+ *    so that every tile costs the same. Each thread counts the
+ *    neighbours of its pairs, then adds them up to the totals:
+ *    integers, the same whatever the number of threads.
+ **************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#include "msa.h"
+#include "options.h"
+#include "profile.h"
+#include "thread_pool.h"
+
+namespace {
+
+const int PAD  = 32;		/* Rows are padded to a multiple of PAD bytes */
+const int TILE = 32;		/* Number of sequences of a tile */
+
+/* Number of equal bytes of a and b, n a multiple of PAD */
+int matches_scalar(const uint8_t * a, const uint8_t * b, int n)
+{
+	int matches = 0;
+	for (int k = 0; k < n; ++k){
+		matches += a[k] == b[k];
+	}
+	return matches;
+}
+
+#ifdef MSTATX_X86
+/* SSE2 has no popcount instruction: the equal bytes (-1) are counted
+ * in 16 byte counters instead, added up every 255 steps */
+int matches_sse(const uint8_t * a, const uint8_t * b, int n)
+{
+	__m128i sum = _mm_setzero_si128();
+	for (int k = 0; k < n; ){
+		__m128i counts = _mm_setzero_si128();
+		for (int end = std::min(n, k + 255 * 16); k < end; k += 16){
+			__m128i eq = _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(a + k)),
+			                            _mm_load_si128(reinterpret_cast<const __m128i *>(b + k)));
+			counts = _mm_sub_epi8(counts, eq);
+		}
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(counts, _mm_setzero_si128()));
+	}
+	return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sum, sum));
+}
+
+__attribute__((target("avx2,popcnt")))
+int matches_avx2(const uint8_t * a, const uint8_t * b, int n)
+{
+	int matches = 0;
+	for (int k = 0; k < n; k += 32){
+		__m256i eq = _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i *>(a + k)),
+		                               _mm256_load_si256(reinterpret_cast<const __m256i *>(b + k)));
+		matches += _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_epi8(eq)));
+	}
+	return matches;
+}
+#endif
+
+typedef int (*MatchKernel)(const uint8_t *, const uint8_t *, int);
+
+MatchKernel match_kernel(SimdLevel simd)
+{
+#ifdef MSTATX_X86
+	if (simd == SimdLevel::AVX2 && __builtin_cpu_supports("popcnt")){
+		return matches_avx2;
+	}
+	if (simd != SimdLevel::Scalar){
+		return matches_sse;
+	}
+#endif
+	return matches_scalar;
+}
+
+} // namespace
+
+
+/**************************************************************
+ * getIdentityWeights() computes the identity weights (see the
+ * top of this file) once, and caches them.
+ **************************************************************/
+const std::vector<float> &
+Msa :: getIdentityWeights(){
+	if (identity_weight_computed){
+		return identity_weight;
+	}
+	ProfileScope phase("identity weights");
+
+	int stride = (ncol + PAD - 1) / PAD * PAD;
+	std::vector<uint8_t> buffer(static_cast<size_t>(nseq) * stride + PAD, 0);
+	uint8_t * rows = buffer.data() + (PAD - reinterpret_cast<uintptr_t>(buffer.data()) % PAD) % PAD;	/* The first 32-byte aligned byte */
+	forColumnChunks([&](int col_begin, int col_end){
+		for (int col(col_begin); col < col_end; ++col){
+			const uint8_t * codes = getColCodes(col);
+			for (int seq(0); seq < nseq; ++seq){
+				rows[static_cast<size_t>(seq) * stride + col] = codes[seq];
+			}
+		}
+	});
+
+	/* Identity >= threshold <=> matches >= min_matches, the zeros of
+	 * the padding matching in every pair */
+	int min_matches = static_cast<int>(std::ceil(Options::Get().identity * static_cast<float>(ncol))) + (stride - ncol);
+	MatchKernel matches = match_kernel(simd);
+	int ntile = (nseq + TILE - 1) / TILE;
+	std::vector<int> neighbours(nseq, 1);
+	std::mutex mtx;
+	ParallelFor(0, ntile, [&](int tile_begin, int tile_end){
+		std::vector<int> local(nseq, 0);
+		for (int t(tile_begin); t < tile_end; ++t){
+			for (int d(0); d <= ntile / 2; ++d){
+				/* With an even number of tiles, the pair at distance
+				 * ntile / 2 is met from both ends: count it once */
+				if (d > 0 && 2 * d == ntile && t >= d){
+					continue;
+				}
+				int u = (t + d) % ntile;
+				int i_end = std::min(nseq, (t + 1) * TILE);
+				int j_end = std::min(nseq, (u + 1) * TILE);
+				for (int i(t * TILE); i < i_end; ++i){
+					const uint8_t * row = rows + static_cast<size_t>(i) * stride;
+					for (int j(d == 0 ? i + 1 : u * TILE); j < j_end; ++j){
+						if (matches(row, rows + static_cast<size_t>(j) * stride, stride) >= min_matches){
+							local[i]++;
+							local[j]++;
+						}
+					}
+				}
+			}
+		}
+		std::lock_guard<std::mutex> lock(mtx);
+		for (int seq(0); seq < nseq; ++seq){
+			neighbours[seq] += local[seq];
+		}
+	});
+
+	double sum = 0.0;
+	for (int seq(0); seq < nseq; ++seq){
+		sum += 1.0 / neighbours[seq];
+	}
+	neff = static_cast<float>(sum);
+	identity_weight.resize(nseq);
+	for (int seq(0); seq < nseq; ++seq){
+		identity_weight[seq] = static_cast<float>(1.0 / neighbours[seq] / sum);
+	}
+
+	identity_weight_computed = true;
+	return identity_weight;
+}
+
+
+/**************************************************************
+ * getNeff() returns the effective number of sequences of the
+ * identity weights, computing them if needed.
+ **************************************************************/
+float
+Msa :: getNeff(){
+	getIdentityWeights();
+	return neff;
+}
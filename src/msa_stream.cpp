@@ -0,0 +1,234 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/**************************************************************
+ * Reading by chunks of columns (--max-memory): the sequences
+ * stay in the memory-mapped file, and only the symbols of a
+ * range of columns, chunk_size * nseq bytes, are loaded at a
+ * time. Everything else Msa keeps is O(ncol * K + nseq).
+ *
+ * The alignment is analysed in two passes over the chunks:
+ *   1. the symbol counts, types and gaps of each column, and
+ *      the terms 1 / (k_x n_{x,i}) of the Henikoff weights
+ *      (streamFasta());
+ *   2. the weighted profiles, once the weights are complete
+ *      (getWeightedCounts(), through forColumnChunks()).
+ * Both add up the same floats, in the same order, as when the
+ * alignment is in memory: the results are identical.
+ **************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include "msa.h"
+#include "options.h"
+#include "thread_pool.h"
+
+namespace {
+
+/* Sequences copied together in a chunk, then transposed by column */
+const int ROW_TILE = 64;
+
+} // namespace
+
+
+/**************************************************************
+ * streamFasta() indexes the sequences of fname, then runs the
+ * first pass: each column gets its type list (in order of
+ * first appearance), counts, and gaps, and each sequence the
+ * weight terms of these columns. The alphabet is then built
+ * from the type lists, in the order defineAlphabet() gives it
+ * (first appearance, column after column).
+ **************************************************************/
+void
+Msa :: streamFasta(const std::string & fname)
+{
+	if (Options::Get().verbose){
+		std::cout << "Read Multiple Alignment in " << fname << " by chunks of columns\n";
+	}
+	source = MappedFile(fname);
+	rows.reset(new FastaReader(source, Options::Get().nb_seq));
+	if (rows->size() == 0){
+		throw std::runtime_error("No sequence found in file " + fname);
+	}
+	nseq = rows->size();
+	ncol = rows->getLength(0);
+	for (int i(0); i < nseq; ++i){
+		if (rows->getLength(i) != ncol){
+			throw std::runtime_error("Sequence " + std::string(rows->getName(i)) + " has " + std::to_string(rows->getLength(i))
+				+ " symbols, expected " + std::to_string(ncol) + " as the first sequence of " + fname);
+		}
+		mali_name.push_back(rows->getName(i));
+	}
+	double budget = Options::Get().max_memory * 1024.0 * 1024.0;
+	chunk_size = static_cast<int>(std::max(1.0, std::min(static_cast<double>(ncol), budget / nseq)));
+	row_pos.resize(nseq);
+
+	/* Pass 1: per column, the symbols (raw chars in the chunk), in
+	 * order of appearance, and how many times each one appears */
+	std::vector<std::vector<int> > type_counts(ncol);
+	aa_type_list.assign(ncol, std::string());
+	nb_type.assign(ncol, 0);
+	gap_counts.assign(ncol, 0);
+	std::vector<double> weight_sums(nseq, 0.0);
+	for (int c0(0); c0 < ncol; c0 += chunk_size){
+		int c1 = std::min(c0 + chunk_size, ncol);
+		loadColumns(c0, c1, false);
+		ParallelFor(c0, c1, [&](int col_begin, int col_end){
+			std::array<int,256> type_of;	// position of a char in the type list of the column, or -1
+			type_of.fill(-1);
+			for (int col(col_begin); col < col_end; ++col){
+				uint8_t * symbols = &col_codes[static_cast<size_t>(col - c0) * nseq];
+				std::string & types = aa_type_list[col];
+				std::vector<int> & counts = type_counts[col];
+				for (int seq(0); seq < nseq; ++seq){
+					int & type = type_of[symbols[seq]];
+					if (type < 0){
+						type = static_cast<int>(types.size());
+						types.push_back(static_cast<char>(symbols[seq]));
+						counts.push_back(0);
+					}
+					counts[type]++;
+					symbols[seq] = static_cast<uint8_t>(type);	// the weights only need the type
+				}
+				for (char c : types){
+					if (c == '-' || c == ' '){
+						gap_counts[col] += counts[type_of[static_cast<unsigned char>(c)]];
+					}
+				}
+				for (char c : types){
+					type_of[static_cast<unsigned char>(c)] = -1;
+				}
+				nb_type[col] = static_cast<int>(types.size());
+			}
+		});
+		/* Weight terms, the symbols of the chunk being their type in the column */
+		int width = *std::max_element(nb_type.begin() + c0, nb_type.begin() + c1);
+		std::vector<int> chunk_counts(static_cast<size_t>(c1 - c0) * width, 0);
+		for (int col(c0); col < c1; ++col){
+			std::copy(type_counts[col].begin(), type_counts[col].end(), chunk_counts.begin() + static_cast<size_t>(col - c0) * width);
+		}
+		addWeightTerms(weight_sums, c0, c1, chunk_counts.data(), width);
+	}
+	seq_weight.resize(nseq);
+	for (int seq(0); seq < nseq; ++seq){
+		seq_weight[seq] = static_cast<float>(weight_sums[seq] / ncol);
+	}
+	seq_weight_computed = true;
+
+	/* The alphabet, and the counts by alphabet position */
+	alphabet.clear();
+	for (const std::string & types : aa_type_list){
+		for (char c : types){
+			if (alphabet.find(c) == std::string::npos){
+				alphabet.push_back(c);
+			}
+		}
+	}
+	rebuildAlphaIndex();
+	symbol_code.fill(0);
+	for (int c(0); c < 256; ++c){
+		if (alpha_index[c] >= 0){
+			symbol_code[c] = static_cast<uint8_t>(alpha_index[c]);
+		}
+	}
+	int K = static_cast<int>(alphabet.size());
+	col_counts.assign(static_cast<size_t>(ncol) * K, 0);
+	for (int col(0); col < ncol; ++col){
+		for (int t(0); t < nb_type[col]; ++t){
+			col_counts[static_cast<size_t>(col) * K + alpha_index[static_cast<unsigned char>(aa_type_list[col][t])]] = type_counts[col][t];
+		}
+	}
+	col_counts_computed = true;
+	/* The chunk holds types now, not alphabet positions */
+	code_matrix = nullptr;
+	chunk_begin = chunk_end = 0;
+
+	countFreq();
+	countEntropy();
+}
+
+
+/**************************************************************
+ * loadColumns(begin, end, encode) loads the columns [begin,
+ * end) in col_codes, column after column, as the raw symbols
+ * or (encode) their alphabet positions. Chunks are loaded in
+ * column order from column 0: each sequence is read on from
+ * where the previous chunk stopped (row_pos).
+ **************************************************************/
+void
+Msa :: loadColumns(int begin, int end, bool encode)
+{
+	if (begin == 0){
+		for (int seq(0); seq < nseq; ++seq){
+			row_pos[seq] = rows->getBegin(seq);
+		}
+	}
+	int width = end - begin;
+	col_codes.resize(static_cast<size_t>(chunk_size) * nseq);
+	ParallelFor(0, nseq, [&](int seq_begin, int seq_end){
+		std::vector<char> tile(static_cast<size_t>(ROW_TILE) * width);
+		for (int r0(seq_begin); r0 < seq_end; r0 += ROW_TILE){
+			int r1 = std::min(r0 + ROW_TILE, seq_end);
+			for (int seq(r0); seq < r1; ++seq){
+				row_pos[seq] = rows->copyResidues(seq, row_pos[seq], width, &tile[static_cast<size_t>(seq - r0) * width]);
+			}
+			for (int col(0); col < width; ++col){
+				uint8_t * codes = &col_codes[static_cast<size_t>(col) * nseq];
+				for (int seq(r0); seq < r1; ++seq){
+					uint8_t c = static_cast<uint8_t>(tile[static_cast<size_t>(seq - r0) * width + col]);
+					codes[seq] = encode ? symbol_code[c] : c;
+				}
+			}
+		}
+	});
+	code_matrix = col_codes.data();
+	chunk_begin = begin;
+	chunk_end   = end;
+}
+
+
+/**************************************************************
+ * forColumnChunks(body) calls body(begin, end) on ranges of
+ * columns covering the alignment, in order, getSymbol() and
+ * getColCodes() being valid for the columns of the range.
+ * In memory, that is a single call on all the columns. Read
+ * by chunks, each chunk is loaded in turn (unless it is the
+ * only one and it is loaded already). body must not itself
+ * go through the chunks (getCounts()... when not computed).
+ **************************************************************/
+void
+Msa :: forColumnChunks(const std::function<void(int,int)> & body)
+{
+	if (!isChunked()){
+		body(0, ncol);
+		return;
+	}
+	for (int c0(0); c0 < ncol; c0 += chunk_size){
+		int c1 = std::min(c0 + chunk_size, ncol);
+		if (code_matrix == nullptr || chunk_begin != c0 || chunk_end != c1){
+			loadColumns(c0, c1, true);
+		}
+		body(c0, c1);
+	}
+}
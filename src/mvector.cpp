@@ -21,15 +21,143 @@
 
 #include "mvector.h"
 #include "options.h"
+#include "result_writer.h"
 #include "scoring_matrix.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
-#include <fstream>
-#include <iomanip>
 #include <stdexcept>
 
 using namespace std;
 
+namespace {
+
+/* Columns computed together: BLOCK x 24 floats of sums stay in registers */
+const int BLOCK = 4;
+
+/**************************************************************
+ * The kernels compute, for a block of BLOCK columns c,
+ *   sum[c * stride + a] = \sum_r profile[c * K + r] X_r[a]
+ * the count profile of the columns (number of each symbol of the
+ * matrix, K of them) times the normalized vectors X_r, rows of
+ * `stride` floats (see ScoringMatrix::getNormVector()).
+ *
+ * The code paths add the products in the same order (r = 0..K-1,
+ * skipping the symbols absent from a column) with no fused
+ * multiply-add, so that they give the same floats. STRIDE is the
+ * row length when known at compile time (0 otherwise).
+ **************************************************************/
+template <int STRIDE>
+void block_scalar(const float * profile, const ScoringMatrix & sm, float * sum)
+{
+	const int K = sm.getAlphabetSize();
+	const int n = STRIDE ? STRIDE : sm.getStride();
+	fill(sum, sum + BLOCK * n, 0.0f);
+	for (int r(0); r < K; ++r){
+		const float * X = sm.getNormVector(r);
+		for (int c(0); c < BLOCK; ++c){
+			float count = profile[c * K + r];
+			if (count != 0.0f){
+				for (int a(0); a < n; ++a){
+					sum[c * n + a] += count * X[a];
+				}
+			}
+		}
+	}
+}
+
+#ifdef MSTATX_X86
+template <int STRIDE>
+void block_sse(const float * profile, const ScoringMatrix & sm, float * sum)
+{
+	const int K = sm.getAlphabetSize();
+	const int n = STRIDE ? STRIDE : sm.getStride();
+	for (int a(0); a < n; a += 4){
+		__m128 acc[BLOCK];
+		for (int c(0); c < BLOCK; ++c){
+			acc[c] = _mm_setzero_ps();
+		}
+		for (int r(0); r < K; ++r){
+			__m128 X = _mm_load_ps(sm.getNormVector(r) + a);
+			for (int c(0); c < BLOCK; ++c){
+				float count = profile[c * K + r];
+				if (count != 0.0f){
+					acc[c] = _mm_add_ps(acc[c], _mm_mul_ps(_mm_set1_ps(count), X));
+				}
+			}
+		}
+		for (int c(0); c < BLOCK; ++c){
+			_mm_storeu_ps(sum + c * n + a, acc[c]);
+		}
+	}
+}
+
+template <int STRIDE>
+__attribute__((target("avx2")))
+void block_avx2(const float * profile, const ScoringMatrix & sm, float * sum)
+{
+	const int K = sm.getAlphabetSize();
+	const int n = STRIDE ? STRIDE : sm.getStride();
+	for (int a(0); a < n; a += 8){
+		__m256 acc[BLOCK];
+		for (int c(0); c < BLOCK; ++c){
+			acc[c] = _mm256_setzero_ps();
+		}
+		for (int r(0); r < K; ++r){
+			__m256 X = _mm256_load_ps(sm.getNormVector(r) + a);
+			for (int c(0); c < BLOCK; ++c){
+				float count = profile[c * K + r];
+				if (count != 0.0f){
+					acc[c] = _mm256_add_ps(acc[c], _mm256_mul_ps(_mm256_set1_ps(count), X));
+				}
+			}
+		}
+		for (int c(0); c < BLOCK; ++c){
+			_mm256_storeu_ps(sum + c * n + a, acc[c]);
+		}
+	}
+}
+#endif
+
+typedef void (*BlockKernel)(const float *, const ScoringMatrix &, float *);
+
+/* The kernel of the code path simd, for rows of stride floats */
+template <int STRIDE>
+BlockKernel block_kernel(SimdLevel simd)
+{
+#ifdef MSTATX_X86
+	if (simd == SimdLevel::AVX2){
+		return block_avx2<STRIDE>;
+	}
+	if (simd == SimdLevel::SSE){
+		return block_sse<STRIDE>;
+	}
+#endif
+	return block_scalar<STRIDE>;
+}
+
+BlockKernel block_kernel(SimdLevel simd, int stride)
+{
+	if (stride == ScoringMatrix::Stride(20)){
+		return block_kernel<ScoringMatrix::Stride(20)>(simd);
+	}
+	if (stride == ScoringMatrix::Stride(6)){
+		return block_kernel<ScoringMatrix::Stride(6)>(simd);
+	}
+	return block_kernel<0>(simd);
+}
+
+} // namespace
+
+/** calculate(Msa & msa)
+ *
+ * mean_col[a] = \frac{1}{N} \sum_{i} normScore(a, msa[i][col]), over the
+ * sequences whose symbol is in the matrix (a gap dilutes the mean).
+ * Grouping the sequences by symbol, this is the count profile of the
+ * column times the normalized matrix: O(L K^2), whatever N.
+ */
 void
 MVectStat :: calculate(Msa & msa)
 {
@@ -37,56 +165,90 @@ MVectStat :: calculate(Msa & msa)
 	int N = msa.getNseq();
 	
 	/* Get the scoring matrix */
-	ScoringMatrix score_mat(Options::Get().matrix_fname);
-	
-	/* Remove the unknown symbol from msa (consider them as gaps)*/
+	const ScoringMatrix & score_mat = ScoringMatrix::Get(Options::Get().matrix_fname);
 	sm_alphabet = score_mat.getAlphabet();
-	msa.fitToAlphabet(sm_alphabet);
-	
-	/* Calculate the mean vector for each column */
 	int K = static_cast<int>(sm_alphabet.size());
-	means = std::vector<std::vector<float> >(L);
+	int stride = score_mat.getStride();
 	
-	for (int col(0); col < L; col++) {
-		std::vector<float> mean_col(K, 0.0);
-		for (int seq(0); seq < N; ++seq) {
-			if (msa.getSymbol(seq,col) == '-'){
-				continue;
-			} else {
+	/* Row of the matrix of each symbol of the msa. Symbols unknown to
+	 * the matrix are considered as gaps (skipped), without modifying
+	 * the msa other statistics may still use */
+	string alphabet = msa.getAlphabet();
+	int msa_K = static_cast<int>(alphabet.size());
+	vector<int> row(msa_K, -1);
+	for (int k(0); k < msa_K; ++k){
+		if (alphabet[k] != '-' && sm_alphabet.find(alphabet[k]) != string::npos){
+			row[k] = score_mat.index(alphabet[k]);
+		}
+	}
+	
+	/* The counts of the symbols of each column, shared by all statistics
+	 * (computed by chunks of columns with --max-memory) */
+	const vector<int> & counts = msa.getCounts();
+	BlockKernel kernel = block_kernel(simd, stride);
+	
+	means = std::vector<std::vector<float> >(L);
+	int nblock = (L + BLOCK - 1) / BLOCK;
+	ParallelFor(0, nblock, [&](int block_begin, int block_end){
+		vector<float> profile(BLOCK * K);
+		vector<float> sum(BLOCK * stride);
+		for (int block(block_begin); block < block_end; ++block){
+			int col_begin = block * BLOCK;
+			int ncol = min(BLOCK, L - col_begin);
+			/* The profile of the last block is padded with empty columns */
+			fill(profile.begin(), profile.end(), 0.0f);
+			for (int c(0); c < ncol; ++c){
+				for (int k(0); k < msa_K; ++k){
+					if (row[k] >= 0){
+						profile[c * K + row[k]] += static_cast<float>(counts[(col_begin + c) * msa_K + k]);
+					}
+				}
+			}
+			kernel(profile.data(), score_mat, sum.data());
+			for (int c(0); c < ncol; ++c){
+				std::vector<float> mean_col(sum.begin() + c * stride, sum.begin() + c * stride + K);
 				for (int a(0); a < K; ++a) {
-					mean_col[a] += score_mat.normScore(sm_alphabet[a],msa.getSymbol(seq,col));
+					mean_col[a] /= static_cast<float>(N);
 				}
+				means[col_begin + c] = mean_col;
 			}
 		}
-		for (int a(0); a < K; ++a) {
-			mean_col[a] /= static_cast<float>(N);
-		}
-		means[col] = mean_col;
-	}
+	});
 }
 
 void
-MVectStat :: print(Msa & msa)
+MVectStat :: write(Msa & msa, const std::string & fname)
 {
-	/* Print the output */
-	std::ofstream file(Options::Get().output_fname.c_str());
-	if (!file.is_open()){
-		throw std::runtime_error("Cannot open file " + Options::Get().output_fname);
+	/* --format bin or npy: one row of K floats per column, the fields
+	 * named after the symbols of the matrix */
+	const std::string & format = Options::Get().format;
+	if (format != "text"){
+		std::vector<std::string> symbols;
+		for (char a : sm_alphabet){
+			symbols.push_back(std::string(1, a));
+		}
+		BinaryWriter file(fname, symbols, means.size(), format);
+		for (const std::vector<float> & mean_col : means){
+			for (float mean : mean_col){
+				file.add(mean);
+			}
+		}
+		file.close();
+		return;
 	}
+
+	/* Print the output: 3 significant digits on 10 characters */
+	TextWriter file(fname);
 	int K = static_cast<int>(sm_alphabet.size());
-	file.precision(3);
-	file << std::setw(10) << " ";
+	file << std::string(10, ' ');
 	for (int a(0); a < K; ++a) {
-		file.precision(3);
-		file << std::setw(10) << sm_alphabet[a];
+		file << std::string(9, ' ') << sm_alphabet[a];
 	}
 	file << "\n";
 	for (int col(0); col < static_cast<int>(means.size()); col++) {
-		file.precision(3);
-		file << setw(10) << col + 1;
-  	for (int a(0); a < K; ++a) {
-			file.precision(3);	
-			file << setw(10) << means[col][a];
+		file.put(col + 1, 10);
+		for (int a(0); a < K; ++a) {
+			file.put(means[col][a], 3, 10);
 		}
 		file << "\n";
 	}
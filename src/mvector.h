@@ -21,15 +21,19 @@
 
 #pragma once
 
+#include "simd.h"
 #include "statistic.h"
 
 class MVectStat  : public Statistic 
 {
 private:
 	std::string sm_alphabet;
+	SimdLevel simd = BestSimdLevel();	/**< Code path of the profile x matrix product */
 	std::vector<std::vector<float> > means; /**< mean vector of each columns (Size = nb columns * nb symbols in alphabet)*/
 public:
 	void calculate(Msa & msa) override;
-	void print(Msa & msa) override;
+	const std::vector<std::vector<float> > & getMeans() const {return means;};		/**< Return the mean vector of each column */
+	void setSimdLevel(SimdLevel level) {simd = level;};		/**< Use another code path (they all give the same results) */
+	void write(Msa & msa, const std::string & fname) override;
 };
 
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <string>
@@ -69,6 +70,9 @@ class Arg
 		bool   isNeeded()       const {return _needValue;};
 		bool   isSetted()       const {return _isSet;};
 
+		// Setter: an argument needed in general may become optional, given the others
+		void   setNeeded(bool needed) {_needValue = needed;};
+
 		/* The only one setter of the value is virtual because it depends
 		 * on the argument type */
 		virtual void setValue(const std::string & val){};
@@ -217,19 +221,6 @@ class Options
 			return opt;
 		}
 
-		// getEnvVar : Get an environment variable of name env
-		std::string getEnvVar(const std::string & env)
-		{
-			char * env_p;
-			std::string env_s;
-			env_p = getenv(env.c_str());
-			if (env_p != nullptr)
-				env_s = env_p;
-			else
-				std::cerr << "Warning: Environment variable " << env << " is not found\n";
-			return env_s;
-		}
-
 		// Reduce a pathname in a basename
 		std::string basename(const std::string & fname)
 		{
@@ -253,12 +244,6 @@ class Options
 				// Set the application name
 				appName = basename(argv[0]);
 
-				// Get the environment variable to find the scoring matrix
-				std::string smat_path = getEnvVar("SCORE_MAT_PATH");
-				if (smat_path.empty()) {
-					smat_path = "data/aaindex";
-					std::cerr << "SCORE_MAT_PATH is not set, use data/aaindex instead\n";
-				}
 				/*
 				 * 2 sorts of arguments can be added:
 				 *   - A ValueArg  which is for flags with values
@@ -270,19 +255,33 @@ class Options
 
 				//1 - create the argument as a ValueArg or SwitchArg.
 				ValueArg<std::string> iArg("-i", "--input",     "MSA input file name"                                    );
-				ValueArg<std::string> mArg("-m", "--matrix",    "Score matrix file name",   smat_path+"/HENS920102.mat");
-				ValueArg<std::string> oArg("-o", "--output",    "Output file name [default=ouput.txt]",      "output.txt");
-				ValueArg<std::string> sArg("-s", "--statistic", "Statistics [default=wentropy]",               "wentropy");
-				ValueArg<int>    nArg("-n", "--nb_seq",    "Maximum number of sequences read [default=500]",     500);
+				ValueArg<std::string> mArg("-m", "--matrix",    "Score matrix: built-in name (HENS920101-4, DNA, RNA), file name, or accession in -D [default=HENS920102]", "HENS920102");
+				ValueArg<std::string> DArg("-D", "--aaindex",   "AAindex2 database the -m accessions are read from [default=data/aaindex/aaindex2.txt]", "data/aaindex/aaindex2.txt");
+				ValueArg<std::string> oArg("-o", "--output",    "Output file name, or output directory with -B [default=output.txt, output with -B]", "output.txt");
+				ValueArg<std::string> FArg("-F", "--format",    "Output format: text, bin (a header, then the scores as a little-endian float32 table) or npy (a NumPy float32 array) [default=text]", std::string("text"));
+				ValueArg<std::string> sArg("-s", "--statistic", "Statistics, comma-separated list [default=wentropy]", "wentropy");
+				ValueArg<int>    nArg("-n", "--nb_seq",    "Maximum number of sequences read (first sample with -e) [default=500]", 500);
 				SwitchArg        vArg("-v", "--verbose",   "Verbose mode",                                     false);
 				SwitchArg        gArg("-g", "--global",    "Output the global score",                          false);
 				SwitchArg        hArg("-h", "--help",      "Print this help",                                  false);
 				ValueArg<float>  tArg("-t", "--threshold", "Threshold to print correlation [default=0.8]",       0.8);
+				ValueArg<std::string> PArg("-P", "--pairs", "Output of the pair statistics: threshold (pairs scoring -t or more), top (-K best pairs of each column), or matrix [default=threshold]", std::string("threshold"));
+				ValueArg<int>    KArg("-K", "--top",       "Number of pairs printed per column with --pairs top [default=10]", 10);
 				ValueArg<float>  aArg("-a", "--trident_a", "Factor applied to t(x) (see trident) [default=1.0]", 1.0);
 				ValueArg<float>  bArg("-b", "--trident_b", "Factor applied to r(x) (see trident) [default=0.5]", 0.5);
 				ValueArg<float>  cArg("-c", "--trident_c", "Factor applied to g(x) (see trident) [default=3.0]", 3.0);
-				ValueArg<int>    wArg("-w", "--window",    "Number of side columns (jensen score)",                3);
+				ValueArg<int>    wArg("-w", "--window",    "Number of side columns of each column smoothed by --smooth [default=3]", 3);
+				ValueArg<std::string> SArg("-S", "--smooth", "Smoothing of the column scores over -w side columns: none, mean, or capra (Capra & Singh 2007) [default=none]", std::string("none"));
 				ValueArg<std::string> kArg("-k", "--background", "Background distribution: uniform, legacy, or a file path (jensen score) [default=legacy]", std::string("legacy"));
+				ValueArg<int>    jArg("-j", "--threads",   "Number of threads computing the statistics [default=1]", 1);
+				SwitchArg        CArg("-C", "--cache",     "Load the analysed alignment from <input>.msx, or save it there", false);
+				ValueArg<float>  eArg("-e", "--tolerance", "Sample the sequences until no column score changes by more than this (0: read the first -n) [default=0]", 0.0);
+				ValueArg<float>  MArg("-M", "--max-memory", "Read the alignment by chunks of columns of at most this many MB, -C is then ignored (0: no limit) [default=0]", 0.0);
+				ValueArg<std::string> WArg("-W", "--weights", "Sequence weights: henikoff, identity (1 / size of the cluster of sequences above -I identity), or none [default=henikoff]", std::string("henikoff"));
+				ValueArg<float>  IArg("-I", "--identity",  "Identity threshold of the clusters of --weights identity [default=0.8]", 0.8);
+				ValueArg<std::string> BArg("-B", "--batch", "Manifest file or directory of MSA files, processed instead of -i (-o is then an output directory)", std::string(""));
+				ValueArg<std::string> pArg("-p", "--profile", "Print the time, CPU time and memory of each phase of the run, and write them in this JSON file", std::string(""));
+				ValueArg<std::string> TArg("-T", "--trace",   "Write the timeline of the phases and of the chunks of columns of each thread in this JSON file (Chrome trace event format)", std::string(""));
 
 				// 2 -  add the argument to the arg_list for further use (print_usage).
 				// Each entry is a heap-allocated clone of the argument's actual
@@ -290,34 +289,66 @@ class Options
 				// doesn't slice away its derived state.
 				arg_list[iArg.getSmallFlag()] = std::unique_ptr<Arg>(iArg.clone());
 				arg_list[mArg.getSmallFlag()] = std::unique_ptr<Arg>(mArg.clone());
+				arg_list[DArg.getSmallFlag()] = std::unique_ptr<Arg>(DArg.clone());
 				arg_list[oArg.getSmallFlag()] = std::unique_ptr<Arg>(oArg.clone());
+				arg_list[FArg.getSmallFlag()] = std::unique_ptr<Arg>(FArg.clone());
 				arg_list[sArg.getSmallFlag()] = std::unique_ptr<Arg>(sArg.clone());
 				arg_list[nArg.getSmallFlag()] = std::unique_ptr<Arg>(nArg.clone());
 				arg_list[vArg.getSmallFlag()] = std::unique_ptr<Arg>(vArg.clone());
 				arg_list[gArg.getSmallFlag()] = std::unique_ptr<Arg>(gArg.clone());
 				arg_list[hArg.getSmallFlag()] = std::unique_ptr<Arg>(hArg.clone());
 				arg_list[tArg.getSmallFlag()] = std::unique_ptr<Arg>(tArg.clone());
+				arg_list[PArg.getSmallFlag()] = std::unique_ptr<Arg>(PArg.clone());
+				arg_list[KArg.getSmallFlag()] = std::unique_ptr<Arg>(KArg.clone());
 				arg_list[aArg.getSmallFlag()] = std::unique_ptr<Arg>(aArg.clone());
 				arg_list[bArg.getSmallFlag()] = std::unique_ptr<Arg>(bArg.clone());
 				arg_list[cArg.getSmallFlag()] = std::unique_ptr<Arg>(cArg.clone());
 				arg_list[wArg.getSmallFlag()] = std::unique_ptr<Arg>(wArg.clone());
+				arg_list[SArg.getSmallFlag()] = std::unique_ptr<Arg>(SArg.clone());
 				arg_list[kArg.getSmallFlag()] = std::unique_ptr<Arg>(kArg.clone());
+				arg_list[jArg.getSmallFlag()] = std::unique_ptr<Arg>(jArg.clone());
+				arg_list[BArg.getSmallFlag()] = std::unique_ptr<Arg>(BArg.clone());
+				arg_list[CArg.getSmallFlag()] = std::unique_ptr<Arg>(CArg.clone());
+				arg_list[MArg.getSmallFlag()] = std::unique_ptr<Arg>(MArg.clone());
+				arg_list[eArg.getSmallFlag()] = std::unique_ptr<Arg>(eArg.clone());
+				arg_list[WArg.getSmallFlag()] = std::unique_ptr<Arg>(WArg.clone());
+				arg_list[IArg.getSmallFlag()] = std::unique_ptr<Arg>(IArg.clone());
+				arg_list[pArg.getSmallFlag()] = std::unique_ptr<Arg>(pArg.clone());
+				arg_list[TArg.getSmallFlag()] = std::unique_ptr<Arg>(TArg.clone());
 
 				// 3 - try to find the argument in the command line to set up the value.
 				hArg.find(command_line);
+				BArg.find(command_line);
+				if (!BArg.getValue().empty()){
+					iArg.setNeeded(false);  // the inputs are listed by --batch
+					oArg.setValue("output"); // -o is a directory, see RunBatch()
+				}
 				iArg.find(command_line);
 				mArg.find(command_line);
+				DArg.find(command_line);
 				oArg.find(command_line);
+				FArg.find(command_line);
 				sArg.find(command_line);
 				nArg.find(command_line);
 				vArg.find(command_line);
 				gArg.find(command_line);
 				tArg.find(command_line);
+				PArg.find(command_line);
+				KArg.find(command_line);
 				aArg.find(command_line);
 				bArg.find(command_line);
 				cArg.find(command_line);
 				wArg.find(command_line);
+				SArg.find(command_line);
 				kArg.find(command_line);
+				jArg.find(command_line);
+				CArg.find(command_line);
+				MArg.find(command_line);
+				eArg.find(command_line);
+				WArg.find(command_line);
+				IArg.find(command_line);
+				pArg.find(command_line);
+				TArg.find(command_line);
 
 				// If something is left in the command line... It is not an argument of the program -> error
 				if (command_line.size() > 0){
@@ -327,17 +358,82 @@ class Options
 				// Get arguments
 				input_fname  = iArg.getValue();
 				matrix_fname = mArg.getValue();
+				aaindex_fname = DArg.getValue();
 				output_fname = oArg.getValue();
+				format       = FArg.getValue();
 				statistic    = sArg.getValue();
+				statistics.clear();
+				std::istringstream stat_list(statistic);
+				std::string stat_name;
+				while (std::getline(stat_list, stat_name, ',')){
+					if (stat_name.empty()){
+						throw std::runtime_error("Empty statistic name in " + statistic + "\n");
+					}
+					statistics.push_back(stat_name);
+				}
 				nb_seq       = nArg.getValue();
 				verbose      = vArg.getValue();
 				global       = gArg.getValue();
 				threshold    = tArg.getValue();
+				pairs        = PArg.getValue();
+				top          = KArg.getValue();
 				factor_a     = aArg.getValue();
 				factor_b     = bArg.getValue();
 				factor_c     = cArg.getValue();
 				window       = wArg.getValue();
+				smooth       = SArg.getValue();
 				background   = kArg.getValue();
+				threads      = jArg.getValue();
+				batch        = BArg.getValue();
+				cache        = CArg.getValue();
+				max_memory   = MArg.getValue();
+				tolerance    = eArg.getValue();
+				weights      = WArg.getValue();
+				identity     = IArg.getValue();
+				profile      = pArg.getValue();
+				trace        = TArg.getValue();
+				if (threads < 1){
+					throw std::runtime_error("Number of threads must be at least 1\n");
+				}
+				if (max_memory < 0.0){
+					throw std::runtime_error("Maximum memory must not be negative\n");
+				}
+				if (tolerance < 0.0){
+					throw std::runtime_error("Tolerance must not be negative\n");
+				}
+				if (tolerance > 0.0 && nb_seq < 2){
+					throw std::runtime_error("The first sample (-n) must have at least 2 sequences\n");
+				}
+				if (tolerance > 0.0 && max_memory > 0.0){
+					throw std::runtime_error("The samples of -e are read whole: they cannot be used with -M\n");
+				}
+				if (pairs != "threshold" && pairs != "top" && pairs != "matrix"){
+					throw std::runtime_error("Unknown pair output " + pairs + " (threshold, top or matrix)\n");
+				}
+				if (top < 1){
+					throw std::runtime_error("The number of pairs per column (-K) must be at least 1\n");
+				}
+				if (format != "text" && format != "bin" && format != "npy"){
+					throw std::runtime_error("Unknown output format " + format + " (text, bin or npy)\n");
+				}
+				if (smooth != "none" && smooth != "mean" && smooth != "capra"){
+					throw std::runtime_error("Unknown smoothing " + smooth + " (none, mean or capra)\n");
+				}
+				if (window < 0){
+					throw std::runtime_error("The number of side columns (-w) must not be negative\n");
+				}
+				if (weights != "henikoff" && weights != "identity" && weights != "none"){
+					throw std::runtime_error("Unknown sequence weights " + weights + " (henikoff, identity or none)\n");
+				}
+				if (identity <= 0.0 || identity > 1.0){
+					throw std::runtime_error("Identity threshold must be in ]0, 1]\n");
+				}
+				if (weights == "identity" && max_memory > 0.0){
+					throw std::runtime_error("Identity weights compare whole sequences: they cannot be used with -M\n");
+				}
+				if (std::find(statistics.begin(), statistics.end(), "mi") != statistics.end() && max_memory > 0.0){
+					throw std::runtime_error("mi compares every pair of columns: it cannot be used with -M\n");
+				}
 			} catch (std::exception &e) {
 				throw;
 			}
@@ -346,18 +442,33 @@ class Options
 	public:
 		/* List of options */
 	std::string input_fname;  // The file name of the multiple alignment */
-	std::string matrix_fname; // The file name of the scoring matrix */
+	std::string matrix_fname; // The name of a built-in scoring matrix, its file name, or its accession in aaindex_fname */
+	std::string aaindex_fname; // The AAindex2 database the matrix accessions are read from */
 		std::string output_fname; // The name of the output file */
-		std::string statistic;    // The name of the statistic */
+		std::string format;       // Output format: "text", "bin" or "npy" */
+		std::string statistic;    // The name of the statistic, as given (comma-separated list) */
+		std::vector<std::string> statistics; // The names of the statistics, one per item of the list */
 		int    nb_seq;       // The number of sequences to read in the multiple alignment */
 		bool   verbose;      // The switch for verbose mode */
 		bool   global;       // The switch to output only the global alignment score */
 		float  threshold;    // The threshold for correlation print */
+		std::string pairs;   // Output of the pair statistics: "threshold", "top" or "matrix" */
+		int    top;          // The number of pairs printed per column with pairs = "top" */
 		float  factor_a;     // The factor applied to the first  member of trident score */
 		float  factor_b;     // The factor applied to the second member of trident score */
 		float  factor_c;     // The factor applied to the third  member of trident score */
-		int    window;       // The size of the window to take in account side columns (jensen stat only) */
+		int    window;       // The number of side columns, on each side, of a column smoothed by --smooth */
+		std::string smooth;  // Smoothing of the column scores: "none", "mean" or "capra" */
 	std::string background; // Background distribution: "uniform", "legacy", or a file path (jensen stat only) */
+		int    threads;      // The number of threads computing the statistics */
+		bool   cache;        // The switch to load/save the analysed alignment in a .msx cache file */
+		float  max_memory;   // The memory (MB) for the columns of the alignment loaded at a time (0: the whole alignment) */
+		float  tolerance;    // The largest change of a column score between two samples of the sequences (0: no sampling) */
+		std::string weights; // Sequence weights: "henikoff", "identity" or "none" */
+		float  identity;     // Identity threshold of the clusters of the identity weights */
+		std::string batch;   // Manifest file or directory listing the inputs of a batch (empty: single input) */
+		std::string profile; // JSON file of the --profile report (empty: no profiling) */
+		std::string trace;   // JSON file of the --trace timeline (empty: no tracing) */
 
 		/* Universal accessor */
 		static Options const & Get()
@@ -408,12 +519,14 @@ class Options
 			}
 			std::cerr << " [options]\n\n";
 			std::cerr << "Available statistics: \n";
-			std::cerr << "  wentropy (1)\n";
-			std::cerr << "  trident  (1)\n";
-			std::cerr << "  mvector  (1)\n";
-			std::cerr << "  jensen   (1)\n";
-			std::cerr << "  kabat    (1)\n";
-			std::cerr << "  gap      (1)\n";
+			std::cerr << "  wentropy   (1)\n";
+			std::cerr << "  trident    (1)\n";
+			std::cerr << "  mvector    (1)\n";
+			std::cerr << "  jensen     (1)\n";
+			std::cerr << "  kabat      (1)\n";
+			std::cerr << "  gap        (1)\n";
+			std::cerr << "  sumofpairs (1)\n";
+			std::cerr << "  mi         (2)\n";
 			std::cerr << "\nOptions:\n";
 			it = opt.arg_list.begin();
 			while (it != opt.arg_list.end()){
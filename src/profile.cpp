@@ -0,0 +1,379 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "profile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <sys/resource.h>
+
+namespace {
+
+/* Path of the innermost phase running in this thread ("" outside) */
+thread_local std::string current_path;
+thread_local int current_depth = 0;
+
+/* Buffer of the spans of this thread, see Tracer::threadBuffer() */
+thread_local Tracer::Buffer * trace_buffer = nullptr;
+
+/* s between double quotes, escaped for JSON */
+std::string json_string(const std::string & s)
+{
+	std::string quoted = "\"";
+	for (char c : s){
+		if (c == '"' || c == '\\'){
+			quoted += '\\';
+			quoted += c;
+		} else if (static_cast<unsigned char>(c) < 0x20){
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			quoted += escaped;
+		} else {
+			quoted += c;
+		}
+	}
+	return quoted + "\"";
+}
+
+/* x / seconds, 0 for a phase too short to be measured */
+double per_second(double x, double seconds)
+{
+	return seconds > 0.0 ? x / seconds : 0.0;
+}
+
+} // namespace
+
+
+Profiler :: Profiler() : enabled(false), cpu_start(0.0), nalign(0), nres(0), ncol(0)
+{
+}
+
+Profiler &
+Profiler :: Get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+double
+Profiler :: CpuSeconds()
+{
+	return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+double
+Profiler :: PeakRssMB()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0){
+		return 0.0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0);	// bytes
+#else
+	return usage.ru_maxrss / 1024.0;			// kilobytes
+#endif
+}
+
+void
+Profiler :: enable()
+{
+	enabled = true;
+	clear();
+}
+
+void
+Profiler :: clear()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	phases.clear();
+	nalign = 0;
+	nres = 0;
+	ncol = 0;
+	wall_start = std::chrono::steady_clock::now();
+	cpu_start = CpuSeconds();
+}
+
+/* The phases are listed when they start, so that a parent comes
+ * before its children */
+size_t
+Profiler :: startPhase(const std::string & path, int depth)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = std::find_if(phases.begin(), phases.end(), [&](const Phase & phase){return phase.path == path;});
+	if (it == phases.end()){
+		phases.push_back(Phase{path, depth, 0, 0.0, 0.0, 0.0});
+		it = phases.end() - 1;
+	}
+	it->calls++;
+	return it - phases.begin();
+}
+
+void
+Profiler :: stopPhase(size_t index, double wall, double cpu)
+{
+	double rss = PeakRssMB();
+	std::lock_guard<std::mutex> lock(mtx);
+	if (index >= phases.size()){
+		return;	// cleared while the phase was running
+	}
+	phases[index].wall += wall;
+	phases[index].cpu += cpu;
+	phases[index].peak_rss = std::max(phases[index].peak_rss, rss);
+}
+
+void
+Profiler :: addAlignment(int nseq, int ncol_aln)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	nalign++;
+	nres += static_cast<uint64_t>(nseq) * ncol_aln;
+	ncol += ncol_aln;
+}
+
+std::vector<Profiler::Phase>
+Profiler :: getPhases()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return phases;
+}
+
+
+/**************************************************************
+ * writeTable() prints a line per phase, the children after
+ * their parent and indented, then the total since enable().
+ * The throughputs are those of the residues and the columns
+ * of all the alignments (addAlignment()) over the wall-clock
+ * time of the phase.
+ **************************************************************/
+void
+Profiler :: writeTable(std::ostream & out)
+{
+	std::vector<Phase> rows = getPhases();
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	rows.push_back(Phase{"total", 0, 1, wall, CpuSeconds() - cpu_start, PeakRssMB()});
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "%-32s %6s %10s %10s %10s %12s %12s\n", "Phase", "Calls", "Wall (s)", "CPU (s)", "Peak (MB)", "Residues/s", "Columns/s");
+	out << line;
+	for (const Phase & phase : rows){
+		std::string name = std::string(2 * phase.depth, ' ') + phase.path.substr(phase.path.rfind('/') + 1);
+		std::snprintf(line, sizeof(line), "%-32s %6d %10.4f %10.4f %10.1f %12.4g %12.4g\n", name.c_str(), phase.calls, phase.wall, phase.cpu, phase.peak_rss,
+		              per_second(static_cast<double>(nres), phase.wall), per_second(static_cast<double>(ncol), phase.wall));
+		out << line;
+	}
+	std::snprintf(line, sizeof(line), "(%d alignment%s, %llu residues, %llu columns)\n", nalign, nalign > 1 ? "s" : "",
+	              static_cast<unsigned long long>(nres), static_cast<unsigned long long>(ncol));
+	out << line;
+}
+
+
+/**************************************************************
+ * writeJson() writes the same numbers in fname, for scripts:
+ *   {"command": ..., "alignments": ...,
+ *    "residues": ..., "columns": ..., "wall_s": ..., "cpu_s": ...,
+ *    "peak_rss_mb": ..., "residues_per_s": ..., "columns_per_s": ...,
+ *    "phases": [{"name": "analyse/count", "depth": 1, "calls": 1,
+ *                "wall_s": ..., "cpu_s": ..., "peak_rss_mb": ...,
+ *                "residues_per_s": ..., "columns_per_s": ...}, ...]}
+ * the totals being those of the run since enable().
+ **************************************************************/
+void
+Profiler :: writeJson(const std::string & fname, const std::string & command)
+{
+	std::vector<Phase> rows = getPhases();
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	double cpu = CpuSeconds() - cpu_start;
+
+	std::ofstream file(fname.c_str());
+	if (!file.is_open()){
+		throw std::runtime_error("Cannot open file " + fname);
+	}
+	file.precision(9);
+	auto numbers = [&](double wall_s, double cpu_s, double rss){
+		file << "\"wall_s\": " << wall_s << ", \"cpu_s\": " << cpu_s << ", \"peak_rss_mb\": " << rss
+		     << ", \"residues_per_s\": " << per_second(static_cast<double>(nres), wall_s)
+		     << ", \"columns_per_s\": " << per_second(static_cast<double>(ncol), wall_s);
+	};
+	file << "{\n  \"command\": " << json_string(command) << ",\n  \"alignments\": " << nalign
+	     << ", \"residues\": " << nres << ", \"columns\": " << ncol << ",\n  ";
+	numbers(wall, cpu, PeakRssMB());
+	file << ",\n  \"phases\": [";
+	for (size_t i(0); i < rows.size(); ++i){
+		file << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << json_string(rows[i].path) << ", \"depth\": " << rows[i].depth
+		     << ", \"calls\": " << rows[i].calls << ", ";
+		numbers(rows[i].wall, rows[i].cpu, rows[i].peak_rss);
+		file << "}";
+	}
+	file << "\n  ]\n}\n";
+	file.close();
+	if (!file){
+		throw std::runtime_error("Cannot write file " + fname);
+	}
+}
+
+
+Tracer :: Tracer() : enabled(false), origin(std::chrono::steady_clock::now())
+{
+}
+
+Tracer &
+Tracer :: Get()
+{
+	static Tracer tracer;
+	return tracer;
+}
+
+void
+Tracer :: enable()
+{
+	clear();
+	enabled = true;
+}
+
+void
+Tracer :: clear()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	for (auto & buffer : buffers){
+		buffer->spans.clear();
+	}
+	origin = std::chrono::steady_clock::now();
+}
+
+Tracer::Buffer &
+Tracer :: threadBuffer()
+{
+	if (!trace_buffer){
+		std::lock_guard<std::mutex> lock(mtx);
+		buffers.push_back(std::unique_ptr<Buffer>(new Buffer{static_cast<int>(buffers.size()) + 1, std::vector<Span>()}));
+		trace_buffer = buffers.back().get();
+	}
+	return *trace_buffer;
+}
+
+void
+Tracer :: add(const std::string & name, const char * category, const std::string & args, double start, double end)
+{
+	threadBuffer().spans.push_back(Span{name, category, args, start, end - start});
+}
+
+std::vector<Tracer::Buffer>
+Tracer :: getBuffers()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	std::vector<Buffer> copy;
+	for (auto & buffer : buffers){
+		copy.push_back(*buffer);
+	}
+	return copy;
+}
+
+
+/**************************************************************
+ * write() writes the spans as complete events ("ph": "X") of
+ * the Chrome trace event format, after a metadata event naming
+ * each thread:
+ *   {"traceEvents": [
+ *     {"name": "thread_name", "ph": "M", "pid": 1, "tid": 1, "args": {"name": "thread 1"}},
+ *     {"name": "read", "cat": "phase", "ph": "X", "ts": 12.5, "dur": 310.2, "pid": 1, "tid": 1},
+ *     {"name": "chunk", "cat": "chunk", "ph": "X", ..., "args": {"begin": 0, "end": 75}}, ...],
+ *    "displayTimeUnit": "ms"}
+ * the times in microseconds since enable(). To be called once
+ * the spans are over: the threads must not be adding any.
+ **************************************************************/
+void
+Tracer :: write(const std::string & fname)
+{
+	std::vector<Buffer> threads = getBuffers();
+	std::ofstream file(fname.c_str());
+	if (!file.is_open()){
+		throw std::runtime_error("Cannot open file " + fname);
+	}
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	file << "{\"traceEvents\": [";
+	bool first = true;
+	for (const Buffer & thread : threads){
+		file << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread.tid
+		     << ", \"args\": {\"name\": \"thread " << thread.tid << "\"}}";
+		first = false;
+		for (const Span & span : thread.spans){
+			file << ",\n{\"name\": " << json_string(span.name) << ", \"cat\": \"" << span.category << "\", \"ph\": \"X\", \"ts\": " << span.start
+			     << ", \"dur\": " << span.duration << ", \"pid\": 1, \"tid\": " << thread.tid;
+			if (!span.args.empty()){
+				file << ", \"args\": {" << span.args << "}";
+			}
+			file << "}";
+		}
+	}
+	file << "\n],\n\"displayTimeUnit\": \"ms\"}\n";
+	file.close();
+	if (!file){
+		throw std::runtime_error("Cannot write file " + fname);
+	}
+}
+
+
+void
+TraceScope :: addArg(const char * key, const std::string & value, bool quoted)
+{
+	args += (args.empty() ? "\"" : ", \"") + std::string(key) + "\": " + (quoted ? json_string(value) : value);
+}
+
+
+void
+ProfileScope :: start(const char * name_)
+{
+	name = name_;
+	path = current_path.empty() ? name : current_path + "/" + name;
+	depth = current_depth;
+	current_path = path;
+	current_depth++;
+	profiled = Profiler::Get().isEnabled();
+	if (profiled){
+		index = Profiler::Get().startPhase(path, depth);
+		cpu_start = Profiler::CpuSeconds();
+		wall_start = std::chrono::steady_clock::now();
+	}
+	traced = Tracer::Get().isEnabled();
+	if (traced){
+		trace_start = Tracer::Get().now();
+	}
+}
+
+void
+ProfileScope :: stop()
+{
+	if (profiled){
+		double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+		double cpu = Profiler::CpuSeconds() - cpu_start;
+		Profiler::Get().stopPhase(index, wall, cpu);
+	}
+	if (traced){
+		Tracer::Get().add(name, "phase", std::string(), trace_start, Tracer::Get().now());
+	}
+	current_depth--;
+	current_path = depth == 0 ? std::string() : path.substr(0, path.rfind('/'));
+}
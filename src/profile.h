@@ -0,0 +1,210 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Profiler (--profile) records the wall-clock time, the CPU time of the
+ * process (all its threads) and the peak resident memory of the phases
+ * of a run: reading the alignment, analysing it, computing the weights,
+ * loading the matrix, calculating and printing each statistic...
+ *
+ * A phase is a ProfileScope, named after what it does: the phases
+ * started within another one are its children ("analyse/count"), and
+ * the phases of the same name (e.g. the samples of --tolerance, the
+ * alignments of --batch) add up in one entry. With --batch, the phases
+ * of alignments processed at the same time overlap: their times add up
+ * to more than the total.
+ *
+ * A ProfileScope is also a span of the --trace timeline (see Tracer).
+ * When neither --profile nor --trace is given, it only checks two flags.
+ */
+class Profiler
+{
+public:
+	/** Time and memory of a phase, summed over its calls */
+	struct Phase
+	{
+		std::string path;     /**< Names of the phase and of its parents, '/'-separated */
+		int         depth;    /**< Number of parents */
+		int         calls;
+		double      wall;     /**< Seconds */
+		double      cpu;      /**< Seconds of CPU, all the threads together */
+		double      peak_rss; /**< Peak resident memory of the process at the end of the phase (MB) */
+	};
+
+protected:
+	bool               enabled;
+	std::chrono::steady_clock::time_point wall_start;	/**< When enable() was called */
+	double             cpu_start;
+	std::mutex         mtx;
+	std::vector<Phase> phases;    /**< In the order they started */
+	int                nalign;
+	uint64_t           nres;      /**< Residues of the alignments (nseq x ncol) */
+	uint64_t           ncol;
+
+	Profiler();
+
+public:
+	Profiler(const Profiler &) = delete;
+	Profiler & operator=(const Profiler &) = delete;
+
+	static Profiler & Get();		/**< The process-wide profiler */
+	static double CpuSeconds();		/**< CPU time used by the process so far */
+	static double PeakRssMB();		/**< Peak resident memory of the process so far */
+
+	void enable();		/**< Record the phases from now on */
+	bool isEnabled() const {return enabled;};
+	void clear();		/**< Forget the phases and the alignments recorded so far, and start the total again */
+
+	size_t startPhase(const std::string & path, int depth);	/**< Add a call of the phase path, returns its index (see ProfileScope) */
+	void stopPhase(size_t index, double wall, double cpu);	/**< Add the time of the call to the phase index */
+	void addAlignment(int nseq, int ncol);		/**< Count an alignment in the throughputs */
+	std::vector<Phase> getPhases();
+
+	void writeTable(std::ostream & out);		/**< Phases as a table: times, memory and throughputs, then the total since enable() */
+	void writeJson(const std::string & fname, const std::string & command);	/**< The same as a JSON object, throws std::runtime_error if fname cannot be written */
+};
+
+/**
+ * Tracer (--trace) records a timeline of the run: when each phase (see
+ * ProfileScope), each alignment of --batch and each chunk of columns of
+ * the threads (see ThreadPool) started and ended, in which thread. It
+ * is written in the Chrome trace event format, to be opened in
+ * chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Each thread adds its spans to its own buffer, so that the threads do
+ * not wait for each other while tracing. When --trace is not given, a
+ * span only checks a flag.
+ */
+class Tracer
+{
+public:
+	/** A span of the timeline */
+	struct Span
+	{
+		std::string name;
+		const char * category;	/**< "phase", "alignment" or "chunk" */
+		std::string args;		/**< Details, as the members of a JSON object ("" for none) */
+		double      start;		/**< Microseconds since enable() */
+		double      duration;	/**< Microseconds */
+	};
+
+	/** The spans of one thread */
+	struct Buffer
+	{
+		int               tid;	/**< 1 for the first thread that traced a span, then 2, 3... */
+		std::vector<Span> spans;
+	};
+
+protected:
+	bool     enabled;
+	std::chrono::steady_clock::time_point origin;	/**< When enable() was called */
+	std::mutex mtx;
+	std::deque<std::unique_ptr<Buffer> > buffers;	/**< One per thread, kept after the thread ends */
+
+	Tracer();
+	Buffer & threadBuffer();	/**< The buffer of the calling thread, created by its first span */
+
+public:
+	Tracer(const Tracer &) = delete;
+	Tracer & operator=(const Tracer &) = delete;
+
+	static Tracer & Get();		/**< The process-wide tracer */
+
+	void enable();		/**< Record the spans from now on */
+	bool isEnabled() const {return enabled;};
+	void clear();		/**< Forget the spans recorded so far (no span may be running) */
+
+	double now() const {return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();};	/**< Microseconds since enable() */
+	void add(const std::string & name, const char * category, const std::string & args, double start, double end);	/**< Add a span of the calling thread */
+	std::vector<Buffer> getBuffers();
+
+	void write(const std::string & fname);	/**< Spans in the Chrome trace event format, throws std::runtime_error if fname cannot be written */
+};
+
+/**
+ * TraceScope is a span of the --trace timeline that is not a phase of
+ * --profile, e.g. a chunk of columns processed by a thread (see Tracer).
+ * The details given by arg() are shown with the span.
+ */
+class TraceScope
+{
+protected:
+	bool         active;
+	const char * name;
+	const char * category;
+	std::string  args;
+	double       start;
+
+public:
+	TraceScope(const char * name_, const char * category_) : active(Tracer::Get().isEnabled()), name(name_), category(category_), start(0.0) {if (active) start = Tracer::Get().now();};
+	TraceScope(const TraceScope &) = delete;
+	TraceScope & operator=(const TraceScope &) = delete;
+	~TraceScope() {if (active) Tracer::Get().add(name, category, args, start, Tracer::Get().now());};
+
+	TraceScope & arg(const char * key, int value) {if (active) addArg(key, std::to_string(value), false); return *this;};
+	TraceScope & arg(const char * key, const std::string & value) {if (active) addArg(key, value, true); return *this;};
+
+private:
+	void addArg(const char * key, const std::string & value, bool quoted);
+};
+
+/**
+ * ProfileScope is a phase of the run, from its construction to its
+ * destruction (see Profiler), and a span of the timeline (see Tracer).
+ */
+class ProfileScope
+{
+protected:
+	bool        active;
+	bool        profiled;	/**< With --profile */
+	std::string name;
+	std::string path;
+	int         depth;
+	size_t      index;		/**< In the phases of the Profiler */
+	std::chrono::steady_clock::time_point wall_start;
+	double      cpu_start;
+	bool        traced;		/**< With --trace */
+	double      trace_start;
+
+public:
+	explicit ProfileScope(const char * name) : active(Profiler::Get().isEnabled() || Tracer::Get().isEnabled()) {if (active) start(name);};
+	explicit ProfileScope(const std::string & name) : ProfileScope(name.c_str()) {};
+	ProfileScope(const ProfileScope &) = delete;
+	ProfileScope & operator=(const ProfileScope &) = delete;
+	~ProfileScope() {if (active) stop();};
+
+private:
+	void start(const char * name);
+	void stop();
+};
@@ -0,0 +1,158 @@
+/* Copyright (c) 2012 Guillaume Collet
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE. 
+ */
+
+
+#include "result_writer.h"
+
+#include <stdexcept>
+
+namespace {
+
+const char     BIN_MAGIC[4]  = {'M', 'S', 'X', 'B'};
+const uint32_t BIN_VERSION   = 1;
+const char     NPY_MAGIC[8]  = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0};	/* Magic string, then version 1.0 */
+
+/* n in little-endian byte order, as sizeof(T) bytes appended to bytes */
+template <typename T>
+void append_le(std::string & bytes, T n)
+{
+	for (size_t i(0); i < sizeof(T); ++i){
+		bytes += static_cast<char>((n >> (8 * i)) & 0xff);
+	}
+}
+
+} // namespace
+
+
+TextWriter :: TextWriter(const std::string & name) : fname(name), buffer(SIZE), used(0)
+{
+	file.open(fname.c_str(), std::ios::binary);
+	if (!file.is_open()){
+		throw std::runtime_error("Cannot open file " + fname);
+	}
+}
+
+TextWriter :: ~TextWriter()
+{
+	if (file.is_open()){
+		file.write(buffer.data(), static_cast<std::streamsize>(used));
+	}
+}
+
+void
+TextWriter :: flush()
+{
+	file.write(buffer.data(), static_cast<std::streamsize>(used));
+	used = 0;
+}
+
+TextWriter &
+TextWriter :: write(const char * s, size_t n)
+{
+	if (used + n > buffer.size()){
+		flush();
+		if (n > buffer.size()){
+			file.write(s, static_cast<std::streamsize>(n));
+			return *this;
+		}
+	}
+	std::memcpy(buffer.data() + used, s, n);
+	used += n;
+	return *this;
+}
+
+TextWriter &
+TextWriter :: put(int n, size_t width)
+{
+	char number[MARGIN];
+	return pad(number, std::to_chars(number, number + MARGIN, n).ptr - number, width);
+}
+
+TextWriter &
+TextWriter :: put(float x, int precision, size_t width)
+{
+	char number[MARGIN];
+	return pad(number, std::to_chars(number, number + MARGIN, x, std::chars_format::general, precision).ptr - number, width);
+}
+
+TextWriter &
+TextWriter :: pad(const char * s, size_t n, size_t width)
+{
+	for (; n < width; --width){
+		*this << ' ';
+	}
+	return write(s, n);
+}
+
+void
+TextWriter :: close()
+{
+	flush();
+	file.close();
+	if (!file){
+		throw std::runtime_error("Cannot write file " + fname);
+	}
+}
+
+
+BinaryWriter :: BinaryWriter(const std::string & fname, const std::vector<std::string> & fields, uint64_t nrow, const std::string & format)
+	: out(fname), expected(nrow * fields.size()), count(0)
+{
+	std::string header;
+	if (format == "npy"){
+		/* The dictionary is padded with spaces so that the table starts
+		 * at a multiple of 64 bytes, as numpy writes it */
+		std::string dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + std::to_string(nrow) + ", " + std::to_string(fields.size()) + "), }";
+		size_t header_size = sizeof(NPY_MAGIC) + sizeof(uint16_t);
+		size_t offset = (header_size + dict.size() + 1 + 63) / 64 * 64;
+		dict.resize(offset - header_size - 1, ' ');
+		dict += "\n";
+		header.assign(NPY_MAGIC, sizeof(NPY_MAGIC));
+		append_le<uint16_t>(header, static_cast<uint16_t>(dict.size()));
+		header += dict;
+	} else {
+		std::string names;
+		for (size_t f(0); f < fields.size(); ++f){
+			names += (f == 0 ? "" : "\t") + fields[f];
+		}
+		names += "\n";
+		size_t header_size = sizeof(BIN_MAGIC) + 3 * sizeof(uint32_t) + sizeof(uint64_t);
+		size_t offset = (header_size + names.size() + 7) / 8 * 8;
+
+		header.assign(BIN_MAGIC, sizeof(BIN_MAGIC));
+		append_le<uint32_t>(header, BIN_VERSION);
+		append_le<uint32_t>(header, static_cast<uint32_t>(offset));
+		append_le<uint32_t>(header, static_cast<uint32_t>(fields.size()));
+		append_le<uint64_t>(header, nrow);
+		header += names;
+		header.resize(offset, '\0');
+	}
+	out << header;
+}
+
+void
+BinaryWriter :: close()
+{
+	out.close();
+	if (count != expected){
+		throw std::runtime_error("Incomplete binary table: " + std::to_string(count) + " floats written out of " + std::to_string(expected));
+	}
+}
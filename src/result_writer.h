@@ -0,0 +1,114 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * TextWriter prints the results in a file: the numbers are formatted
+ * by std::to_chars in a large buffer, written out when it is full,
+ * instead of going one by one through the locale and the formatting
+ * state of an ofstream. Floats are formatted as an ostream does by
+ * default (%g, 6 significant digits): the files are the same.
+ */
+class TextWriter
+{
+protected:
+	std::ofstream     file;
+	std::string       fname;
+	std::vector<char> buffer;	/**< Formatted text not written yet: buffer[0, used) */
+	size_t            used;
+
+	void reserve(size_t n) {if (used + n > buffer.size()) flush();};	/**< Make room for n more bytes (n <= MARGIN) */
+	void flush();			/**< Write the buffer out */
+	TextWriter & pad(const char * s, size_t n, size_t width);	/**< Write s[0, n) after spaces up to width characters */
+
+public:
+	static const size_t SIZE   = 1 << 20;	/**< Size of the buffer */
+	static const size_t MARGIN = 64;		/**< Room for one number */
+
+	explicit TextWriter(const std::string & fname);	/**< Open fname, throws std::runtime_error if it cannot */
+	TextWriter(const TextWriter &) = delete;
+	TextWriter & operator=(const TextWriter &) = delete;
+	~TextWriter();		/**< Write what is left, if close() was not called (errors are then ignored) */
+
+	TextWriter & operator<<(char c) {reserve(1); buffer[used++] = c; return *this;};
+	TextWriter & operator<<(const char * s) {return write(s, std::strlen(s));};
+	TextWriter & operator<<(const std::string & s) {return write(s.data(), s.size());};
+	TextWriter & operator<<(int n) {
+		reserve(MARGIN);
+		used = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), n).ptr - buffer.data();
+		return *this;
+	};
+	TextWriter & operator<<(float x) {
+		reserve(MARGIN);
+		used = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), x, std::chars_format::general, 6).ptr - buffer.data();
+		return *this;
+	};
+	TextWriter & write(const char * s, size_t n);
+	TextWriter & put(int n, size_t width);	/**< n right-aligned on width characters (as setw does) */
+	TextWriter & put(float x, int precision, size_t width);	/**< x with precision significant digits, right-aligned on width characters (as setw and precision do) */
+	void close();		/**< Write what is left and close the file, throws std::runtime_error if it could not be written */
+};
+
+/**
+ * BinaryWriter writes a table of float32, to be memory mapped rather
+ * than parsed. With --format bin:
+ *   magic    "MSXB"
+ *   version  uint32, 1
+ *   offset   uint32, position of the table in the file (a multiple of 8)
+ *   nfield   uint32, number of floats of a row
+ *   nrow     uint64, number of rows
+ *   names    the names of the fields, separated by '\t' and ended by
+ *            '\n', then '\0' up to offset
+ *   table    nrow * nfield float32, row after row
+ * all the numbers in little-endian byte order, whatever the machine.
+ * With --format npy, a NumPy .npy file (version 1.0) of a '<f4' array
+ * of shape (nrow, nfield) in C order: the names of the fields are not
+ * written, numpy.load(fname, mmap_mode='r') reads the table in place.
+ */
+class BinaryWriter
+{
+protected:
+	TextWriter out;		/**< Buffered output, used for raw bytes only */
+	uint64_t   expected;	/**< nrow * nfield */
+	uint64_t   count;		/**< Floats added so far */
+
+public:
+	BinaryWriter(const std::string & fname, const std::vector<std::string> & fields, uint64_t nrow, const std::string & format = "bin");	/**< Open fname and write the header of format (bin or npy), throws std::runtime_error if it cannot */
+	void add(float x) {
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		bits = __builtin_bswap32(bits);
+#endif
+		out.write(reinterpret_cast<const char *>(&bits), sizeof(bits));
+		count++;
+	};		/**< Add the next float of the table */
+	void close();		/**< Close the file, throws std::runtime_error if it could not be written or the table is not complete */
+};
@@ -0,0 +1,133 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+#include "fasta.h"
+#include "options.h"
+#include "profile.h"
+#include "sampling.h"
+
+namespace {
+
+const uint64_t SAMPLE_SEED = 20120101;
+
+} // namespace
+
+
+/**************************************************************
+ * SampleOrder
+ **************************************************************/
+std::vector<int>
+SampleOrder(int nrecords)
+{
+	std::mt19937_64 rng(SAMPLE_SEED);
+	std::vector<uint64_t> key(nrecords);
+	for (uint64_t & k : key){
+		k = rng();
+	}
+	std::vector<int> order(nrecords);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&key](int a, int b){
+		return key[a] < key[b];
+	});
+	return order;
+}
+
+
+/**************************************************************
+ * SampleAndCalculate reads the samples with Msa, keeping the
+ * sequences of each one in file order. Scores are compared
+ * between two consecutive samples; the loop stops once the
+ * largest change is within the tolerance, or when the sample
+ * is the whole file (the scores are then exact).
+ **************************************************************/
+std::unique_ptr<Msa>
+SampleAndCalculate(const std::string & fname, const std::vector<std::unique_ptr<Statistic> > & stats)
+{
+	int nrecords;
+	{
+		MappedFile file(fname);
+		nrecords = FastaReader(file, INT_MAX).size();
+	}
+	if (nrecords == 0){
+		throw std::runtime_error("No sequence found in file " + fname);
+	}
+	const std::vector<int> order = SampleOrder(nrecords);
+	float tolerance = Options::Get().tolerance;
+
+	std::unique_ptr<Msa> msa;
+	std::vector<std::vector<float> > previous(stats.size());
+	std::vector<std::vector<float> > error(stats.size());
+	int n = std::min(nrecords, Options::Get().nb_seq);
+	while (true){
+		std::vector<int> sample(order.begin(), order.begin() + n);
+		std::sort(sample.begin(), sample.end());
+		msa.reset(new Msa(fname, sample));
+
+		float max_error = 0.0;
+		for (size_t s(0); s < stats.size(); ++s){
+			ProfileScope phase("calculate " + Options::Get().statistics[s]);
+			stats[s]->calculate(*msa);
+			const Stat1D * stat = dynamic_cast<const Stat1D *>(stats[s].get());
+			if (!stat){
+				continue;
+			}
+			const std::vector<float> & score = stat->getColStat();
+			error[s].assign(score.size(), 0.0);
+			for (size_t col(0); col < score.size(); ++col){
+				if (n == nrecords){
+					error[s][col] = 0.0;	// every sequence is in: exact
+				} else if (previous[s].empty()){
+					error[s][col] = INFINITY;	// nothing to compare with yet
+				} else {
+					error[s][col] = std::fabs(score[col] - previous[s][col]);
+				}
+				max_error = std::max(max_error, error[s][col]);
+			}
+			previous[s] = score;
+		}
+		std::string report = "Sample of " + std::to_string(n) + " / " + std::to_string(nrecords) + " sequences";
+		if (!std::isinf(max_error)){
+			report += ", largest error " + std::to_string(max_error);
+		}
+		std::cout << report + "\n";
+		if (n == nrecords || max_error <= tolerance){
+			break;
+		}
+		n = static_cast<int>(std::min(static_cast<long>(nrecords), 2L * n));
+	}
+
+	for (size_t s(0); s < stats.size(); ++s){
+		Stat1D * stat = dynamic_cast<Stat1D *>(stats[s].get());
+		if (stat){
+			stat->setColError(error[s]);
+		}
+	}
+	return msa;
+}
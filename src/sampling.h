@@ -0,0 +1,57 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "msa.h"
+#include "statistic.h"
+
+/**
+ * Sampling mode (-e/--tolerance): instead of the first -n sequences,
+ * the statistics are computed on uniform random samples of all the
+ * sequences of the file, twice as large each time (starting with -n
+ * sequences), until no column score of a Stat1D changes by more than
+ * the tolerance from one sample to the next, or the sample holds every
+ * sequence.
+ *
+ * The samples are nested (each one contains the previous one), so the
+ * change of a column score between two of them, |s_n - s_2n|, estimates
+ * the standard error of s_2n: its variance is var(s_n) - var(s_2n),
+ * about var(s_2n) since the variance goes as 1/n. This change is kept
+ * as the error estimate of each column score and printed next to it;
+ * it is 0 when every sequence is in the last sample.
+ */
+
+/** Order in which the nrecords sequences of a file enter the samples:
+ *  every prefix of it is a uniform sample (without replacement) of the
+ *  records. Each record gets a random key as it is read, and records
+ *  are taken by increasing key, as a bottom-k reservoir would keep
+ *  them. The keys come from a fixed seed: runs are reproducible. */
+std::vector<int> SampleOrder(int nrecords);
+
+/** Compute stats on growing samples of the sequences of fname, until
+ *  they converge within --tolerance. The stats hold the scores (and,
+ *  for Stat1D, the error estimates) of the last sample, returned. */
+std::unique_ptr<Msa> SampleAndCalculate(const std::string & fname, const std::vector<std::unique_ptr<Statistic> > & stats);
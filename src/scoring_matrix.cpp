@@ -22,75 +22,191 @@
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "builtin_matrices.h"
 #include "options.h"
+#include "profile.h"
 #include "scoring_matrix.h"
 
-/** Constructor from a filename fname.
- *  Matrices are all in format defined by AAindex web site :
- *  http://www.genome.jp/aaindex/
- */
-ScoringMatrix :: ScoringMatrix(const std::string & fname)
+namespace {
+
+/* Size and modification time (in ns) of the file fname */
+bool file_stamp(const std::string & fname, uint64_t & size, int64_t & mtime)
 {
-  /* Open file */
-	if(fname.empty()){
-		throw std::runtime_error("score matrix file name is empty");
+	struct stat st;
+	if (stat(fname.c_str(), &st) != 0){
+		return false;
 	}
-	if (Options::Get().verbose){
-		std::cout << "Read Scoring Matrix in " << fname << "\n";
+	size  = static_cast<uint64_t>(st.st_size);
+	mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+	return true;
+}
+
+/**************************************************************
+ * The index of an AAindex2 database X (see -D/--aaindex) is
+ * X.idx, a text file giving the position of each entry:
+ *
+ *   aaindex2 <size> <mtime> <number of entries>
+ *   <accession> <offset of its "H <accession>" line>
+ *   ...
+ *
+ * It is only used when it was built from a database of the
+ * same size and modification time, and holds all its entries;
+ * otherwise the database is read once to build it again. It is
+ * written under a temporary name then renamed; failing to write
+ * it is not an error, the index is then kept in memory only.
+ **************************************************************/
+typedef std::map<std::string, std::streamoff> AaindexIndex;
+
+AaindexIndex read_index(const std::string & fname)
+{
+	AaindexIndex index;
+	uint64_t size;
+	int64_t mtime;
+	if (!file_stamp(fname, size, mtime)){
+		return index;
 	}
-	std::ifstream file(fname.c_str());
-	if (!file.good()){
-		throw std::runtime_error("Cannot open file " + fname);
+	const std::string idx_fname = fname + ".idx";
+	std::ifstream idx(idx_fname.c_str());
+	std::string magic;
+	uint64_t idx_size;
+	int64_t idx_mtime;
+	size_t nentries;
+	if (idx >> magic >> idx_size >> idx_mtime >> nentries && magic == "aaindex2" && idx_size == size && idx_mtime == mtime){
+		std::string accession;
+		std::streamoff offset;
+		while (idx >> accession >> offset){
+			index[accession] = offset;
+		}
+		if (index.size() == nentries){
+			return index;
+		}
+		index.clear();
 	}
 	
-	/* Read file */
-	std::string s;
-	getline(file,s);
-	while (file.good() && s[0] != 'M'){
-	  getline(file,s);
+	std::ifstream database(fname.c_str());
+	std::string line;
+	std::streamoff offset = database.tellg();
+	while (getline(database, line)){
+		if (line.compare(0, 2, "H ") == 0){
+			std::string accession;
+			std::istringstream(line.substr(2)) >> accession;
+			index[accession] = offset;
+		}
+		offset = database.tellg();
 	}
 	
-	/* Read Alphabet */
-	int alphabet_begin = static_cast<int>(s.find('=')) + 2;
-	int alphabet_size = static_cast<int>(s.find(',')) - alphabet_begin;
-	alphabet = s.substr(alphabet_begin,	alphabet_size);
-	
-	/* Allocate the matrix (triangular: row i holds i+1 values, since
-	 * score()/normScore() always access it with the larger index first) */
-	matrix.assign(alphabet_size, std::vector<float>());
+	std::string tmp_fname = idx_fname + ".tmp" + std::to_string(getpid());
+	std::ofstream out(tmp_fname.c_str());
+	out << "aaindex2 " << size << " " << mtime << " " << index.size() << "\n";
+	for (const auto & entry : index){
+		out << entry.first << " " << entry.second << "\n";
+	}
+	out.close();
+	if (!out || std::rename(tmp_fname.c_str(), idx_fname.c_str()) != 0){
+		std::remove(tmp_fname.c_str());
+		if (Options::Get().verbose){
+			std::cout << "Cannot write the index " << idx_fname << ", kept in memory\n";
+		}
+	}
+	return index;
+}
+
+/* Offset of the entry accession in the AAindex2 database fname, -1 if
+ * it has none (or cannot be read). Each database is indexed once per
+ * process, again only if it changes. */
+std::streamoff find_accession(const std::string & fname, const std::string & accession)
+{
+	struct Indexed
+	{
+		uint64_t size;
+		int64_t mtime;
+		AaindexIndex index;
+	};
+	static std::mutex mtx;
+	static std::map<std::string, Indexed> indexes;
+	std::lock_guard<std::mutex> lock(mtx);
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	file_stamp(fname, size, mtime);
+	Indexed & indexed = indexes[fname];
+	if (indexed.index.empty() || indexed.size != size || indexed.mtime != mtime){
+		indexed = Indexed{size, mtime, read_index(fname)};
+	}
+	auto entry = indexed.index.find(accession);
+	return entry == indexed.index.end() ? -1 : entry->second;
+}
+
+} // namespace
+
+/** Constructor from the name of a built-in matrix (see
+ *  builtin_matrices.h), or else from a filename, or else from
+ *  an accession of the AAindex2 database (see -D/--aaindex).
+ *  Matrices are all in format defined by AAindex web site :
+ *  http://www.genome.jp/aaindex/
+ */
+ScoringMatrix :: ScoringMatrix(const std::string & spec)
+{
+	if(spec.empty()){
+		throw std::runtime_error("score matrix file name is empty");
+	}
+	bool builtin = ForBuiltinMatrix(spec, [&](const auto & m){
+		if (Options::Get().verbose){
+			std::cout << "Use the built-in Scoring Matrix " << m.name << "\n";
+		}
+		alphabet = m.alphabet;
+		matrix.assign(alphabet.size(), std::vector<float>());
+		const float * value = m.values.data();
+		for (int i(0); i < static_cast<int>(alphabet.size()); ++i) {
+			matrix[i].assign(value, value + i + 1);
+			value += i + 1;
+		}
+	});
+	if (!builtin){
+		std::ifstream file(spec.c_str());
+		if (file.good()){
+			if (Options::Get().verbose){
+				std::cout << "Read Scoring Matrix in " << spec << "\n";
+			}
+			readEntry(file, spec);
+		} else {
+			/* Only the entry is read: the index gives its position */
+			const std::string & database = Options::Get().aaindex_fname;
+			std::streamoff offset = find_accession(database, spec);
+			if (offset < 0){
+				throw std::runtime_error("Cannot open file " + spec + " (nor a built-in matrix: " + BuiltinMatrixNames() + ", nor an accession of " + database + ")");
+			}
+			if (Options::Get().verbose){
+				std::cout << "Read Scoring Matrix " << spec << " in " << database << "\n";
+			}
+			std::ifstream entries(database.c_str());
+			entries.seekg(offset);
+			readEntry(entries, spec + " in " + database);
+		}
+	}
+	int alphabet_size = getAlphabetSize();
+	symbol_index.fill(-1);
 	for (int i(0); i < alphabet_size; ++i) {
-		matrix[i].assign(i + 1, 0.0f);
+		symbol_index[static_cast<unsigned char>(alphabet[i])] = i;
 	}
-	
-	
-	/* Read the matrix
-	 * Each row is whitespace-separated (the AAindex format pads its
-	 * columns to a fixed width, but that padding is not reliable enough
-	 * to parse on: a value that prints one character shorter than its
-	 * neighbours shifts every following fixed-width field on that row.
-	 * Tokenizing on whitespace works regardless of column width, and
-	 * also degrades gracefully on files from other matrix databases
-	 * that don't pad at all. */
 	min = 1000; max = -1000;
 	for (int i(0); i < alphabet_size; ++i) {
-		getline(file,s);
-		std::istringstream row_stream(s);
-		for (int j(0); j <=i ; j++){
-			if (!(row_stream >> matrix[i][j])){
-				throw std::runtime_error(
-					"malformed scoring matrix row for symbol '" + std::string(1, alphabet[i]) +
-					"': expected " + std::to_string(i + 1) + " values, could only read " + std::to_string(j));
-			}
-      if (matrix[i][j] < min)
-        min = matrix[i][j];
-      if (matrix[i][j] > max)
-        max = matrix[i][j];
+		for (int j(0); j <= i; j++){
+			if (matrix[i][j] < min)
+				min = matrix[i][j];
+			if (matrix[i][j] > max)
+				max = matrix[i][j];
 		}
 	}
 	
-	
 	/* Allocate the norm_matrix */
 	norm_matrix.assign(alphabet_size, std::vector<float>());
 	for (int i(0); i < alphabet_size; ++i) {
@@ -101,7 +217,38 @@ ScoringMatrix :: ScoringMatrix(const std::string & fname)
 	
 	for (int i(0); i < alphabet_size; ++i) {
 		for (int j(0); j <= i; ++j){
-			norm_matrix[i][j] = (score(alphabet[i], alphabet[j]) - min) / (max - min);
+			norm_matrix[i][j] = (matrix[i][j] - min) / (max - min);
+		}
+	}
+	
+	/* The same vectors as dense rows, so that a kernel can run over a
+	 * whole vector X_a (padding included, it adds nothing to a sum)
+	 * without looking up the triangular matrix symbol by symbol */
+	stride = Stride(alphabet_size);
+	const size_t align = 32 / sizeof(float);
+	norm_table.assign(static_cast<size_t>(alphabet_size) * stride + align, 0.0f);
+	norm_offset = (align - reinterpret_cast<uintptr_t>(norm_table.data()) / sizeof(float) % align) % align;
+	for (int a(0); a < alphabet_size; ++a) {
+		float * row = norm_table.data() + norm_offset + static_cast<size_t>(a) * stride;
+		for (int b(0); b < alphabet_size; ++b){
+			row[b] = b > a ? norm_matrix[b][a] : norm_matrix[a][b];
+		}
+	}
+	
+	/* Both matrices again, expanded to every pair of bytes, so that the
+	 * inner loops look a score up with the symbols themselves: one load,
+	 * no search of the alphabet and no branch on the order of the pair */
+	const size_t line = 64 / sizeof(float);
+	lookup_table.assign(2 * 65536 + line, 0.0f);
+	lookup_offset = (line - reinterpret_cast<uintptr_t>(lookup_table.data()) / sizeof(float) % line) % line;
+	float * scores = lookup_table.data() + lookup_offset;
+	float * norm_scores = scores + 65536;
+	for (int i(0); i < alphabet_size; ++i) {
+		for (int j(0); j <= i; ++j){
+			size_t a = static_cast<unsigned char>(alphabet[i]);
+			size_t b = static_cast<unsigned char>(alphabet[j]);
+			scores[a << 8 | b] = scores[b << 8 | a] = matrix[i][j];
+			norm_scores[a << 8 | b] = norm_scores[b << 8 | a] = norm_matrix[i][j];
 		}
 	}
 	
@@ -129,47 +276,105 @@ ScoringMatrix :: ScoringMatrix(const std::string & fname)
 	is_set = true;
 }
 
+/** Get(spec) returns the matrix of spec (a name or a file), read on the
+ *  first call only. The matrices read are kept until the end of
+ *  the process, so the statistics of all the alignments of a
+ *  batch (and all their threads) share one read-only copy.
+ */
+const ScoringMatrix &
+ScoringMatrix :: Get(const std::string & spec)
+{
+	static std::mutex mtx;
+	static std::map<std::string, std::unique_ptr<ScoringMatrix> > matrices;
+	std::lock_guard<std::mutex> lock(mtx);
+	auto it = matrices.find(spec);
+	if (it == matrices.end()){
+		ProfileScope phase("matrix");
+		it = matrices.emplace(spec, std::make_unique<ScoringMatrix>(spec)).first;
+	}
+	return *it->second;
+}
+
+/** readEntry(in, where) reads the alphabet and the matrix of the
+ *  AAindex entry at the position of in (where names it in errors)
+ */
+void
+ScoringMatrix :: readEntry(std::istream & in, const std::string & where)
+{
+	/* Skip the header lines, up to "M rows = ..." (a wrapped header
+	 * line may start with 'M' too, as in DAYM780301) */
+	std::string s;
+	getline(in,s);
+	while (in.good() && s.compare(0, 6, "M rows") != 0){
+	  getline(in,s);
+	}
+	if (s.compare(0, 6, "M rows") != 0){
+		throw std::runtime_error("No matrix in " + where);
+	}
+	
+	/* Read Alphabet */
+	int alphabet_begin = static_cast<int>(s.find('=')) + 2;
+	int alphabet_size = static_cast<int>(s.find(',')) - alphabet_begin;
+	alphabet = s.substr(alphabet_begin,	alphabet_size);
+	
+	/* Allocate the matrix (triangular: row i holds i+1 values, since
+	 * score()/normScore() always access it with the larger index first) */
+	matrix.assign(alphabet_size, std::vector<float>());
+	for (int i(0); i < alphabet_size; ++i) {
+		matrix[i].assign(i + 1, 0.0f);
+	}
+	
+	
+	/* Read the matrix
+	 * Each row is whitespace-separated (the AAindex format pads its
+	 * columns to a fixed width, but that padding is not reliable enough
+	 * to parse on: a value that prints one character shorter than its
+	 * neighbours shifts every following fixed-width field on that row.
+	 * Tokenizing on whitespace works regardless of column width, and
+	 * also degrades gracefully on files from other matrix databases
+	 * that don't pad at all. */
+	for (int i(0); i < alphabet_size; ++i) {
+		getline(in,s);
+		std::istringstream row_stream(s);
+		for (int j(0); j <=i ; j++){
+			if (!(row_stream >> matrix[i][j])){
+				throw std::runtime_error(
+					"malformed scoring matrix row for symbol '" + std::string(1, alphabet[i]) +
+					"': expected " + std::to_string(i + 1) + " values, could only read " + std::to_string(j));
+			}
+		}
+	}
+}
+
 int 
-ScoringMatrix :: index(char aa)
+ScoringMatrix :: index(char aa) const
 {
-	/* alphabet.find() returns std::string::npos when aa is absent, not
-	 * some out-of-range int. Casting it to int (the previous check) wraps
-	 * around to -1, which is never >= alphabet.size(): the absent-symbol
-	 * error would silently never fire, and callers would go on to index
-	 * the score matrix with -1 - undefined behavior. Comparing against
-	 * std::string::npos directly, before any cast, avoids that. */
-	std::string::size_type pos = alphabet.find(aa);
-	if (pos == std::string::npos){
+	int pos = symbol_index[static_cast<unsigned char>(aa)];
+	if (pos < 0){
 		throw std::runtime_error(std::string("symbol ") + aa + " is not in alphabet");
 	} 
-	return static_cast<int>(pos);
+	return pos;
 }
 
 
+/** score(aa1, aa2) checks both symbols (see index()), then reads the
+ *  same table as lookupScore()
+ */
 float
-ScoringMatrix :: score(char aa1, char aa2)
+ScoringMatrix :: score(char aa1, char aa2) const
 {
-	int x,y;
-  int pos1 = index(aa1);
-	int pos2 = index(aa2);
-	if (pos1 > pos2){
-		x = pos1; y = pos2;
-	} else {
-	  x = pos2; y = pos1;	
-	}
-	return matrix[x][y];
+	index(aa1);
+	index(aa2);
+	return lookupScore(aa1, aa2);
 }
 
+/** normScore(aa1, aa2) checks both symbols (see index()), then reads
+ *  the same table as lookupNormScore()
+ */
 float 
-ScoringMatrix :: normScore(char aa1, char aa2)
+ScoringMatrix :: normScore(char aa1, char aa2) const
 {
-	int x,y;
-  int pos1 = index(aa1);
-	int pos2 = index(aa2);
-	if (pos1 > pos2){
-		x = pos1; y = pos2;
-	} else {
-	  x = pos2; y = pos1;	
-	}
-	return norm_matrix[x][y];
+	index(aa1);
+	index(aa2);
+	return lookupNormScore(aa1, aa2);
 }
@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <array>
+#include <istream>
 #include <string>
 #include <vector>
 
@@ -31,19 +33,32 @@ protected:
 	std::vector<std::vector<float> > matrix;
   bool is_set;
 	std::vector<std::vector<float> > norm_matrix;  /**< Normalized vector of each amino acid type */
+	std::vector<float> norm_table;   /**< The normalized vectors X_a again, full (not triangular), one row of `stride` floats per symbol */
+	size_t norm_offset;                /**< Position of the first row in norm_table, the first 32-byte aligned one */
+	int stride;                        /**< Row length of norm_table: the alphabet size, rounded up to 8 floats (padded with 0) */
+	std::array<int,256> symbol_index;  /**< Position of each byte in the alphabet, -1 for the bytes not in it */
+	std::vector<float> lookup_table;   /**< score() then normScore() of every pair of bytes, two symmetric 256x256 blocks, 0 out of the alphabet */
+	size_t lookup_offset;              /**< Position of the score() block in lookup_table, the first 64-byte aligned one */
+	void readEntry(std::istream & in, const std::string & where);	/**< Read the alphabet and the matrix of the AAindex entry at the position of in */
 	float max;
 	float min;
 	
 public:
-	explicit ScoringMatrix(const std::string & fname);
+	explicit ScoringMatrix(const std::string & spec);	/**< The built-in matrix named spec (see builtin_matrices.h), or else the matrix of file spec, or else the entry spec of the AAindex2 database */
+	static const ScoringMatrix & Get(const std::string & spec);	/**< The matrix of spec, read once per process and shared read-only by all the statistics */
+	static constexpr int Stride(int alphabet_size) {return (alphabet_size + 7) / 8 * 8;};	/**< Row length of the normalized vectors of an alphabet of that size (see getNormVector()) */
 	virtual ~ScoringMatrix() = default;
 	[[nodiscard]] int		getAlphabetSize() const {return static_cast<int>(alphabet.size());};
 	[[nodiscard]] std::string	getAlphabet() const {return alphabet;};
 	[[nodiscard]] float   getMax() const {return max;};
 	[[nodiscard]] float		getMin() const {return min;};
-	int		index(char aa);
-	float		score(char aa1, char aa2);
-	float		normScore(char aa1, char aa2);
+	int		index(char aa) const;
+	float		score(char aa1, char aa2) const;
+	float		normScore(char aa1, char aa2) const;
+	[[nodiscard]] float	lookupScore(unsigned char aa1, unsigned char aa2) const {return lookup_table[lookup_offset + (static_cast<size_t>(aa1) << 8 | aa2)];};	/**< score() without check: 0 when a symbol is not in the alphabet */
+	[[nodiscard]] float	lookupNormScore(unsigned char aa1, unsigned char aa2) const {return lookup_table[lookup_offset + 65536 + (static_cast<size_t>(aa1) << 8 | aa2)];};	/**< normScore() without check: 0 when a symbol is not in the alphabet */
+	[[nodiscard]] int		getStride() const {return stride;};
+	[[nodiscard]] const float * getNormVector(int a) const {return norm_table.data() + norm_offset + static_cast<size_t>(a) * stride;};	/**< X_a: normScore(alphabet[b], alphabet[a]) for b < getAlphabetSize(), then 0 up to getStride() */
 	[[nodiscard]] bool		isSet() const {return is_set;};
 	
 };
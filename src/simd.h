@@ -0,0 +1,47 @@
+/* Copyright (c) 2012 Guillaume Collet
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE. 
+ */
+
+#pragma once
+
+/* The code paths of the vectorized kernels (mvector, identity weights):
+ * each kernel has a scalar version, and on x86 an SSE2 and an AVX2 one,
+ * compiled with a target attribute and chosen at run time, so that one
+ * binary runs, at its best, on any x86-64. */
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MSTATX_X86 1
+#endif
+
+enum class SimdLevel {Scalar, SSE, AVX2};
+
+/* The fastest code path the CPU running mstatx supports */
+inline SimdLevel BestSimdLevel()
+{
+#ifdef MSTATX_X86
+	if (__builtin_cpu_supports("avx2")){
+		return SimdLevel::AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")){
+		return SimdLevel::SSE;
+	}
+#endif
+	return SimdLevel::Scalar;
+}
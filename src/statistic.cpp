@@ -19,6 +19,9 @@
  * THE SOFTWARE. 
  */
 
+#include <algorithm>
+
+#include "result_writer.h"
 #include "statistic.h"
 #include "wentropy.h"
 #include "trident.h"
@@ -26,6 +29,9 @@
 #include "jensen.h"
 #include "kabat.h"
 #include "gap.h"
+#include "mi.h"
+#include "profile.h"
+#include "sumofpairs.h"
 
 void AddAllStatistics()
 {
@@ -35,4 +41,262 @@ void AddAllStatistics()
 	StatisticFactory::Add<JensenStat>("jensen");
 	StatisticFactory::Add<KabatStat> ("kabat");
 	StatisticFactory::Add<GapStat>   ("gap");
+	StatisticFactory::Add<MIStat>    ("mi");
+	StatisticFactory::Add<SumOfPairsStat>("sumofpairs");
+}
+
+namespace {
+
+/* Output file of a statistic that cannot share the one-column-per-
+ * statistic table: its name is inserted before the extension of the
+ * output file, e.g. "result.txt" -> "result.mvector.txt". */
+std::string derived_fname(const std::string & fname, const std::string & name)
+{
+	std::string::size_type slash = fname.find_last_of('/');
+	std::string::size_type dot   = fname.find_last_of('.');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)){
+		return fname + "." + name;
+	}
+	return fname.substr(0, dot) + "." + name + fname.substr(dot);
+}
+
+/* Mean of the scores, added up in float */
+float mean(const std::vector<float> & scores)
+{
+	float total = 0.0;
+	for (int col(0); col < static_cast<int>(scores.size()); ++col){
+		total += scores[col];
+	}
+	return total / static_cast<int>(scores.size());
+}
+
+/* Adds the printed fields of stat to names and fields: its (smoothed)
+ * scores, named name, then their errors, if any, named name_error. With
+ * -g, each field holds the mean alone. */
+void add_fields(const Stat1D & stat, const std::string & name, std::vector<std::string> & names, std::vector<std::vector<float> > & fields)
+{
+	bool global = Options::Get().global;
+	std::vector<float> scores = SmoothColumns(stat.getColStat());
+	names.push_back(name);
+	fields.push_back(global ? std::vector<float>(1, mean(scores)) : scores);
+	if (!stat.getColError().empty()){
+		names.push_back(name + "_error");
+		fields.push_back(global ? std::vector<float>(1, stat.getGlobalError()) : SmoothColumns(stat.getColError()));
+	}
+}
+
+/* Prints the fields side by side, one row per column (a single row
+ * with -g) in the file fname:
+ *  - as text, columns numbered from 1 (not with -g), after a header
+ *    line naming the fields if header is true;
+ *  - with --format bin or npy, as a float32 table (see BinaryWriter). */
+void write_fields(const std::string & fname, const std::vector<std::string> & names, const std::vector<std::vector<float> > & fields, bool header)
+{
+	bool global = Options::Get().global;
+	size_t nrow = fields[0].size();
+	const std::string & format = Options::Get().format;
+	if (format != "text"){
+		BinaryWriter file(fname, names, nrow, format);
+		for (size_t row(0); row < nrow; ++row){
+			for (const std::vector<float> & field : fields){
+				file.add(field[row]);
+			}
+		}
+		file.close();
+		return;
+	}
+	TextWriter file(fname);
+	if (header){
+		file << (global ? "#" : "#col\t");
+		for (size_t f(0); f < names.size(); ++f){
+			file << (f == 0 ? "" : "\t") << names[f];
+		}
+		file << "\n";
+	}
+	for (size_t row(0); row < nrow; ++row){
+		if (!global){
+			file << static_cast<int>(row) + 1 << "\t";
+		}
+		for (size_t f(0); f < fields.size(); ++f){
+			file << (f == 0 ? "" : "\t") << fields[f][row];
+		}
+		file << "\n";
+	}
+	file.close();
+}
+
+} // namespace
+
+void
+Stat1D :: write(Msa & msa, const std::string & fname)
+{
+	std::vector<std::string> names;
+	std::vector<std::vector<float> > fields;
+	add_fields(*this, "score", names, fields);
+	write_fields(fname, names, fields, false);
+}
+
+/*
+ * A single statistic is printed exactly as before, by its own write().
+ * With several statistics (-s wentropy,trident,...), all the Stat1D
+ * share one table in the output file: a header line starting with '#',
+ * then one line per column with one score per statistic (or a single
+ * line of global scores with -g), each one followed by its error
+ * estimate when the scores come from a sample (see --tolerance). The others (e.g. mvector, one vector
+ * per column) are each printed in their own file, see derived_fname().
+ * With --format bin or npy, the table is a float32 table instead, see
+ * write_fields().
+ */
+void PrintStatistics(Msa & msa, const std::vector<std::string> & names, const std::vector<std::unique_ptr<Statistic> > & stats, const std::string & fname)
+{
+	ProfileScope phase("print");
+	if (stats.size() == 1){
+		stats[0]->write(msa, fname);
+		return;
+	}
+	
+	std::vector<std::string> table_names;
+	std::vector<std::vector<float> > table;
+	for (size_t i(0); i < stats.size(); ++i){
+		const Stat1D * stat = dynamic_cast<const Stat1D *>(stats[i].get());
+		if (stat){
+			add_fields(*stat, names[i], table_names, table);
+		} else {
+			stats[i]->write(msa, derived_fname(fname, names[i]));
+		}
+	}
+	if (!table.empty()){
+		write_fields(fname, table_names, table, true);
+	}
+}
+
+void PrintStatistics(Msa & msa, const std::vector<std::string> & names, const std::vector<std::unique_ptr<Statistic> > & stats)
+{
+	PrintStatistics(msa, names, stats, Options::Get().output_fname);
+}
+
+/*
+ * --smooth, over the w = -w side columns of each column x, those of
+ * [x - w, x + w] inside the alignment:
+ *  - mean: the mean score of the window, x included;
+ *  - capra: the window weighting of Capra & Singh (2007), half the
+ *    score of x and half the mean score of its side columns.
+ * The sums of the windows come from the prefix sums of the scores (in
+ * double), so that the cost does not depend on w. Applied to the
+ * scores as they are printed, it reads nothing of the alignment.
+ */
+std::vector<float> SmoothColumns(const std::vector<float> & scores)
+{
+	const std::string & smooth = Options::Get().smooth;
+	if (smooth == "none" || scores.empty()){
+		return scores;
+	}
+	int L = static_cast<int>(scores.size());
+	int w = Options::Get().window;
+	std::vector<double> prefix(L + 1, 0.0);
+	for (int x(0); x < L; ++x){
+		prefix[x + 1] = prefix[x] + scores[x];
+	}
+	std::vector<float> smoothed(L);
+	for (int x(0); x < L; ++x){
+		int lo = std::max(0, x - w);
+		int hi = std::min(L - 1, x + w);
+		double window = prefix[hi + 1] - prefix[lo];
+		if (smooth == "mean"){
+			smoothed[x] = static_cast<float>(window / (hi - lo + 1));
+		} else {
+			double sides = hi > lo ? (window - scores[x]) / (hi - lo) : scores[x];
+			smoothed[x] = static_cast<float>(0.5 * scores[x] + 0.5 * sides);
+		}
+	}
+	return smoothed;
+}
+
+/*
+ * The rows of a pair statistic are printed as forEachRow() computes
+ * them, columns numbered from 1 like the Stat1D outputs:
+ *  - threshold: "x\ty\tscore" for every pair x < y scoring -t or more;
+ *  - top: "x\ty\tscore" for the -K best pairs of each column x (y on
+ *    either side of x), best first, after all the rows: only the L * K
+ *    best scores are kept;
+ *  - matrix: the upper triangle of the L x L matrix, 0 on and below the
+ *    diagonal, one row per line but the last.
+ * With --format bin or npy, the matrix is an (L - 1) x L float32 table (see
+ * BinaryWriter), the fields named after the columns; the other two
+ * outputs, whose length is only known at the end, are text only.
+ */
+void
+Stat2D :: write(Msa & msa, const std::string & fname)
+{
+	int L = msa.getNcol();
+	const std::string & pairs = Options::Get().pairs;
+	const std::string & format = Options::Get().format;
+	if (format != "text"){
+		if (pairs != "matrix"){
+			throw std::runtime_error("The pair statistics are only written in " + format + " with -P matrix");
+		}
+		std::vector<std::string> columns;
+		for (int y(0); y < L; ++y){
+			columns.push_back(std::to_string(y + 1));
+		}
+		BinaryWriter file(fname, columns, L > 0 ? L - 1 : 0, format);
+		forEachRow(msa, [&](int x, const std::vector<float> & scores){
+			for (int y(0); y < L; ++y){
+				file.add(y > x ? scores[y] : 0.0f);
+			}
+		});
+		file.close();
+		return;
+	}
+	TextWriter file(fname);
+	if (pairs == "matrix"){
+		forEachRow(msa, [&](int x, const std::vector<float> & scores){
+			for (int y(0); y < L; ++y){
+				file << (y > x ? scores[y] : 0.0f) << "\t";
+			}
+			file << "\n";
+		});
+	} else if (pairs == "threshold"){
+		float threshold = Options::Get().threshold;
+		forEachRow(msa, [&](int x, const std::vector<float> & scores){
+			for (int y(x + 1); y < L; ++y){
+				if (scores[y] >= threshold){
+					file << x + 1 << "\t" << y + 1 << "\t" << scores[y] << "\n";
+				}
+			}
+		});
+	} else {
+		/* best[x]: min-heap of the K best (score, partner) of column x,
+		 * ties going to the first partner */
+		typedef std::pair<float,int> Pair;
+		auto better = [](const Pair & a, const Pair & b){
+			return a.first > b.first || (a.first == b.first && a.second < b.second);
+		};
+		size_t K = static_cast<size_t>(Options::Get().top);
+		std::vector<std::vector<Pair> > best(L);
+		auto offer = [&](int x, const Pair & pair){
+			std::vector<Pair> & heap = best[x];
+			if (heap.size() < K){
+				heap.push_back(pair);
+				std::push_heap(heap.begin(), heap.end(), better);
+			} else if (better(pair, heap.front())){
+				std::pop_heap(heap.begin(), heap.end(), better);
+				heap.back() = pair;
+				std::push_heap(heap.begin(), heap.end(), better);
+			}
+		};
+		forEachRow(msa, [&](int x, const std::vector<float> & scores){
+			for (int y(x + 1); y < L; ++y){
+				offer(x, Pair(scores[y], y));
+				offer(y, Pair(scores[y], x));
+			}
+		});
+		for (int x(0); x < L; ++x){
+			std::sort(best[x].begin(), best[x].end(), better);
+			for (const Pair & pair : best[x]){
+				file << x + 1 << "\t" << pair.second + 1 << "\t" << pair.first << "\n";
+			}
+		}
+	}
+	file.close();
 }
@@ -21,9 +21,11 @@
 
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <string>
 #include <vector>
+#include <memory>
 #include <fstream>
 #include <stdexcept>
 
@@ -37,63 +39,59 @@ public:
 	Statistic(){};
 	virtual ~Statistic(){};
 	virtual void calculate(Msa & msa){};
-	virtual void print(Msa & msa){};
+	virtual void write(Msa & msa, const std::string & fname){};		/**< Print the result in the file fname */
+	void print(Msa & msa){write(msa, Options::Get().output_fname);};	/**< Print the result in the output file (-o) */
 };
 
 class StatisticFactory : public Factory<Statistic>{};
 
 void AddAllStatistics();
 
+/** Print the results of several statistics computed on the same msa,
+ *  names[i] being the name stats[i] was created with (see -s), in the
+ *  file fname (the output file, -o, by default). */
+void PrintStatistics(Msa & msa, const std::vector<std::string> & names, const std::vector<std::unique_ptr<Statistic> > & stats, const std::string & fname);
+void PrintStatistics(Msa & msa, const std::vector<std::string> & names, const std::vector<std::unique_ptr<Statistic> > & stats);
+
+/** The column scores as they are printed: smoothed over the -w side
+ *  columns of each column with --smooth mean or capra, unchanged with
+ *  --smooth none. O(L) whatever the window. */
+std::vector<float> SmoothColumns(const std::vector<float> & scores);
+
 class Stat1D : public Statistic {
 protected:
 	std::vector<float> col_stat; /**< vector to store columns statistics */
+	std::vector<float> col_error; /**< Error estimate of each column score, when computed on a sample of the sequences (see --tolerance) */
 
 public:
 	~Stat1D() override = default;
 	void calculate(Msa & msa) override {};
-	void print(Msa & msa) override {
-		std::ofstream file(Options::Get().output_fname.c_str());
-		if (!file.is_open()){
-			throw std::runtime_error("Cannot open file " + Options::Get().output_fname);
+	const std::vector<float> & getColStat() const {return col_stat;};		/**< Return the score of each column */
+	const std::vector<float> & getColError() const {return col_error;};	/**< Return the error estimate of each column score (empty if none) */
+	void setColError(const std::vector<float> & error) {col_error = error;};
+	float getGlobalError() const {		/**< Bound on the error of the global score: the mean of the (smoothed) column errors */
+		std::vector<float> errors = SmoothColumns(col_error);
+		float total = 0.0;
+		for (float e : errors){
+			total += e;
 		}
-		if (Options::Get().global){
-			float total = 0.0;
-			for (int col(0); col < static_cast<int>(col_stat.size()); ++col){
-				total += col_stat[col];
-			}
-			file << total / static_cast<int>(col_stat.size()) << "\n";
-		} else {
-			for (int col(0); col < static_cast<int>(col_stat.size()); ++col){
-				file << col + 1 << "\t" << col_stat[col] << "\n";
-			}
-		}
-		file.close();
+		return errors.empty() ? 0.0 : total / static_cast<int>(errors.size());
 	};
+	void write(Msa & msa, const std::string & fname) override;		/**< The score of each column, followed by its error if any (their means with -g), see --format */
 };
 
+/** Statistic of every pair of columns. The L x L scores are never
+ *  held in memory: calculate() prepares what the rows need, then
+ *  forEachRow() computes them one after the other, and write() prints
+ *  them as they come (see --pairs). */
 class Stat2D : public Statistic {
-protected:
-	std::vector<std::vector<float> > cor_stat; /**< vector to store pairs of columns statistics */
-
 public:
 	~Stat2D() override = default;
 	void calculate(Msa & msa) override {};
-	void print(Msa & msa) override {
-		std::ofstream file(Options::Get().output_fname.c_str());
-		if (!file.is_open()){
-			throw std::runtime_error("Cannot open file " + Options::Get().output_fname);
-		}
-		for  (int x(0); x < static_cast<int>(cor_stat.size()) - 1; ++x) {
-			for (int y(0); y < static_cast<int>(cor_stat.size()); ++y) {
-				if (y > x){
-					file << cor_stat[x][y] << "\t";
-				} else {
-					file << 0.0 << "\t";
-				}
-			}
-			file << "\n";
-		}
-		file.close();
-	};
+	/** Call row(x, scores) for x = 0 .. L - 2, in this order, scores[y]
+	 *  being the score of the pair (x, y) for every y > x (the scores
+	 *  of y <= x are undefined). scores is only valid during the call. */
+	virtual void forEachRow(Msa & msa, const std::function<void(int, const std::vector<float> &)> & row) {};
+	void write(Msa & msa, const std::string & fname) override;
 };
 
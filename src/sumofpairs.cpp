@@ -0,0 +1,111 @@
+/* Copyright (c) 2012 Guillaume Collet
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE. 
+ */
+
+
+#include "options.h"
+#include "scoring_matrix.h"
+#include "sumofpairs.h"
+#include "thread_pool.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** calculate(Msa & msa)
+ *
+ * The sum-of-pairs score of each column: the substitution score of
+ * every pair of distinct sequences, weighted by the sequence weights
+ * (see -W), over the sum of the weights of the pairs:
+ *   SP(x) = \frac{\sum_{i \neq j} w_i w_j M(s_{i,x}, s_{j,x})}{\sum_{i \neq j} w_i w_j}
+ * A pair with a gap or a symbol unknown to the matrix (-m) scores 0:
+ * gaps dilute the score.
+ *
+ * Grouping the sequences by symbol, with p_a the weighted count of a
+ * in column x and q_a the sum of the squared weights of its sequences,
+ *   \sum_{i \neq j} w_i w_j M(s_i, s_j) = \sum_{a,b} p_a p_b M(a,b) - \sum_a q_a M(a,a)
+ * so that a column costs O(K^2) whatever N, after one O(N) pass
+ * over its symbols for q (the pairs of sequences are never met).
+ */
+void
+SumOfPairsStat :: calculate(Msa & msa)
+{
+	int L = msa.getNcol();
+	int N = msa.getNseq();
+	string alphabet = msa.getAlphabet();
+	int K = static_cast<int>(alphabet.size());
+
+	/* Score of each pair of symbols of the msa, 0 for gaps and the
+	 * symbols unknown to the matrix */
+	const ScoringMatrix & score_mat = ScoringMatrix::Get(Options::Get().matrix_fname);
+	vector<double> M(K * K, 0.0);
+	for (int a(0); a < K; ++a){
+		for (int b(0); b < K; ++b){
+			if (alphabet[a] != '-' && alphabet[b] != '-'){
+				M[a * K + b] = score_mat.lookupScore(alphabet[a], alphabet[b]);
+			}
+		}
+	}
+
+	/* Weighted counts of each column (p[x * K + a]), shared by all statistics */
+	const vector<float> & w = msa.getSeqWeights();
+	const vector<float> & p = msa.getWeightedCounts();
+	double sum_w = 0.0, sum_w2 = 0.0;
+	for (int seq(0); seq < N; ++seq){
+		sum_w  += w[seq];
+		sum_w2 += static_cast<double>(w[seq]) * w[seq];
+	}
+	double pairs = sum_w * sum_w - sum_w2;
+
+	/* q[x * K + a] = sum of w_i^2 over the sequences with a in column x */
+	vector<double> q(static_cast<size_t>(L) * K, 0.0);
+	msa.forColumnChunks([&](int chunk_first, int chunk_last){
+		ParallelFor(chunk_first, chunk_last, [&](int col_begin, int col_end){
+			for (int x(col_begin); x < col_end; ++x){
+				const uint8_t * codes = msa.getColCodes(x);
+				double * q_x = &q[static_cast<size_t>(x) * K];
+				for (int seq(0); seq < N; ++seq){
+					q_x[codes[seq]] += static_cast<double>(w[seq]) * w[seq];
+				}
+			}
+		});
+	});
+
+	col_stat.assign(L, 0.0);
+	ParallelFor(0, L, [&](int x_begin, int x_end){
+		for (int x(x_begin); x < x_end; ++x){
+			const float * p_x = &p[static_cast<size_t>(x) * K];
+			const double * q_x = &q[static_cast<size_t>(x) * K];
+			double total = 0.0;
+			for (int a(0); a < K; ++a){
+				if (p_x[a] == 0.0f){
+					continue;
+				}
+				double row = 0.0;
+				for (int b(0); b < K; ++b){
+					row += p_x[b] * M[a * K + b];
+				}
+				total += p_x[a] * row - q_x[a] * M[a * K + a];
+			}
+			col_stat[x] = pairs > 0.0 ? static_cast<float>(total / pairs) : 0.0f;
+		}
+	});
+}
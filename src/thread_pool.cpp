@@ -0,0 +1,207 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "thread_pool.h"
+#include "options.h"
+#include "profile.h"
+
+namespace {
+
+/* Set in the threads running a loop body, so a nested parallelFor()
+ * runs inline instead of waiting for workers busy with its caller. */
+thread_local bool in_loop = false;
+
+/* Chunks per thread: a few, so a slow chunk (a column of long
+ * sequences of every symbol...) does not leave the others idle. */
+const int CHUNKS_PER_THREAD = 4;
+
+} // namespace
+
+
+/**************************************************************
+ * ThreadPool starts with no worker: they are created by the
+ * first parallelFor() asking for more than one thread, and
+ * stopped with the pool.
+ **************************************************************/
+ThreadPool :: ThreadPool()
+	: body(nullptr), next(0), end(0), chunk(1), slots(0), running(0), generation(0), stop(false)
+{
+}
+
+ThreadPool :: ~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stop = true;
+	}
+	wake.notify_all();
+	for (auto & w : workers){
+		w.join();
+	}
+}
+
+ThreadPool &
+ThreadPool :: Get()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+int
+ThreadPool :: size()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return static_cast<int>(workers.size());
+}
+
+
+/**************************************************************
+ * reserve(n) starts workers until there are n of them. The
+ * workers are never stopped before the pool: a loop needing
+ * fewer of them leaves the others asleep. Only called by the
+ * thread holding `busy`, i.e. never during a loop.
+ **************************************************************/
+void
+ThreadPool :: reserve(int nworkers)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	while (static_cast<int>(workers.size()) < nworkers){
+		workers.emplace_back(&ThreadPool::work, this, generation);
+	}
+}
+
+
+/**************************************************************
+ * work(seen) is the loop of each worker: wait for a loop
+ * newer than `seen` that still needs a worker, take part in
+ * it, signal the end of its part, wait again.
+ **************************************************************/
+void
+ThreadPool :: work(unsigned seen)
+{
+	while (true){
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			wake.wait(lock, [&]{ return stop || (generation != seen && slots > 0); });
+			if (stop){
+				return;
+			}
+			seen = generation;
+			slots--;
+		}
+		runChunks();
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			running--;
+		}
+		done.notify_one();
+	}
+}
+
+
+/**************************************************************
+ * runChunks() takes chunks of the current loop until there
+ * is none left. After an exception, the remaining chunks
+ * are skipped and the exception is kept for the caller.
+ **************************************************************/
+void
+ThreadPool :: runChunks()
+{
+	in_loop = true;
+	int b;
+	while ((b = next.fetch_add(chunk)) < end){
+		try {
+			TraceScope span("chunk", "chunk");
+			span.arg("begin", b).arg("end", std::min(b + chunk, end));
+			(*body)(b, std::min(b + chunk, end));
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(mtx);
+			if (!error){
+				error = std::current_exception();
+			}
+			next = end;
+		}
+	}
+	in_loop = false;
+}
+
+
+/**************************************************************
+ * parallelFor
+ **************************************************************/
+void
+ThreadPool :: parallelFor(int begin, int end_, int nthreads, const std::function<void(int,int)> & body_)
+{
+	if (end_ <= begin){
+		return;
+	}
+	int nworkers = nthreads - 1;
+	nthreads = std::min(nthreads, end_ - begin);
+	std::unique_lock<std::mutex> owner(busy, std::defer_lock);
+	if (nthreads <= 1 || in_loop || !owner.try_lock()){
+		TraceScope span("chunk", "chunk");
+		span.arg("begin", begin).arg("end", end_);
+		body_(begin, end_);
+		return;
+	}
+
+	/* All the workers of -j are kept, but a range shorter than -j
+	 * only takes one worker per index: every worker is woken, the
+	 * first ones take the slots, the others go back to sleep */
+	reserve(nworkers);
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		body    = &body_;
+		end     = end_;
+		chunk   = std::max(1, (end_ - begin) / (nthreads * CHUNKS_PER_THREAD));
+		next    = begin;
+		slots   = nthreads - 1;
+		running = nthreads - 1;
+		error   = nullptr;
+		generation++;
+	}
+	wake.notify_all();
+
+	runChunks();
+
+	std::exception_ptr failure;
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		done.wait(lock, [&]{ return running == 0; });
+		body = nullptr;
+		std::swap(failure, error);
+	}
+	if (failure){
+		std::rethrow_exception(failure);
+	}
+}
+
+
+/**************************************************************
+ * ParallelFor uses the number of threads of the options
+ **************************************************************/
+void
+ParallelFor(int begin, int end, const std::function<void(int,int)> & body)
+{
+	ThreadPool::Get().parallelFor(begin, end, Options::Get().threads, body);
+}
@@ -0,0 +1,86 @@
+/* Copyright (c) 2012 Guillaume Collet
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ThreadPool runs loops over a range of indices (in practice: the
+ * columns of the alignment) on -j/--threads threads. The threads are
+ * started once and sleep between two loops; a loop over fewer indices
+ * than threads only runs on as many workers as it has indices.
+ *
+ * parallelFor() cuts the range in chunks of consecutive indices, which
+ * the workers (and the calling thread) take one after the other. Each
+ * index is processed exactly once, by a single call of the loop body,
+ * so a body that only writes the results of its own indices gives the
+ * same results whatever the number of threads.
+ *
+ * A parallelFor() called from inside a loop body, or while another
+ * thread is already running one, simply runs in the calling thread.
+ */
+class ThreadPool
+{
+protected:
+	std::vector<std::thread> workers;
+	std::mutex               mtx;
+	std::mutex               busy;          /**< Held by the thread running a parallelFor() */
+	std::condition_variable  wake;          /**< Signals a new loop (or stop) to the workers */
+	std::condition_variable  done;          /**< Signals the end of a worker's part of the loop */
+	const std::function<void(int,int)> * body;
+	std::atomic<int>         next;          /**< First index of the next chunk to process */
+	int                      end;
+	int                      chunk;
+	int                      slots;         /**< Number of workers the current loop still wakes */
+	int                      running;       /**< Number of workers still in the current loop */
+	unsigned                 generation;    /**< Incremented at each new loop */
+	bool                     stop;
+	std::exception_ptr       error;         /**< First exception thrown by the loop body */
+
+	ThreadPool();
+	void reserve(int nworkers);
+	void work(unsigned seen);
+	void runChunks();
+
+public:
+	~ThreadPool();
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+
+	static ThreadPool & Get();		/**< The process-wide pool */
+	int size();				/**< Number of worker threads started */
+
+	/** Call body(b, e) on consecutive sub-ranges [b, e) covering
+	 *  [begin, end), on `nthreads` threads (the calling thread being one
+	 *  of them). Returns once the whole range is processed, rethrowing
+	 *  the first exception thrown by body, if any. */
+	void parallelFor(int begin, int end, int nthreads, const std::function<void(int,int)> & body);
+};
+
+/** Run body over [begin, end) on -j/--threads threads, see ThreadPool */
+void ParallelFor(int begin, int end, const std::function<void(int,int)> & body);
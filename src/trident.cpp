@@ -22,28 +22,53 @@
 #include "trident.h"
 #include "options.h"
 #include "scoring_matrix.h"
+#include "thread_pool.h"
 
+#include <array>
 #include <cmath>
 #include <fstream>
 #include <algorithm>
+#include <stdexcept>
 
 using namespace std;
 
 #define MIN(x,y)  (x < y ? x : y)
 
-/** normVect(vector<float> vect)
- *
- * Return the vector norm = √(∑v*v)
- */
-float
-TridStat :: normVect(vector<float> vect){
-	float score= 0.0;
-	for(int i(0); i < static_cast<int>(vect.size()); ++i){
-		score += vect[i] * vect[i];
+namespace {
+
+/* Sum of the distances of the vectors X_a of the types to their mean,
+ * the core of r(x). The rows are STRIDE floats long, known at compile
+ * time for the alphabet sizes of the built-in matrices, so that the
+ * loops can be unrolled and vectorized (0: only known at run time).
+ * The padding of the rows adds 0 to the sums. */
+template <int STRIDE>
+float type_spread(const vector<const float *> & type_vect, float * mean, int stride)
+{
+	const int n = STRIDE ? STRIDE : stride;
+	float ntype = static_cast<float>(type_vect.size());
+	fill(mean, mean + n, 0.0f);
+	for (const float * X : type_vect){
+		for (int a(0); a < n; ++a){
+			mean[a] += X[a];
+		}
+	}
+	for (int a(0); a < n; ++a){
+		mean[a] /= ntype;
+	}
+	float sum = 0.0;
+	for (const float * X : type_vect){
+		float dist = 0.0;
+		for (int a(0); a < n; ++a){
+			float diff = mean[a] - X[a];
+			dist += diff * diff;
+		}
+		sum += sqrt(dist);
 	}
-	return sqrt(score);
+	return sum;
 }
 
+} // namespace
+
 /** calculate(Msa & msa)
  *
  * Calculate trident statistic and print it in the output file
@@ -60,114 +85,97 @@ TridStat :: normVect(vector<float> vect){
 void
 TridStat :: calculate(Msa & msa)
 {
-	/* Declare the vectors */
-	vector<float> w;					/**< Weight of each sequence in the msa (size = nb sequences) */
-	vector<float> t;					/**< t(x) = Shannon entropy score  + Weighted sequence Score */
-	vector<float> r;					/**< r(x) = Stereochemical score */
-	vector<float> g;					/**< g(x) = Gap Score */
-
 	/* Init size */
 	int L = msa.getNcol();
 	int N = msa.getNseq();
 	string alphabet = msa.getAlphabet();
 	int K = static_cast<int>(alphabet.size());
 
-	/* Calculate Sequence Weights */
-	w = msa.getSeqWeights();
-
-	/* Calculate t(x) = \frac{\sum_{a=1}^{K}p_a log(p_a)}{log(min(N,K))}
-	 *						p_a = \sum_{i \in \{i|s(i) = a\}} w_i
-	 *						w_i = \frac{1}{L} \sum_{x=1}^{L}\frac{1}{K_x n_{x_i}}
-	 * Like in wentropy
-	 */
-	float lambda = 1.0 / log(MIN(K,N));
-
-  for (int x(0); x < L; x++){
-		t.push_back(0.0);
-		for (int a(0); a < K; a++){
-			float tmp_proba(0.0);
-		  for (int j(0); j < N; j++){
-				if(msa.getSymbol(j, x) == alphabet[a]){
-					tmp_proba += w[j];
-				}
-			}
-			if (tmp_proba != 0.0){
-				t[x] -= tmp_proba * log(tmp_proba);
-			}
-		}
-		t[x] *= lambda;
-    //cerr << "t[" << x << "] = " << t[x] << "\n";
-	}
+	/* Weighted aa proba of each column (p[x * K + a]), shared by all statistics */
+	const vector<float> & p = msa.getWeightedCounts();
 
-	/* Calculate g(x) = nb_gap / nb_seq
-	 * Represents the proportion of gaps in the column
-	 */
-	for (int x(0); x < L; x++){
-		g.push_back(static_cast<float>(msa.getGap(x)) / static_cast<float>(N));
-		//cerr << "g[" << x << "] = " << g[x] << "\n";
-	}
-
-
-	/* Calculate r(x) = \lambda_r \frac{1}{k_x}\sum_{a=1}^{k_x}|\bar{X}(x) - X_a|
-	 *      \lambda_r = \frac{1}{\sqrt{20(max(M)-min(M))^2}}
-	 *					  X_a = \left[ \begin{array}{c}M(a,a_1)\\M(a,a_2)\\.\\.\\.\\M(a,a_{20})\end{array}\right]
-	 *							M is a normalized scoring matrix
-	 */
-	ScoringMatrix score_mat(Options::Get().matrix_fname);
+	/* The normalized scoring matrix of r(x), read once for all columns */
+	const ScoringMatrix & score_mat = ScoringMatrix::Get(Options::Get().matrix_fname);
 	int alph_size = score_mat.getAlphabetSize();
+	int stride = score_mat.getStride();
 	string sm_alphabet = score_mat.getAlphabet();
 
-	msa.fitToAlphabet(sm_alphabet);
-
-	for (int x(0); x < L; x++){
-
-		int ntype = msa.getNtype(x);
-		string type_list = msa.getTypeList(x);
-		if (type_list.empty()) {
-			std::cerr << "Error: No amino acid type found in column " << x << "\n";
-			exit(1);
-		}
-		if (type_list.find("-") != std::string::npos){
-			type_list.erase(type_list.find("-"), 1);
-			ntype--;
-		}
-		if (ntype){
-			/* Calculate Mean vector */
-			vector<float> mean(alph_size, 0.0);
-			for (int i(0); i < ntype; ++i){
-				for (int a(0); a < alph_size; ++a){
-					mean[a] += score_mat.normScore(sm_alphabet[a], type_list[i]);
+	/* Row of each symbol in the matrix, -1 for the gap and the symbols it does not know */
+	array<int,256> sm_index;
+	sm_index.fill(-1);
+	for (int a(0); a < alph_size; ++a){
+		sm_index[static_cast<unsigned char>(sm_alphabet[a])] = a;
+	}
+	sm_index['-'] = -1;
+
+	/* The kernel of r(x) for the row length of this matrix: 24 for 20 amino acids, 8 for DNA and RNA */
+	auto spread = stride == ScoringMatrix::Stride(20) ? type_spread<ScoringMatrix::Stride(20)>
+	            : stride == ScoringMatrix::Stride(6)  ? type_spread<ScoringMatrix::Stride(6)>
+	            : type_spread<0>;
+
+	float lambda_t = 1.0 / log(MIN(K,N));
+	float lambda_r = sqrt(alph_size * (score_mat.getMax() - score_mat.getMin()) * (score_mat.getMax() - score_mat.getMin()));
+
+	/* Columns are independent: each thread takes a range of them */
+	col_stat.assign(L, 0.0);
+	ParallelFor(0, L, [&](int x_begin, int x_end){
+		/* Buffers of the r(x) kernel, allocated once per range of columns */
+		vector<float> mean(stride);
+		vector<const float *> type_vect;
+		type_vect.reserve(256);
+		for (int x(x_begin); x < x_end; x++){
+
+			/* Calculate t(x) = \frac{\sum_{a=1}^{K}p_a log(p_a)}{log(min(N,K))}
+			 *						p_a = \sum_{i \in \{i|s(i) = a\}} w_i
+			 *						w_i = \frac{1}{L} \sum_{x=1}^{L}\frac{1}{K_x n_{x_i}}
+			 * Like in wentropy
+			 */
+			float t = 0.0;
+			for (int a(0); a < K; a++){
+				float tmp_proba = p[x * K + a];
+				if (tmp_proba != 0.0){
+					t -= tmp_proba * log(tmp_proba);
 				}
 			}
-			for (int a(0); a < alph_size; ++a){
-				mean[a] /= ntype;
+			t *= lambda_t;
+
+			/* Calculate g(x) = nb_gap / nb_seq
+			 * Represents the proportion of gaps in the column
+			 */
+			float g = static_cast<float>(msa.getGap(x)) / static_cast<float>(N);
+
+			/* Calculate r(x) = \lambda_r \frac{1}{k_x}\sum_{a=1}^{k_x}|\bar{X}(x) - X_a|
+			 *      \lambda_r = \frac{1}{\sqrt{20(max(M)-min(M))^2}}
+			 *					  X_a = \left[ \begin{array}{c}M(a,a_1)\\M(a,a_2)\\.\\.\\.\\M(a,a_{20})\end{array}\right]
+			 *							M is a normalized scoring matrix
+			 *
+			 * Only the types the scoring matrix knows count: gaps, and symbols
+			 * outside the matrix alphabet (X, B, Z...), are left out of r(x).
+			 * The msa itself is not modified, other statistics may still use it.
+			 */
+			const string & all_types = msa.getTypeList(x);
+			if (all_types.empty()) {
+				throw std::runtime_error("No amino acid type found in column " + std::to_string(x));
 			}
-
-			/* Calculate Score */
-			float lambda = sqrt(alph_size * (score_mat.getMax() - score_mat.getMin()) * (score_mat.getMax() - score_mat.getMin()));
-			float tmp_score = 0.0;
-			for (int i(0); i < ntype; ++i){
-				vector<float> diff_vect;
-				for(int a(0); a < alph_size; ++a){
-					diff_vect.push_back(mean[a] - score_mat.normScore(sm_alphabet[a], type_list[i]));
+			type_vect.clear();
+			for (char c : all_types){
+				int row = sm_index[static_cast<unsigned char>(c)];
+				if (row >= 0){
+					type_vect.push_back(score_mat.getNormVector(row));
 				}
-				tmp_score += normVect(diff_vect);
 			}
-			tmp_score /= ntype;
-			tmp_score /= lambda;
-			r.push_back(tmp_score);
-		} else {
-			r.push_back(0.0);
-		}
-    //cerr << "r[" << x << "] = " << r[x] << "\n";
-	}
-
-
-	/*
-	 * Combine the three scores
-	 */
-	for (int x(0); x < L; x++){
-		col_stat.push_back(pow((1-t[x]),Options::Get().factor_a)*pow((1-r[x]),Options::Get().factor_b)*pow((1-g[x]),Options::Get().factor_c));
-	}
+			int ntype = static_cast<int>(type_vect.size());
+			float r = 0.0;
+			if (ntype){
+				r = spread(type_vect, mean.data(), stride);
+				r /= ntype;
+				r /= lambda_r;
+			}
 
+			/*
+			 * Combine the three scores
+			 */
+			col_stat[x] = pow((1-t),Options::Get().factor_a)*pow((1-r),Options::Get().factor_b)*pow((1-g),Options::Get().factor_c);
+		}
+	});
 }
@@ -24,9 +24,6 @@
 #include "statistic.h"
 
 class TridStat : public Stat1D {
-private:
-	float normVect(std::vector<float> vect);
-	
 public:
 	void calculate(Msa & msa) override;
 };
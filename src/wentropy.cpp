@@ -21,6 +21,7 @@
 
 #include "wentropy.h"
 #include "options.h"
+#include "thread_pool.h"
 
 #include <cmath>
 #include <fstream>
@@ -53,27 +54,22 @@ WEntStat :: calculate(Msa & msa)
 	int N = msa.getNseq();
 	int K = static_cast<int>(alphabet.size());
 	
-	/* Allocate probabilities array */
-	std::vector<std::vector<float> > p(L, std::vector<float>(K, 0.0f));
+	/* Weighted aa proba of each column (p[x * K + a]), shared by all statistics */
+	const vector<float> & p = msa.getWeightedCounts();
 	
-	/* Calculate Sequence Weights */
-	const vector<float> & w = msa.getSeqWeights();
-	
-	/* Calculate aa proba and conservation score by columns */
+	/* Calculate conservation score by columns */
 	float lambda = 1.0 / log(MIN(K,N));
 	
-	for (int x(0); x < L; ++x){
-		col_stat.push_back(0.0);
-		for (int a(0); a < K; ++a){
-			for (int j(0); j < N; ++j){
-				if(msa.getSymbol(j, x) == alphabet[a]){
-					p[x][a] += w[j];
+	col_stat.assign(L, 0.0);
+	ParallelFor(0, L, [&](int x_begin, int x_end){
+		for (int x(x_begin); x < x_end; ++x){
+			for (int a(0); a < K; ++a){
+				float p_a = p[x * K + a];
+				if (p_a != 0.0){
+					col_stat[x] -= p_a * log(p_a);
 				}
 			}
-			if (p[x][a] != 0.0){
-				col_stat[x] -= p[x][a] * log(p[x][a]);
-			}
+			col_stat[x] *= lambda;
 		}
-		col_stat[x] *= lambda;
-	}
+	});
 }
@@ -84,6 +84,19 @@ void test_background_malformed_file_throws()
 	expect(threw, "a malformed background file should throw std::runtime_error");
 }
 
+/* Get() builds each distribution once and shares it */
+void test_background_get_shares_one_copy()
+{
+	const BackgroundDistribution & first  = BackgroundDistribution::Get("tests/fixtures/tiny_background.txt");
+	const BackgroundDistribution & second = BackgroundDistribution::Get("tests/fixtures/tiny_background.txt");
+	const BackgroundDistribution & legacy = BackgroundDistribution::Get("legacy");
+
+	expect(&first == &second, "the same spec should give the same object");
+	expect(&first != &legacy, "another spec should give another distribution");
+	expect(almost_equal(first.getFreq('A'), 0.5f), "A from the shared custom file");
+	expect(almost_equal(legacy.getFreq('A'), 0.073f), "A from the shared legacy table");
+}
+
 } // namespace
 
 int main()
@@ -94,6 +107,7 @@ int main()
 	test_background_unknown_symbol_throws();
 	test_background_nonexistent_file_throws();
 	test_background_malformed_file_throws();
+	test_background_get_shares_one_copy();
 	std::cout << "All background tests passed\n";
 	return 0;
 }
@@ -0,0 +1,159 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/batch.h"
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/statistic.h"
+#include "test_helpers.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/* Fixture (tests/fixtures/batch_manifest.txt): a comment, an empty
+ * line, three alignments (one with blanks around its path) and a file
+ * that does not exist. */
+const std::string MANIFEST = "tests/fixtures/batch_manifest.txt";
+const std::string OUT_DIR  = "tests/fixtures/.batch_test_output";
+const std::string SINGLE   = "tests/fixtures/.batch_test_single.txt";
+const std::string MATRIX   = "data/aaindex/HENS920102.mat";
+
+void parse_test_options(const std::vector<std::string> & extra)
+{
+	std::vector<std::string> args = {"mstatx", "-m", MATRIX, "-s", "wentropy,trident"};
+	args.insert(args.end(), extra.begin(), extra.end());
+	parse_args(args);
+}
+
+/* Every job is handed out once, each worker starting with the largest
+ * of its deque, and idle workers steal the others' jobs. */
+void test_scheduler_largest_first_and_stealing()
+{
+	std::vector<uintmax_t> sizes = {10, 50, 30, 40, 20};
+	BatchScheduler scheduler(sizes, 2);
+
+	int job;
+	expect(scheduler.next(0, job) && job == 1, "worker 0 should start with the largest job");
+	expect(scheduler.next(1, job) && job == 3, "worker 1 should start with the second largest job");
+
+	/* Worker 1 alone drains everything: its own job (20), then the
+	 * jobs left to worker 0 (30, 10), largest first */
+	std::vector<int> rest;
+	while (scheduler.next(1, job)) {
+		rest.push_back(job);
+	}
+	expect(rest.size() == 3, "the remaining 3 jobs should all be handed out");
+	expect(rest[0] == 4, "worker 1 should finish its own deque first");
+	expect(rest[1] == 2 && rest[2] == 0, "then steal worker 0's jobs, largest first");
+	expect(!scheduler.next(0, job), "no job should be left for worker 0");
+}
+
+void test_read_manifest()
+{
+	std::vector<std::string> inputs = ReadBatchInputs(MANIFEST);
+	expect(inputs.size() == 4, "comments and empty lines should be skipped");
+	expect(inputs[1] == "tests/fixtures/kabat_tiny.fasta", "blanks around a path should be trimmed");
+
+	bool threw = false;
+	try {
+		ReadBatchInputs("tests/fixtures/does_not_exist_manifest.txt");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "a nonexistent manifest should throw std::runtime_error");
+}
+
+/* A directory gives its files in name order, but the caches that -C
+ * writes next to them, and those left half-written */
+void test_read_directory_skips_caches()
+{
+	const std::string dir = OUT_DIR + "/inputs";
+	fs::create_directories(dir);
+	for (const std::string name : {"b.fasta", "a.fasta", "a.fasta.msx", "b.fasta.msx.tmp1234"}) {
+		std::ofstream file((dir + "/" + name).c_str());
+		file << ">s\nA\n";
+	}
+	std::vector<std::string> inputs = ReadBatchInputs(dir);
+	expect(inputs.size() == 2 && inputs[0] == dir + "/a.fasta" && inputs[1] == dir + "/b.fasta", "the .msx caches should not be inputs");
+	expect(Msa::IsCacheName("x.msx") && !Msa::IsCacheName("x.msx.fasta"), "only the names of -C should be caches");
+	fs::remove_all(dir);
+}
+
+/* A batch gives, for each input, the file a single run on this input
+ * gives, and records the inputs that failed without stopping. */
+void test_batch_matches_single_runs()
+{
+	AddAllStatistics();
+	parse_test_options({"-B", MANIFEST});
+	expect(Options::Get().output_fname == "output", "the default output of a batch should be a directory, output");
+	parse_test_options({"-B", MANIFEST, "-o", OUT_DIR, "-j", "3"});
+	expect(Options::Get().input_fname.empty(), "-i should not be needed with --batch");
+
+	std::vector<std::string> inputs = ReadBatchInputs(Options::Get().batch);
+	std::vector<BatchResult> results = RunBatch(inputs, OUT_DIR);
+	expect(results.size() == 4, "one result per input");
+	expect(results[0].output == OUT_DIR + "/jensen_tiny.txt", "outputs should be named after the inputs");
+	expect(results[0].error.empty() && results[0].nseq == 4 && results[0].ncol == 3, "jensen_tiny should be read");
+	expect(!results[3].error.empty(), "a missing input should be reported as failed");
+
+	for (int i = 0; i < 3; ++i) {
+		parse_test_options({"-i", inputs[i], "-o", SINGLE});
+		std::vector<std::unique_ptr<Statistic> > stats = make_stats(Options::Get().statistics);
+		Msa msa(inputs[i]);
+		for (auto & stat : stats) {
+			stat->calculate(msa);
+		}
+		PrintStatistics(msa, Options::Get().statistics, stats);
+
+		std::ifstream batch_file(results[i].output.c_str()), single_file(SINGLE.c_str());
+		std::string batch_text((std::istreambuf_iterator<char>(batch_file)), std::istreambuf_iterator<char>());
+		std::string single_text((std::istreambuf_iterator<char>(single_file)), std::istreambuf_iterator<char>());
+		expect(!batch_text.empty() && batch_text == single_text, "batch output of " + inputs[i] + " should match a single run");
+	}
+
+	WriteBatchSummary(results, OUT_DIR + "/batch_summary.txt");
+	std::ifstream summary((OUT_DIR + "/batch_summary.txt").c_str());
+	std::string line;
+	int nb_lines = 0;
+	while (std::getline(summary, line)) {
+		nb_lines++;
+	}
+	expect(nb_lines == 5, "summary should have a header and one line per input");
+}
+
+/* The outputs take the extension of -F, and so do the files of the
+ * statistics written on their own */
+void test_batch_extension_follows_the_format()
+{
+	parse_args({"mstatx", "-m", MATRIX, "-s", "wentropy,mvector", "-B", MANIFEST, "-o", OUT_DIR, "-F", "npy"});
+	std::vector<BatchResult> results = RunBatch(ReadBatchInputs(Options::Get().batch), OUT_DIR);
+	expect(results[0].output == OUT_DIR + "/jensen_tiny.npy", "-F npy outputs should end with .npy");
+	std::ifstream table((OUT_DIR + "/jensen_tiny.npy").c_str()), profile((OUT_DIR + "/jensen_tiny.mvector.npy").c_str());
+	expect(table.is_open() && profile.is_open(), "the table and mvector should both be written as .npy");
+	for (int i = 0; i < 3; ++i) {
+		std::remove(results[i].output.c_str());
+		std::string stem = results[i].output.substr(0, results[i].output.size() - 4);
+		std::remove((stem + ".mvector.npy").c_str());
+	}
+}
+
+} // namespace
+
+int main()
+{
+	test_scheduler_largest_first_and_stealing();
+	test_read_manifest();
+	test_read_directory_skips_caches();
+	test_batch_matches_single_runs();
+	test_batch_extension_follows_the_format();
+	std::cout << "All batch tests passed\n";
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/fasta.h"
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Fixture (tests/fixtures/multiline_crlf.fasta): 3 sequences x 4
+ * columns, each sequence wrapped on two lines, written with Windows
+ * line endings, in mixed case and with descriptions after the names:
+ *
+ *   >seq1 first sequence    AC / de   -> ACDE
+ *   >seq2                   Ac / GE   -> ACGE
+ *   >seq3<TAB>third         a- / -e   -> A--E
+ *
+ * i.e. the same alignment as simple_alignment.fasta once read. */
+const std::string MULTILINE = "tests/fixtures/multiline_crlf.fasta";
+
+void parse_test_options(const std::string & nb_seq)
+{
+	char *argv[] = {
+		const_cast<char*>("mstatx"),
+		const_cast<char*>("-i"), const_cast<char*>(MULTILINE.c_str()),
+		const_cast<char*>("-n"), const_cast<char*>(nb_seq.c_str())
+	};
+	Options::Parse(sizeof(argv) / sizeof(argv[0]), argv);
+}
+
+/* The reader alone: names stop at the first blank, '\r' is never
+ * counted as a residue, and lines of a record are concatenated. */
+void test_reader_indexes_names_and_lengths()
+{
+	MappedFile file(MULTILINE);
+	FastaReader reader(file, 500);
+
+	expect(reader.size() == 3, "expected 3 records");
+	expect(reader.getName(0) == "seq1", "name should stop at the first space");
+	expect(reader.getName(1) == "seq2", "name without description should not keep the '\\r'");
+	expect(reader.getName(2) == "seq3", "name should stop at the first tab");
+	for (int i = 0; i < 3; ++i) {
+		expect(reader.getLength(i) == 4, "every record should have 4 residues (no '\\r' counted)");
+	}
+
+	std::string seq(4, ' ');
+	reader.copySequence(1, &seq[0]);
+	expect(seq == "ACGE", "copySequence should join the lines, in upper case");
+	reader.copySequence(2, &seq[0]);
+	expect(seq == "A--E", "gaps should be copied as is");
+}
+
+/* max_seq stops the indexing, like -n/--nb_seq always did. */
+void test_reader_honours_max_seq()
+{
+	MappedFile file(MULTILINE);
+	FastaReader reader(file, 2);
+	expect(reader.size() == 2, "only the first 2 records should be indexed");
+	expect(reader.getName(1) == "seq2", "the first records should be the ones kept");
+}
+
+/* copyResidues() reads a record piece by piece, across the line breaks,
+ * as copySequence() reads it whole */
+void test_reader_copies_residues_piece_by_piece()
+{
+	MappedFile file(MULTILINE);
+	FastaReader reader(file, 500);
+	const char * expected[] = {"ACDE", "ACGE", "A--E"};
+	for (int width : {1, 2, 3, 4}) {
+		for (int i = 0; i < 3; ++i) {
+			std::string seq(4, '?');
+			size_t pos = reader.getBegin(i);
+			for (int col = 0; col < 4; col += width) {
+				int count = std::min(width, 4 - col);
+				pos = reader.copyResidues(i, pos, count, &seq[col]);
+			}
+			expect(seq == expected[i], "pieces of " + std::to_string(width) + " residues should give the sequence");
+		}
+	}
+}
+
+/* Through Msa: the mapped reader must give exactly the alignment the
+ * line-by-line reader used to build for simple_alignment.fasta. */
+void test_msa_reads_wrapped_crlf_alignment()
+{
+	parse_test_options("500");
+	Msa msa(MULTILINE);
+
+	expect(msa.getNseq() == 3, "expected 3 sequences");
+	expect(msa.getNcol() == 4, "expected 4 columns");
+	expect(msa.getCol(1) == "CC-", "column 1 should be CC-");
+	expect(msa.getCol(2) == "DG-", "column 2 should be DG-");
+	expect(msa.getSymbol(1, 2) == 'G', "lower case residues should be upper-cased");
+	expect(msa.getGap(2) == 1, "third column should have one gap");
+}
+
+void test_msa_honours_nb_seq()
+{
+	parse_test_options("2");
+	Msa msa(MULTILINE);
+	expect(msa.getNseq() == 2, "-n 2 should keep 2 sequences");
+}
+
+/* Sequences of different lengths are not an alignment: this used to
+ * read past the end of the shorter rows, it now throws. */
+void test_msa_ragged_alignment_throws()
+{
+	parse_test_options("500");
+	bool threw = false;
+	try {
+		Msa msa("tests/fixtures/ragged.fasta");
+	} catch (const std::runtime_error & e) {
+		threw = true;
+		expect(std::string(e.what()).find("seq2") != std::string::npos,
+		       "error message should name the offending sequence");
+	}
+	expect(threw, "sequences of different lengths should throw std::runtime_error");
+}
+
+void test_mapped_file_nonexistent_throws()
+{
+	bool threw = false;
+	try {
+		MappedFile file("tests/fixtures/does_not_exist.fasta");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "a nonexistent file should throw std::runtime_error");
+}
+
+} // namespace
+
+int main()
+{
+	test_reader_indexes_names_and_lengths();
+	test_reader_honours_max_seq();
+	test_reader_copies_residues_piece_by_piece();
+	test_msa_reads_wrapped_crlf_alignment();
+	test_msa_honours_nb_seq();
+	test_msa_ragged_alignment_throws();
+	test_mapped_file_nonexistent_throws();
+	std::cout << "All fasta tests passed\n";
+	return 0;
+}
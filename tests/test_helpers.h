@@ -2,7 +2,8 @@
  *
  * Extracted from tests/test_msa_scoring.cpp so every new test file
  * (test_jensen.cpp, test_gap.cpp, ...) can reuse the same expect()/
- * almost_equal() instead of redefining them.
+ * almost_equal() instead of redefining them, and the same
+ * parse_args()/write_random_alignment() to set up its run.
  */
 
 #ifndef __TEST_HELPERS_H__
@@ -12,9 +13,14 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
+#include "../src/options.h"
+#include "../src/statistic.h"
+
 namespace test_helpers {
 
 inline bool almost_equal(float a, float b, float eps = 1e-5f)
@@ -84,6 +90,59 @@ inline std::vector<std::vector<float> > read_mvector_file(const std::string & pa
 	return table;
 }
 
+/* Parses a command line given as strings, e.g.
+ * parse_args({"mstatx", "-i", input, "-j", "4"}). */
+inline void parse_args(std::vector<std::string> args)
+{
+	std::vector<char *> argv;
+	for (auto & arg : args) {
+		argv.push_back(const_cast<char*>(arg.c_str()));
+	}
+	Options::Parse(static_cast<int>(argv.size()), argv.data());
+}
+
+/* One statistic of the factory per name, in the order given */
+inline std::vector<std::unique_ptr<Statistic> > make_stats(const std::vector<std::string> & names)
+{
+	std::vector<std::unique_ptr<Statistic> > stats;
+	for (const std::string & name : names) {
+		stats.push_back(std::unique_ptr<Statistic>(StatisticFactory::CreateByName(name)));
+	}
+	return stats;
+}
+
+/* nseq sequences of ncol symbols, each drawn uniformly from `symbols`
+ * (repeat a symbol to make it more frequent, e.g. "--"), always the
+ * same for the same seed. */
+inline std::vector<std::string> random_sequences(int nseq, int ncol, const std::string & symbols, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> pick(0, static_cast<int>(symbols.size()) - 1);
+	std::vector<std::string> seqs(nseq, std::string(ncol, '-'));
+	for (std::string & seq : seqs) {
+		for (char & c : seq) {
+			c = symbols[pick(rng)];
+		}
+	}
+	return seqs;
+}
+
+/* Writes sequences as a FASTA file, named seq0, seq1... */
+inline void write_fasta(const std::string & path, const std::vector<std::string> & seqs)
+{
+	std::ofstream file(path.c_str());
+	expect(file.is_open(), "could not write alignment file: " + path);
+	for (size_t i = 0; i < seqs.size(); ++i) {
+		file << ">seq" << i << "\n" << seqs[i] << "\n";
+	}
+}
+
+/* Writes a random alignment of nseq x ncol, see random_sequences() */
+inline void write_random_alignment(const std::string & path, int nseq, int ncol, const std::string & symbols, unsigned seed)
+{
+	write_fasta(path, random_sequences(nseq, ncol, symbols, seed));
+}
+
 } // namespace test_helpers
 
 using test_helpers::almost_equal;
@@ -91,5 +150,10 @@ using test_helpers::expect;
 using test_helpers::read_col_stat_file;
 using test_helpers::read_global_stat_file;
 using test_helpers::read_mvector_file;
+using test_helpers::parse_args;
+using test_helpers::make_stats;
+using test_helpers::random_sequences;
+using test_helpers::write_fasta;
+using test_helpers::write_random_alignment;
 
 #endif
@@ -0,0 +1,184 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/mi.h"
+#include "../src/options.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Written by the test itself */
+const std::string SMALL  = "tests/fixtures/.mi_test_small.fasta";
+const std::string RANDOM = "tests/fixtures/.mi_test_random.fasta";
+const std::string OUTPUT = "tests/fixtures/.mi_test_output.txt";
+
+void parse_test_options(const std::string & input, const std::vector<std::string> & extra)
+{
+	std::vector<std::string> args = {"mstatx", "-i", input, "-o", OUTPUT, "-s", "mi", "-P", "matrix"};
+	args.insert(args.end(), extra.begin(), extra.end());
+	parse_args(args);
+}
+
+/* Columns 1 and 2 covary perfectly, column 3 is independent of both:
+ *   AD F
+ *   AD G
+ *   CE F
+ *   CE G
+ */
+void write_small_alignment()
+{
+	std::ofstream file(SMALL.c_str());
+	file << ">s1\nADF\n>s2\nADG\n>s3\nCEF\n>s4\nCEG\n";
+}
+
+/* 150 sequences x 150 columns (3 tiles of 64 columns at most), random
+ * symbols from alphabets of 3 to 9 of them, the even columns copying
+ * the previous one on 3 sequences out of 5 so that some pairs covary */
+void write_covarying_alignment()
+{
+	const std::string symbols = "ARNDCQEGHILKMFPSTWYV-";
+	std::vector<std::string> seqs = random_sequences(150, 150, symbols, 17);
+	for (size_t i = 0; i < seqs.size(); ++i) {
+		std::string & seq = seqs[i];
+		for (size_t j = 0; j < seq.size(); ++j) {
+			seq[j] = (j % 2 == 1 && (i + j) % 5 < 3) ? seq[j - 1] : symbols[symbols.find(seq[j]) % (j % 7 + 3)];
+		}
+	}
+	write_fasta(RANDOM, seqs);
+}
+
+/* With --pairs matrix, MIStat::write() prints the upper triangle of the
+ * L x L matrix, one row per line but the last, zeros on and below the
+ * diagonal */
+std::vector<std::vector<float> > calculate_and_read(Msa & msa, SimdLevel level = BestSimdLevel())
+{
+	MIStat stat;
+	stat.setSimdLevel(level);
+	stat.calculate(msa);
+	stat.print(msa);
+	std::ifstream file(OUTPUT.c_str());
+	std::vector<std::vector<float> > matrix(msa.getNcol(), std::vector<float>(msa.getNcol(), 0.0f));
+	for (int x = 0; x + 1 < msa.getNcol(); ++x) {
+		for (int y = 0; y < msa.getNcol(); ++y) {
+			file >> matrix[x][y];
+		}
+	}
+	expect(file.good(), "expected L - 1 rows of L scores");
+	return matrix;
+}
+
+/* The definition, in double, symbol by symbol */
+std::vector<std::vector<double> > reference_mip(Msa & msa)
+{
+	int L = msa.getNcol(), N = msa.getNseq();
+	const std::string alphabet = msa.getAlphabet();
+	int K = static_cast<int>(alphabet.size());
+	const std::vector<float> & w = msa.getSeqWeights();
+	std::vector<std::vector<double> > mi(L, std::vector<double>(L, 0.0));
+	for (int x = 0; x < L; ++x) {
+		for (int y = x + 1; y < L; ++y) {
+			std::vector<double> px(K, 0.0), py(K, 0.0), pxy(K * K, 0.0);
+			for (int s = 0; s < N; ++s) {
+				int a = msa.getAaPos(msa.getSymbol(s, x)), b = msa.getAaPos(msa.getSymbol(s, y));
+				px[a] += w[s];
+				py[b] += w[s];
+				pxy[a * K + b] += w[s];
+			}
+			for (int a = 0; a < K; ++a) {
+				for (int b = 0; b < K; ++b) {
+					if (pxy[a * K + b] > 0.0) {
+						mi[x][y] += pxy[a * K + b] * std::log(pxy[a * K + b] / (px[a] * py[b]));
+					}
+				}
+			}
+			mi[y][x] = mi[x][y];
+		}
+	}
+	std::vector<double> mean(L, 0.0);
+	double total = 0.0;
+	for (int x = 0; x < L; ++x) {
+		for (int y = 0; y < L; ++y) {
+			mean[x] += mi[x][y] / (L - 1);
+		}
+		total += mean[x] / L;
+	}
+	std::vector<std::vector<double> > mip(L, std::vector<double>(L, 0.0));
+	for (int x = 0; x < L; ++x) {
+		for (int y = x + 1; y < L; ++y) {
+			mip[x][y] = mi[x][y] - mean[x] * mean[y] / total;
+		}
+	}
+	return mip;
+}
+
+/* MI(1,2) = ln 2, the others 0; means ln 2 / 2, ln 2 / 2, 0 and ln 2 / 3:
+ * MIp(1,2) = ln 2 - (ln 2 / 2)^2 / (ln 2 / 3) = ln 2 / 4 */
+void test_small_alignment()
+{
+	for (const std::string weights : {"henikoff", "none"}) {
+		parse_test_options(SMALL, {"-W", weights});
+		Msa msa(SMALL);
+		std::vector<std::vector<float> > mip = calculate_and_read(msa);
+		expect(test_helpers::almost_equal(mip[0][1], std::log(2.0f) / 4), "covarying columns: MIp = ln 2 / 4 (" + weights + ")");
+		expect(test_helpers::almost_equal(mip[0][2], 0.0f) && test_helpers::almost_equal(mip[1][2], 0.0f), "independent columns: MIp = 0 (" + weights + ")");
+		expect(mip[1][0] == 0.0f && mip[2][2] == 0.0f, "the lower triangle should be printed as zeros");
+	}
+}
+
+/* Across tiles, threads and code paths, the scores are those of the
+ * definition (std::log), and the same bit for bit */
+void test_random_alignment_matches_the_definition()
+{
+	write_covarying_alignment();
+	std::vector<std::vector<float> > first;
+	for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::AVX2}) {
+		for (const std::string threads : {"1", "3"}) {
+			parse_test_options(RANDOM, {"-n", "1000", "-j", threads});
+			Msa msa(RANDOM);
+			std::vector<std::vector<double> > expected = reference_mip(msa);
+			std::vector<std::vector<float> > mip = calculate_and_read(msa, level);
+			for (int x = 0; x < msa.getNcol(); ++x) {
+				for (int y = x + 1; y < msa.getNcol(); ++y) {
+					expect(test_helpers::almost_equal(mip[x][y], static_cast<float>(expected[x][y]), 1e-5f), "MIp should match the definition");
+				}
+			}
+			if (first.empty()) {
+				first = mip;
+			}
+			expect(mip == first, "the scores should not depend on the number of threads or the code path");
+		}
+	}
+}
+
+/* mi reads every column for every pair: it cannot load them by chunks */
+void test_max_memory_is_rejected()
+{
+	bool threw = false;
+	try {
+		parse_test_options(SMALL, {"-M", "2"});
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "-s mi should be rejected with -M");
+}
+
+} // namespace
+
+int main()
+{
+	write_small_alignment();
+	test_small_alignment();
+	test_random_alignment_matches_the_definition();
+	test_max_memory_is_rejected();
+	std::remove(SMALL.c_str());
+	std::remove(RANDOM.c_str());
+	std::remove(OUTPUT.c_str());
+	std::cout << "All mi tests passed\n";
+	return 0;
+}
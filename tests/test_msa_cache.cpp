@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* A copy of a fixture, written by the test, so its cache (INPUT.msx)
+ * never lands next to the committed fixtures. */
+const std::string INPUT = "tests/fixtures/.msa_cache_test_input.fasta";
+const std::string CACHE = INPUT + ".msx";
+
+void write_input(const std::string & content)
+{
+	std::ofstream file(INPUT.c_str());
+	file << content;
+}
+
+void parse_test_options(bool cache, const std::string & nb_seq = "500")
+{
+	std::vector<std::string> args = {"mstatx", "-i", INPUT, "-n", nb_seq};
+	if (cache) {
+		args.push_back("-C");
+	}
+	parse_args(args);
+}
+
+bool file_exists(const std::string & fname)
+{
+	return std::ifstream(fname.c_str()).good();
+}
+
+/* Everything Msa gives the statistics must be the same, read from the
+ * alignment or from its cache. */
+void expect_same_msa(Msa & a, Msa & b)
+{
+	expect(a.getNseq() == b.getNseq() && a.getNcol() == b.getNcol(), "same dimensions");
+	expect(a.getAlphabet() == b.getAlphabet(), "same alphabet");
+	expect(a.getGapCount() == b.getGapCount(), "same gap counts");
+	expect(a.getSeqWeights() == b.getSeqWeights(), "same sequence weights");
+	expect(a.getCounts() == b.getCounts(), "same column counts");
+	expect(a.getWeightedCounts() == b.getWeightedCounts(), "same weighted counts");
+	for (char c : a.getAlphabet()) {
+		expect(a.getFreq(c) == b.getFreq(c), "same symbol frequencies");
+	}
+	for (int col = 0; col < a.getNcol(); ++col) {
+		expect(a.getNtype(col) == b.getNtype(col), "same number of types");
+		expect(a.getTypeList(col) == b.getTypeList(col), "same type lists");
+		for (int seq = 0; seq < a.getNseq(); ++seq) {
+			expect(a.getSymbol(seq, col) == b.getSymbol(seq, col), "same symbols");
+		}
+	}
+}
+
+/* -C writes the cache on the first load, and the next loads give the
+ * same alignment back from it. */
+void test_cache_round_trip()
+{
+	std::remove(CACHE.c_str());
+	write_input(">seq1 first\nACDE\n>seq2\nACGE\n>seq3\nA--E\n>seq4\nXCGE\n");
+
+	parse_test_options(false);
+	Msa reference(INPUT);
+	expect(!file_exists(CACHE), "no cache should be written without -C");
+
+	parse_test_options(true);
+	Msa first(INPUT);
+	expect(file_exists(CACHE), "-C should write the cache");
+	Msa cached(INPUT);
+	expect_same_msa(reference, first);
+	expect_same_msa(reference, cached);
+
+	/* fitToAlphabet() must work on the matrix mapped from the cache */
+	reference.fitToAlphabet("ACDE");
+	cached.fitToAlphabet("ACDE");
+	expect_same_msa(reference, cached);
+}
+
+/* A cache written for another version of the file, or another -n,
+ * is not used. */
+void test_stale_cache_is_rebuilt()
+{
+	parse_test_options(true);
+	write_input(">seq1\nACDE\n>seq2\nACGE\n");
+	Msa before(INPUT);
+	expect(before.getNseq() == 2, "cache should be written for 2 sequences");
+
+	write_input(">seq1\nACDEF\n>seq2\nACGEF\n>seq3\nAC-EF\n");
+	Msa after(INPUT);
+	expect(after.getNseq() == 3 && after.getNcol() == 5, "a modified file should be read again");
+
+	parse_test_options(true, "2");
+	Msa fewer(INPUT);
+	expect(fewer.getNseq() == 2, "another -n should not use the cache");
+
+	/* The version follows the 4 bytes of the magic number */
+	uint32_t version = 1;
+	{
+		std::fstream cache(CACHE.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		cache.seekp(4);
+		cache.write(reinterpret_cast<const char *>(&version), sizeof(version));
+	}
+	Msa older(INPUT);
+	std::ifstream rewritten(CACHE.c_str(), std::ios::binary);
+	rewritten.seekg(4);
+	rewritten.read(reinterpret_cast<char *>(&version), sizeof(version));
+	expect(older.getNseq() == 2 && version > 1, "a cache of an older version should be rewritten");
+}
+
+/* A damaged cache is ignored, and replaced */
+void test_truncated_cache_is_ignored()
+{
+	parse_test_options(true);
+	write_input(">seq1\nACDE\n>seq2\nACGE\n>seq3\nA--E\n");
+	Msa written(INPUT);
+
+	std::ifstream in(CACHE.c_str(), std::ios::binary);
+	std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	std::ofstream out(CACHE.c_str(), std::ios::binary);
+	out.write(content.data(), static_cast<std::streamsize>(content.size() / 2));
+	out.close();
+
+	Msa reread(INPUT);
+	expect(reread.getNseq() == 3 && reread.getCol(2) == "DG-", "a truncated cache should be ignored");
+	std::ifstream rewritten(CACHE.c_str(), std::ios::binary | std::ios::ate);
+	expect(static_cast<size_t>(rewritten.tellg()) == content.size(), "a truncated cache should be rewritten");
+
+	std::remove(CACHE.c_str());
+	std::remove(INPUT.c_str());
+}
+
+} // namespace
+
+int main()
+{
+	test_cache_round_trip();
+	test_stale_cache_is_rebuilt();
+	test_truncated_cache_is_ignored();
+	std::cout << "All msa cache tests passed\n";
+	return 0;
+}
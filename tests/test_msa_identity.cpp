@@ -0,0 +1,183 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/statistic.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Written by the test itself */
+const std::string SMALL  = "tests/fixtures/.identity_test_small.fasta";
+const std::string RANDOM = "tests/fixtures/.identity_test_random.fasta";
+
+void parse_test_options(const std::string & input, const std::vector<std::string> & extra)
+{
+	std::vector<std::string> args = {"mstatx", "-i", input};
+	args.insert(args.end(), extra.begin(), extra.end());
+	parse_args(args);
+}
+
+/* seq1 is seq0 with 2 changes out of 10 (80% identity), seq2 shares 7
+ * columns with both and seq3 none: clusters {0,1}, {2}, {3} at 0.8,
+ * {0,1,2}, {3} at 0.7 */
+void write_small_alignment()
+{
+	std::ofstream file(SMALL.c_str());
+	file << ">seq0\nACDEFGHIKL\n";
+	file << ">seq1\nACDEFGHI--\n";
+	file << ">seq2\nACDEFGHWWW\n";
+	file << ">seq3\nWWWWWWWWWW\n";
+}
+
+/* nseq sequences of ncol columns, in families: copies of a few parents
+ * with 0 to 40% of their columns changed, so that the identities fall
+ * on both sides of the threshold */
+void write_clustered_alignment(int nseq, int ncol)
+{
+	static const char SYMBOLS[] = "ARNDCQEGHILKMFPSTWYV-";
+	std::mt19937 rng(16);
+	std::uniform_int_distribution<int> pick(0, static_cast<int>(sizeof(SYMBOLS)) - 2);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::vector<std::string> parents(9, std::string(ncol, '-'));
+	for (std::string & parent : parents) {
+		for (char & c : parent) {
+			c = SYMBOLS[pick(rng)];
+		}
+	}
+	std::ofstream file(RANDOM.c_str());
+	for (int i = 0; i < nseq; ++i) {
+		std::string seq = parents[i % parents.size()];
+		double rate = 0.4 * uniform(rng);
+		for (char & c : seq) {
+			if (uniform(rng) < rate) {
+				c = SYMBOLS[pick(rng)];
+			}
+		}
+		file << ">seq" << i << "\n" << seq << "\n";
+	}
+}
+
+/* The definition: every pair of sequences compared symbol by symbol */
+std::vector<int> reference_neighbours(Msa & msa, float identity)
+{
+	int nseq = msa.getNseq();
+	int ncol = msa.getNcol();
+	std::vector<int> neighbours(nseq, 0);
+	for (int i = 0; i < nseq; ++i) {
+		for (int j = 0; j < nseq; ++j) {
+			int matches = 0;
+			for (int col = 0; col < ncol; ++col) {
+				matches += msa.getSymbol(i, col) == msa.getSymbol(j, col);
+			}
+			neighbours[i] += matches >= identity * ncol;
+		}
+	}
+	return neighbours;
+}
+
+void test_small_alignment_clusters()
+{
+	parse_test_options(SMALL, {"-W", "identity"});
+	Msa msa(SMALL);
+	const std::vector<float> & weights = msa.getSeqWeights();
+	expect(weights.size() == 4, "expected one weight per sequence");
+	expect(test_helpers::almost_equal(msa.getNeff(), 3.0f), "an identity of exactly -I should join a cluster");
+	expect(test_helpers::almost_equal(weights[0], 1.0f / 6) && test_helpers::almost_equal(weights[1], 1.0f / 6), "a cluster of 2 should share its weight");
+	expect(test_helpers::almost_equal(weights[2], 1.0f / 3) && test_helpers::almost_equal(weights[3], 1.0f / 3), "singletons should weigh 1 / Neff");
+
+	parse_test_options(SMALL, {"-W", "identity", "-I", "0.7"});
+	Msa looser(SMALL);
+	expect(test_helpers::almost_equal(looser.getNeff(), 2.0f), "seq0, seq1 and seq2 should share 7 columns each, a cluster at 0.7");
+
+	parse_test_options(SMALL, {});
+	Msa henikoff(SMALL);
+	expect(henikoff.getSeqWeights() == henikoff.getHenikoffWeights(), "the Henikoff weights should stay the default");
+}
+
+/* Every code path and number of threads counts the same neighbours as
+ * the definition: 300 sequences (an odd number of tiles, the last one
+ * partial) or 270 (an even number) of 70 columns (padded rows) */
+void test_code_paths_agree_with_the_definition()
+{
+	for (int nseq : {300, 270}) {
+		write_clustered_alignment(nseq, 70);
+		parse_test_options(RANDOM, {"-W", "identity"});
+		Msa reference(RANDOM);
+		std::vector<int> neighbours = reference_neighbours(reference, 0.8f);
+		double neff = 0.0;
+		for (int n : neighbours) {
+			neff += 1.0 / n;
+		}
+		expect(neff > 9.5 && neff < nseq - 10, "the alignment should have clusters, and more than its families");
+
+		std::vector<float> first;
+		for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX2}) {
+			for (const std::string threads : {"1", "4"}) {
+				parse_test_options(RANDOM, {"-W", "identity", "-j", threads});
+				Msa msa(RANDOM);
+				msa.setSimdLevel(level);
+				const std::vector<float> & weights = msa.getSeqWeights();
+				expect(test_helpers::almost_equal(msa.getNeff(), static_cast<float>(neff), 1e-3f), "Neff should be the sum of 1 / cluster size");
+				for (int seq = 0; seq < nseq; ++seq) {
+					expect(test_helpers::almost_equal(weights[seq] * static_cast<float>(neff), 1.0f / neighbours[seq]), "weights should be 1 / cluster size / Neff");
+				}
+				if (first.empty()) {
+					first = weights;
+				}
+				expect(weights == first, "the code paths and threads should give the same weights, bit for bit");
+			}
+		}
+	}
+}
+
+/* The statistics weighting the sequences read the selected weights */
+void test_statistics_use_the_identity_weights()
+{
+	AddAllStatistics();
+	std::vector<std::vector<float> > scores;
+	for (const std::string weights : {"henikoff", "identity"}) {
+		parse_test_options(RANDOM, {"-W", weights, "-s", "wentropy"});
+		Msa msa(RANDOM);
+		std::unique_ptr<Statistic> stat(StatisticFactory::CreateByName("wentropy"));
+		stat->calculate(msa);
+		scores.push_back(dynamic_cast<Stat1D &>(*stat).getColStat());
+	}
+	expect(scores[0].size() == scores[1].size() && scores[0] != scores[1], "wentropy should change with the weights");
+}
+
+void test_weights_option_validation()
+{
+	for (const std::vector<std::string> & extra : std::vector<std::vector<std::string> >{
+	         {"-W", "uniform"}, {"-W", "identity", "-I", "0"}, {"-W", "identity", "-I", "1.5"}, {"-W", "identity", "-M", "10"}}) {
+		bool threw = false;
+		try {
+			parse_test_options(SMALL, extra);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		expect(threw, "invalid weight options should be rejected: " + extra[1] + (extra.size() > 2 ? " " + extra[2] + " " + extra[3] : ""));
+	}
+}
+
+} // namespace
+
+int main()
+{
+	write_small_alignment();
+	test_small_alignment_clusters();
+	test_code_paths_agree_with_the_definition();
+	test_statistics_use_the_identity_weights();
+	test_weights_option_validation();
+	std::remove(SMALL.c_str());
+	std::remove(RANDOM.c_str());
+	std::cout << "All identity weights tests passed\n";
+	return 0;
+}
@@ -78,6 +78,89 @@ void test_fit_to_alphabet_converts_unknown_symbols_to_gaps()
     expect(msa.getAlphabet().find('D') == std::string::npos, "removed symbol should no longer be in the alphabet");
 }
 
+/* getColCodes(col) is the transposed, encoded copy of the alignment:
+ * every code must decode (through the alphabet) to the symbol at the
+ * same place in the row-major alignment. */
+void test_col_codes_match_symbols()
+{
+    parse_test_options();
+    Msa msa("tests/fixtures/simple_alignment.fasta");
+
+    const std::string alphabet = msa.getAlphabet();
+    for (int col = 0; col < msa.getNcol(); ++col) {
+        const uint8_t * codes = msa.getColCodes(col);
+        for (int seq = 0; seq < msa.getNseq(); ++seq) {
+            expect(codes[seq] < alphabet.size(), "code should be a valid alphabet position");
+            expect(alphabet[codes[seq]] == msa.getSymbol(seq, col), "code should decode to the symbol at (seq, col)");
+        }
+    }
+    expect(msa.getColCodes(1)[2] == msa.getAaPos('-'), "gap of seq3 in column 1 should carry the gap code");
+}
+
+/* fitToAlphabet() changes both the symbols and the alphabet, so the
+ * codes must be rebuilt; and symbols turned into gaps need a gap code
+ * even when the alignment had no gap before
+ * (tests/fixtures/trident_ambiguous.fasta: AA/AA/AA/AX, no gap). */
+void test_col_codes_follow_fit_to_alphabet()
+{
+    parse_test_options();
+    Msa msa("tests/fixtures/trident_ambiguous.fasta");
+    expect(msa.getAaPos('-') == -1, "fixture should have no gap before fitToAlphabet");
+
+    msa.fitToAlphabet("A");
+
+    expect(msa.getAaPos('-') >= 0, "the gap should have been added to the alphabet");
+    expect(msa.getColCodes(1)[3] == msa.getAaPos('-'), "the former X should be encoded as a gap");
+    expect(msa.getColCodes(1)[0] == msa.getAaPos('A'), "A should still be encoded as A");
+}
+
+/* getCounts()/getWeightedCounts() are flat ncol x K tables, K being the
+ * alignment alphabet size. simple_alignment.fasta reads column by column
+ * as AAA / CC- / DG- / EEE. Henikoff weights sum to 1, so every column
+ * of the weighted table sums to 1 too. */
+void test_column_profiles()
+{
+    parse_test_options();
+    Msa msa("tests/fixtures/simple_alignment.fasta");
+    const int K = static_cast<int>(msa.getAlphabet().size());
+
+    const std::vector<int> & counts = msa.getCounts();
+    expect(counts.size() == static_cast<size_t>(4 * K), "counts should hold ncol * K values");
+    expect(counts[0 * K + msa.getAaPos('A')] == 3, "column 0 holds three A");
+    expect(counts[1 * K + msa.getAaPos('C')] == 2, "column 1 holds two C");
+    expect(counts[1 * K + msa.getAaPos('-')] == 1, "column 1 holds one gap");
+    expect(counts[2 * K + msa.getAaPos('A')] == 0, "column 2 holds no A");
+
+    const std::vector<float> & wcounts = msa.getWeightedCounts();
+    const std::vector<float> & w = msa.getSeqWeights();
+    expect(wcounts.size() == counts.size(), "weighted counts should hold ncol * K values");
+    expect(almost_equal(wcounts[1 * K + msa.getAaPos('C')], w[0] + w[1]), "C of column 1 weighs w1 + w2");
+    expect(almost_equal(wcounts[2 * K + msa.getAaPos('G')], w[1]), "G of column 2 weighs w2");
+    for (int col = 0; col < 4; ++col) {
+        float total = 0.0f;
+        for (int a = 0; a < K; ++a) {
+            total += wcounts[col * K + a];
+        }
+        expect(almost_equal(total, 1.0f), "weighted counts of a column should sum to 1");
+    }
+    expect(&msa.getCounts() == &counts, "counts should be cached, not recomputed");
+}
+
+/* After fitToAlphabet() the alphabet changes, so the cached profiles
+ * must be recounted against it. */
+void test_column_profiles_follow_fit_to_alphabet()
+{
+    parse_test_options();
+    Msa msa("tests/fixtures/simple_alignment.fasta");
+    msa.getCounts();
+
+    msa.fitToAlphabet("AC");
+    const int K = static_cast<int>(msa.getAlphabet().size());
+    const std::vector<int> & counts = msa.getCounts();
+    expect(counts.size() == static_cast<size_t>(4 * K), "counts should follow the new alphabet size");
+    expect(counts[2 * K + msa.getAaPos('-')] == 3, "column 2 is now all gaps");
+}
+
 /* Regression test for a real crash found while cleaning up error paths:
  * a nonexistent -i file used to make Msa's constructor throw
  * std::runtime_error uncaught all the way up through main() (which
@@ -108,6 +191,10 @@ int main()
     test_msa_gap_and_frequency();
     test_msa_seq_weights();
     test_fit_to_alphabet_converts_unknown_symbols_to_gaps();
+    test_col_codes_match_symbols();
+    test_col_codes_follow_fit_to_alphabet();
+    test_column_profiles();
+    test_column_profiles_follow_fit_to_alphabet();
     test_msa_nonexistent_file_throws();
     std::cout << "All tests passed\n";
     return 0;
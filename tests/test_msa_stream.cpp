@@ -0,0 +1,157 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/mvector.h"
+#include "../src/options.h"
+#include "../src/statistic.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Written by the test itself: 40 sequences x 300 columns, on lines of
+ * 37 residues ending with "\r\n", so that the chunks of columns start
+ * and end in the middle of lines, and on line breaks. */
+const std::string INPUT  = "tests/fixtures/.msa_stream_test_input.fasta";
+const std::string MATRIX = "data/aaindex/HENS920102.mat";
+const int NSEQ = 40;
+const int NCOL = 300;
+
+void write_wrapped_alignment()
+{
+	std::vector<std::string> seqs = random_sequences(NSEQ, NCOL, "ARNDCQEGHILKMFPSTWYVXarnd--", 11);
+	std::ofstream file(INPUT.c_str(), std::ios::binary);
+	for (int i = 0; i < NSEQ; ++i) {
+		file << ">seq" << i << " random\r\n";
+		for (int j = 0; j < NCOL; j += 37) {
+			file << seqs[i].substr(j, 37) << "\r\n";
+		}
+	}
+}
+
+/* max_memory in MB: 0.0001 MB is 104 bytes, 2 columns of 40 sequences */
+void parse_test_options(const std::string & max_memory, const std::string & threads = "1")
+{
+	parse_args({"mstatx", "-i", INPUT, "-m", MATRIX, "-M", max_memory, "-j", threads});
+}
+
+/* The symbols of every column, through forColumnChunks() */
+std::vector<std::string> all_columns(Msa & msa)
+{
+	std::vector<std::string> columns(msa.getNcol());
+	int next = 0;
+	msa.forColumnChunks([&](int begin, int end) {
+		expect(begin == next && begin < end, "chunks should follow each other");
+		for (int col = begin; col < end; ++col) {
+			columns[col] = msa.getCol(col);
+		}
+		next = end;
+	});
+	expect(next == msa.getNcol(), "chunks should cover all the columns");
+	return columns;
+}
+
+/* Everything Msa gives the statistics must be the same, bit for bit,
+ * read at once or by chunks of columns. */
+void expect_same_msa(Msa & a, Msa & b, const std::string & what)
+{
+	expect(a.getNseq() == b.getNseq() && a.getNcol() == b.getNcol(), what + ": same dimensions");
+	expect(a.getAlphabet() == b.getAlphabet(), what + ": same alphabet");
+	expect(a.getGapCount() == b.getGapCount(), what + ": same gap counts");
+	expect(a.getSeqWeights() == b.getSeqWeights(), what + ": same sequence weights");
+	expect(a.getCounts() == b.getCounts(), what + ": same column counts");
+	expect(a.getWeightedCounts() == b.getWeightedCounts(), what + ": same weighted counts");
+	for (char c : a.getAlphabet()) {
+		expect(a.getFreq(c) == b.getFreq(c), what + ": same symbol frequencies");
+	}
+	for (int col = 0; col < a.getNcol(); ++col) {
+		expect(a.getNtype(col) == b.getNtype(col), what + ": same number of types");
+		expect(a.getTypeList(col) == b.getTypeList(col), what + ": same type lists");
+	}
+	expect(all_columns(a) == all_columns(b), what + ": same symbols");
+}
+
+/* Runs every statistic on msa */
+std::vector<std::vector<float> > run_all(Msa & msa)
+{
+	std::vector<std::vector<float> > results;
+	for (const char * name : {"wentropy", "trident", "jensen", "kabat", "gap"}) {
+		std::unique_ptr<Statistic> stat(StatisticFactory::CreateByName(name));
+		stat->calculate(msa);
+		results.push_back(dynamic_cast<Stat1D &>(*stat).getColStat());
+	}
+	MVectStat mvector;
+	mvector.calculate(msa);
+	for (const auto & mean : mvector.getMeans()) {
+		results.push_back(mean);
+	}
+	return results;
+}
+
+/* Chunks of 2 columns, 26 columns, and one chunk of all the columns,
+ * with one or several threads, give the alignment read at once. */
+void test_chunks_give_the_same_msa()
+{
+	parse_test_options("0");
+	Msa whole(INPUT);
+	expect(!whole.isChunked(), "-M 0 should read the whole alignment");
+	std::vector<std::vector<float> > expected = run_all(whole);
+	expect(expected[0].size() == NCOL, "expected one score per column");
+
+	for (const std::string max_memory : {"0.0001", "0.001", "1"}) {
+		for (const std::string threads : {"1", "3"}) {
+			parse_test_options(max_memory, threads);
+			Msa chunked(INPUT);
+			expect(chunked.isChunked(), "-M should read the alignment by chunks");
+			expect_same_msa(whole, chunked, "-M " + max_memory + " -j " + threads);
+			expect(run_all(chunked) == expected, "statistics with -M " + max_memory + " -j " + threads + " should be identical");
+		}
+	}
+}
+
+/* fitToAlphabet() recodes the chunks loaded after it */
+void test_fit_to_alphabet_by_chunks()
+{
+	parse_test_options("0");
+	Msa whole(INPUT);
+	parse_test_options("0.0001");
+	Msa chunked(INPUT);
+	/* The weights are computed by the first pass: compute them before too */
+	whole.getWeightedCounts();
+	chunked.getWeightedCounts();
+	whole.fitToAlphabet("ACDE");
+	chunked.fitToAlphabet("ACDE");
+	expect_same_msa(whole, chunked, "after fitToAlphabet");
+}
+
+void test_max_memory_option_validation()
+{
+	parse_test_options("0");
+	expect(Options::Get().max_memory == 0.0f, "-M 0 should be accepted");
+	bool threw = false;
+	try {
+		parse_test_options("-1");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "a negative -M should be rejected");
+}
+
+} // namespace
+
+int main()
+{
+	AddAllStatistics();
+	write_wrapped_alignment();
+	test_chunks_give_the_same_msa();
+	test_fit_to_alphabet_by_chunks();
+	test_max_memory_option_validation();
+	std::remove(INPUT.c_str());
+	std::cout << "All msa stream tests passed\n";
+	return 0;
+}
@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -5,6 +6,7 @@
 #include "../src/msa.h"
 #include "../src/mvector.h"
 #include "../src/options.h"
+#include "../src/scoring_matrix.h"
 #include "test_helpers.h"
 
 namespace {
@@ -98,11 +100,56 @@ void test_mvector_nominal_values_on_synthetic_alignment()
 	expect(almost_equal(table[2][G], 0.204545f, 1e-3f), "col 2, vs G (diluted by the gap)");
 }
 
+/* Written by the test itself: 60 sequences x 37 columns (not a multiple
+ * of the blocks of columns) with gaps and symbols out of the matrix */
+const std::string RANDOM_INPUT = "tests/fixtures/.mvector_test_random.fasta";
+
+/* Every code path of the profile x matrix product gives the same
+ * floats, and the means of the definition: the normalized scores of
+ * the sequences added one by one, divided by N. */
+void test_mvector_code_paths_agree_with_the_definition()
+{
+	parse_test_options();
+	write_random_alignment(RANDOM_INPUT, 60, 37, "ARNDCQEGHILKMFPSTWYVXB--", 5);
+	Msa msa(RANDOM_INPUT);
+	const ScoringMatrix & sm = ScoringMatrix::Get(MATRIX);
+	const std::string alphabet = sm.getAlphabet();
+
+	MVectStat scalar;
+	scalar.setSimdLevel(SimdLevel::Scalar);
+	scalar.calculate(msa);
+	for (SimdLevel level : {SimdLevel::SSE, SimdLevel::AVX2}) {
+		if (level > BestSimdLevel()) {
+			continue;
+		}
+		MVectStat simd;
+		simd.setSimdLevel(level);
+		simd.calculate(msa);
+		expect(simd.getMeans() == scalar.getMeans(), "every code path should give the same means");
+	}
+
+	for (int col = 0; col < msa.getNcol(); ++col) {
+		for (int a = 0; a < ALPHABET_SIZE; ++a) {
+			double mean = 0.0;
+			for (int seq = 0; seq < msa.getNseq(); ++seq) {
+				char symbol = msa.getSymbol(seq, col);
+				if (symbol != '-' && alphabet.find(symbol) != std::string::npos) {
+					mean += sm.normScore(alphabet[a], symbol);
+				}
+			}
+			mean /= msa.getNseq();
+			expect(almost_equal(scalar.getMeans()[col][a], static_cast<float>(mean), 1e-5f), "means should follow the definition");
+		}
+	}
+	std::remove(RANDOM_INPUT.c_str());
+}
+
 } // namespace
 
 int main()
 {
 	test_mvector_nominal_values_on_synthetic_alignment();
+	test_mvector_code_paths_agree_with_the_definition();
 	std::cout << "All mvector tests passed\n";
 	return 0;
 }
@@ -8,11 +8,8 @@
 namespace {
 
 /* Defaults, when only the required -i is given. Everything else should
- * fall back to the values documented in options.h. matrix_fname is only
- * checked by suffix: its default is smat_path + "/HENS920102.mat", and
- * smat_path comes from the SCORE_MAT_PATH environment variable when
- * set, "data/aaindex" otherwise - asserting the whole path would make
- * this test depend on the environment it happens to run in. */
+ * fall back to the values documented in options.h. The default matrix
+ * is the built-in HENS920102, whatever the environment. */
 void test_options_defaults()
 {
 	char *argv[] = {
@@ -24,7 +21,11 @@ void test_options_defaults()
 	const Options & opt = Options::Get();
 	expect(opt.input_fname == "tests/fixtures/jensen_tiny.fasta", "input_fname should be the given path");
 	expect(opt.output_fname == "output.txt", "default output_fname should be output.txt");
+	expect(opt.format == "text", "default output format should be text");
+	expect(opt.profile.empty(), "profiling should be off by default");
+	expect(opt.trace.empty(), "tracing should be off by default");
 	expect(opt.statistic == "wentropy", "default statistic should be wentropy");
+	expect(opt.statistics.size() == 1 && opt.statistics[0] == "wentropy", "default statistics list should be {wentropy}");
 	expect(opt.nb_seq == 500, "default nb_seq should be 500");
 	expect(opt.verbose == false, "default verbose should be false");
 	expect(opt.global == false, "default global should be false");
@@ -33,8 +34,13 @@ void test_options_defaults()
 	expect(almost_equal(opt.factor_b, 0.5f), "default factor_b should be 0.5");
 	expect(almost_equal(opt.factor_c, 3.0f), "default factor_c should be 3.0");
 	expect(opt.window == 3, "default window should be 3");
-	expect(opt.matrix_fname.find("HENS920102.mat") != std::string::npos,
-	       "default matrix_fname should point at HENS920102.mat");
+	expect(opt.smooth == "none", "default smoothing should be none");
+	expect(opt.matrix_fname == "HENS920102", "default matrix should be the built-in HENS920102");
+	expect(opt.aaindex_fname == "data/aaindex/aaindex2.txt", "default AAindex2 database should be the bundled one");
+	expect(opt.weights == "henikoff", "default sequence weights should be henikoff");
+	expect(opt.pairs == "threshold", "default pair output should be threshold");
+	expect(opt.top == 10, "default number of pairs per column should be 10");
+	expect(almost_equal(opt.identity, 0.8f), "default identity should be 0.8");
 }
 
 /* Every switch/value argument, given a non-default value, should come
@@ -233,6 +239,53 @@ void test_arg_clone_preserves_the_derived_type_and_value()
 	delete cloned_switch;
 }
 
+/* -s takes a comma-separated list: statistic keeps the raw text,
+ * statistics the names in order. An empty item is a typo worth
+ * reporting, not a name to look up. */
+void test_options_statistic_list()
+{
+	char *argv[] = {
+		const_cast<char*>("mstatx"),
+		const_cast<char*>("-i"), const_cast<char*>("tests/fixtures/jensen_tiny.fasta"),
+		const_cast<char*>("-s"), const_cast<char*>("wentropy,trident,jensen")
+	};
+	Options::Parse(sizeof(argv) / sizeof(argv[0]), argv);
+
+	const Options & opt = Options::Get();
+	expect(opt.statistic == "wentropy,trident,jensen", "statistic should keep the list as given");
+	expect(opt.statistics.size() == 3, "the list should hold 3 statistics");
+	expect(opt.statistics[0] == "wentropy" && opt.statistics[1] == "trident" && opt.statistics[2] == "jensen",
+	       "statistics should be in the order given");
+
+	char *bad_argv[] = {
+		const_cast<char*>("mstatx"),
+		const_cast<char*>("-i"), const_cast<char*>("tests/fixtures/jensen_tiny.fasta"),
+		const_cast<char*>("-s"), const_cast<char*>("wentropy,,jensen")
+	};
+	bool threw = false;
+	try {
+		Options::Parse(sizeof(bad_argv) / sizeof(bad_argv[0]), bad_argv);
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "an empty item in the -s list should throw std::runtime_error");
+}
+
+/* Sampling reads each sample whole: it cannot keep to a memory budget */
+void test_options_tolerance_rejects_max_memory()
+{
+	bool threw = false;
+	try {
+		parse_args({"mstatx", "-i", "tests/fixtures/jensen_tiny.fasta", "-e", "0.01", "-M", "10"});
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "-e together with -M should throw std::runtime_error");
+
+	parse_args({"mstatx", "-i", "tests/fixtures/jensen_tiny.fasta", "-e", "0.01"});
+	expect(almost_equal(Options::Get().tolerance, 0.01f), "-e alone should be accepted");
+}
+
 } // namespace
 
 int main()
@@ -244,6 +297,8 @@ int main()
 	test_options_parse_recovers_after_a_previous_failed_parse();
 	test_options_help_flag_throws_immediately_with_empty_message();
 	test_arg_clone_preserves_the_derived_type_and_value();
+	test_options_statistic_list();
+	test_options_tolerance_rejects_max_memory();
 	std::cout << "All options tests passed\n";
 	return 0;
 }
@@ -0,0 +1,205 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/profile.h"
+#include "../src/thread_pool.h"
+#include "test_helpers.h"
+
+namespace {
+
+const std::string FIXTURE = "tests/fixtures/jensen_tiny.fasta";
+/* Written by the test itself */
+const std::string JSON    = "tests/fixtures/.profile_test.json";
+const std::string TRACE   = "tests/fixtures/.profile_test_trace.json";
+
+void parse_test_options(const std::vector<std::string> & extra)
+{
+	std::vector<std::string> args = {"mstatx", "-i", FIXTURE};
+	args.insert(args.end(), extra.begin(), extra.end());
+	parse_args(args);
+}
+
+const Profiler::Phase * find_phase(const std::vector<Profiler::Phase> & phases, const std::string & path)
+{
+	for (const Profiler::Phase & phase : phases) {
+		if (phase.path == path) {
+			return &phase;
+		}
+	}
+	return nullptr;
+}
+
+std::string read_file(const std::string & path)
+{
+	std::ifstream file(path.c_str());
+	return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+size_t count_spans(const std::vector<Tracer::Buffer> & threads)
+{
+	size_t n = 0;
+	for (const Tracer::Buffer & thread : threads) {
+		n += thread.spans.size();
+	}
+	return n;
+}
+
+/* Nothing is recorded before enable() */
+void test_disabled()
+{
+	{
+		ProfileScope phase("ignored");
+		TraceScope span("ignored", "chunk");
+		span.arg("begin", 0);
+	}
+	expect(!Profiler::Get().isEnabled() && Profiler::Get().getPhases().empty(), "a phase should not be recorded without --profile");
+	expect(!Tracer::Get().isEnabled() && count_spans(Tracer::Get().getBuffers()) == 0, "a span should not be recorded without --trace");
+}
+
+/* The phases started within another are its children, the phases of
+ * the same name add up */
+void test_nested_phases()
+{
+	Profiler::Get().enable();
+	for (int i = 0; i < 3; ++i) {
+		ProfileScope outer("outer");
+		{
+			ProfileScope inner("inner");
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		ProfileScope second("second");
+	}
+	{
+		ProfileScope other("other");
+	}
+	std::vector<Profiler::Phase> phases = Profiler::Get().getPhases();
+	expect(phases.size() == 4, "expected outer, outer/inner, outer/second and other");
+	expect(phases[0].path == "outer" && phases[1].path == "outer/inner", "a phase should be listed before its children");
+	const Profiler::Phase * outer = find_phase(phases, "outer");
+	const Profiler::Phase * inner = find_phase(phases, "outer/inner");
+	expect(outer && inner && find_phase(phases, "outer/second") && find_phase(phases, "other"), "the phases should be named after their parents");
+	expect(outer->depth == 0 && inner->depth == 1 && find_phase(phases, "other")->depth == 0, "the depth should be the number of parents");
+	expect(outer->calls == 3 && inner->calls == 3, "the calls of a phase should add up");
+	expect(inner->wall >= 0.015 && outer->wall >= inner->wall, "a phase should last at least as long as its children");
+	expect(inner->cpu >= 0.0 && inner->cpu < inner->wall, "a sleeping phase should use less CPU than wall-clock time");
+	expect(outer->peak_rss > 0.0, "the peak memory should be recorded");
+
+	Profiler::Get().clear();
+	expect(Profiler::Get().getPhases().empty(), "clear() should forget the phases");
+}
+
+/* The alignment reports its phases, and the report lists them */
+void test_alignment_phases()
+{
+	parse_test_options({"-p", JSON});
+	expect(Options::Get().profile == JSON, "-p should give the JSON file");
+	Profiler::Get().clear();
+	Msa msa(FIXTURE);
+	msa.getWeightedCounts();
+	Profiler::Get().addAlignment(msa.getNseq(), msa.getNcol());
+	std::vector<Profiler::Phase> phases = Profiler::Get().getPhases();
+	for (const std::string path : {"read", "analyse", "analyse/alphabet", "analyse/encode", "analyse/count", "analyse/count/counts", "analyse/entropy", "weighted counts", "weighted counts/weights"}) {
+		expect(find_phase(phases, path) != nullptr, "the alignment should record the phase " + path);
+	}
+
+	std::ostringstream table;
+	Profiler::Get().writeTable(table);
+	expect(table.str().find("  alphabet") != std::string::npos, "the children should be indented in the table");
+	expect(table.str().find("total") != std::string::npos, "the table should end with the total");
+	expect(table.str().find("(1 alignment, 12 residues, 3 columns)") != std::string::npos, "the table should give the size of the alignments");
+
+	Profiler::Get().writeJson(JSON, "mstatx -p \"quoted\"");
+	std::string json = read_file(JSON);
+	expect(json.find("\"command\": \"mstatx -p \\\"quoted\\\"\"") != std::string::npos, "the command should be escaped");
+	expect(json.find("\"residues\": 12, \"columns\": 3") != std::string::npos, "the JSON should give the size of the alignments");
+	expect(json.find("{\"name\": \"analyse/count\", \"depth\": 1, \"calls\": 1, \"wall_s\": ") != std::string::npos, "the JSON should list the phases");
+	for (const std::string key : {"\"cpu_s\"", "\"peak_rss_mb\"", "\"residues_per_s\"", "\"columns_per_s\""}) {
+		expect(json.find(key) != std::string::npos, "the JSON should give " + key);
+	}
+	expect(json.front() == '{' && json.compare(json.size() - 2, 2, "}\n") == 0, "the JSON should be a single object");
+}
+
+/* The chunks of a loop are spans of the threads that processed them,
+ * covering the loop once; the phases are spans too, ending after
+ * their children */
+void test_trace()
+{
+	parse_test_options({"-j", "3"});
+	Tracer::Get().enable();
+	{
+		ProfileScope phase("loop");
+		ParallelFor(0, 1000, [](int, int){
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		});
+	}
+	std::vector<Tracer::Buffer> threads = Tracer::Get().getBuffers();
+	std::set<int> tids;
+	std::vector<int> covered(1000, 0);
+	const Tracer::Span * loop = nullptr;
+	for (const Tracer::Buffer & thread : threads) {
+		for (const Tracer::Span & span : thread.spans) {
+			if (span.name == "loop") {
+				loop = &span;
+				continue;
+			}
+			expect(span.name == "chunk" && std::string(span.category) == "chunk", "only the loop and its chunks should be traced");
+			int begin, end;
+			expect(std::sscanf(span.args.c_str(), "\"begin\": %d, \"end\": %d", &begin, &end) == 2, "a chunk should give its columns");
+			for (int i = begin; i < end; ++i) {
+				covered[i]++;
+			}
+			tids.insert(thread.tid);
+		}
+	}
+	expect(loop != nullptr && std::string(loop->category) == "phase", "the phase should be a span");
+	expect(covered == std::vector<int>(1000, 1), "the chunks should cover the loop once");
+	expect(tids.size() > 1, "the chunks should be spread over the threads");
+	for (const Tracer::Buffer & thread : threads) {
+		for (const Tracer::Span & span : thread.spans) {
+			expect(span.start >= loop->start && span.start + span.duration <= loop->start + loop->duration + 1.0, "the chunks should run within the loop");
+		}
+	}
+
+	{
+		TraceScope span("alignment", "alignment");
+		span.arg("file", "a \"quoted\" name");
+	}
+	Tracer::Get().write(TRACE);
+	std::string json = read_file(TRACE);
+	expect(json.compare(0, 17, "{\"traceEvents\": [") == 0 && json.find("\"displayTimeUnit\": \"ms\"}") != std::string::npos, "the trace should be a Chrome trace object");
+	expect(json.find("{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"thread 1\"}}") != std::string::npos, "the threads should be named");
+	expect(json.find("{\"name\": \"loop\", \"cat\": \"phase\", \"ph\": \"X\", \"ts\": ") != std::string::npos, "the phases should be complete events");
+	expect(json.find("\"args\": {\"file\": \"a \\\"quoted\\\" name\"}") != std::string::npos, "the details should be escaped");
+	size_t events = 0;
+	for (size_t pos = json.find("\"ph\": \"X\""); pos != std::string::npos; pos = json.find("\"ph\": \"X\"", pos + 1)) {
+		events++;
+	}
+	expect(events == count_spans(Tracer::Get().getBuffers()), "every span should be written");
+
+	Tracer::Get().clear();
+	expect(count_spans(Tracer::Get().getBuffers()) == 0, "clear() should forget the spans");
+}
+
+} // namespace
+
+int main()
+{
+	test_disabled();
+	test_nested_phases();
+	test_alignment_phases();
+	test_trace();
+	std::remove(JSON.c_str());
+	std::remove(TRACE.c_str());
+	std::cout << "All profile tests passed\n";
+	return 0;
+}
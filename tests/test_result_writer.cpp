@@ -0,0 +1,339 @@
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/result_writer.h"
+#include "../src/statistic.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Written by the test itself */
+const std::string FIXTURE = "tests/fixtures/jensen_tiny.fasta";
+const std::string TEXT    = "tests/fixtures/.result_writer_test.txt";
+const std::string BINARY  = "tests/fixtures/.result_writer_test.bin";
+const std::string NPY     = "tests/fixtures/.result_writer_test.npy";
+
+std::string read_file(const std::string & path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/* The numbers of a --format bin file, decoded byte by byte as a loader
+ * on any machine would (see BinaryWriter) */
+struct BinaryTable
+{
+	std::vector<std::string> names;
+	uint64_t nrow;
+	std::vector<float> values;
+};
+
+uint64_t read_le(const std::string & bytes, size_t pos, size_t size)
+{
+	uint64_t n = 0;
+	for (size_t i = 0; i < size; ++i) {
+		n |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[pos + i])) << (8 * i);
+	}
+	return n;
+}
+
+BinaryTable read_binary(const std::string & path)
+{
+	std::string bytes = read_file(path);
+	expect(bytes.size() >= 24 && bytes.compare(0, 4, "MSXB") == 0, "a binary result should start with MSXB");
+	expect(read_le(bytes, 4, 4) == 1, "the binary format version should be 1");
+	size_t offset = read_le(bytes, 8, 4);
+	size_t nfield = read_le(bytes, 12, 4);
+	BinaryTable table;
+	table.nrow = read_le(bytes, 16, 8);
+	expect(offset % 8 == 0, "the table should start at a multiple of 8 bytes");
+	expect(bytes.size() == offset + table.nrow * nfield * 4, "the file should end with the nrow x nfield table");
+	std::istringstream names(bytes.substr(24, bytes.find('\n', 24) - 24));
+	std::string name;
+	while (std::getline(names, name, '\t')) {
+		table.names.push_back(name);
+	}
+	expect(table.names.size() == nfield, "expected one name per field");
+	for (size_t pos = offset; pos < bytes.size(); pos += 4) {
+		uint32_t bits = static_cast<uint32_t>(read_le(bytes, pos, 4));
+		float x;
+		std::memcpy(&x, &bits, sizeof(x));
+		table.values.push_back(x);
+	}
+	return table;
+}
+
+/* The shape and the numbers of a --format npy file, read as numpy.load
+ * would */
+struct NpyArray
+{
+	unsigned long long nrow;
+	unsigned long long ncol;
+	std::vector<float> values;
+};
+
+NpyArray read_npy(const std::string & path)
+{
+	std::string bytes = read_file(path);
+	expect(bytes.size() >= 10 && bytes.compare(0, 8, std::string("\x93NUMPY\x01\x00", 8)) == 0, "a npy file should start with the magic string and version 1.0");
+	size_t offset = 10 + read_le(bytes, 8, 2);
+	expect(offset % 64 == 0 && bytes[offset - 1] == '\n', "the array should start at a multiple of 64 bytes, after a newline");
+	std::string dict = bytes.substr(10, offset - 10);
+	expect(dict.find("'descr': '<f4'") != std::string::npos && dict.find("'fortran_order': False") != std::string::npos, "the array should be little-endian float32 in C order");
+	NpyArray array;
+	size_t shape = dict.find("'shape': (");
+	expect(shape != std::string::npos && std::sscanf(dict.c_str() + shape, "'shape': (%llu, %llu)", &array.nrow, &array.ncol) == 2, "the shape should have two dimensions");
+	expect(bytes.size() == offset + array.nrow * array.ncol * 4, "the file should end with the array");
+	for (size_t pos = offset; pos < bytes.size(); pos += 4) {
+		uint32_t bits = static_cast<uint32_t>(read_le(bytes, pos, 4));
+		float x;
+		std::memcpy(&x, &bits, sizeof(x));
+		array.values.push_back(x);
+	}
+	return array;
+}
+
+void parse_test_options(const std::string & output, const std::vector<std::string> & extra)
+{
+	std::vector<std::string> args = {"mstatx", "-i", FIXTURE, "-o", output};
+	args.insert(args.end(), extra.begin(), extra.end());
+	parse_args(args);
+}
+
+/* Computes the statistics of -s on the fixture and prints them, the way
+ * main() does */
+void run_statistics(const std::string & output, const std::vector<std::string> & extra)
+{
+	parse_test_options(output, extra);
+	const std::vector<std::string> & names = Options::Get().statistics;
+	std::vector<std::unique_ptr<Statistic> > stats = make_stats(names);
+	Msa msa(FIXTURE);
+	for (auto & stat : stats) {
+		stat->calculate(msa);
+	}
+	PrintStatistics(msa, names, stats);
+}
+
+/* The text is the one of an ostream with its default format, for
+ * numbers of every magnitude, the special values included, across
+ * several flushes of the buffer */
+void test_text_matches_ostream()
+{
+	std::vector<float> floats = {0.0f, -0.0f, 1.0f, -1.5f, 0.1f, 1e-5f, 123456.0f, 1234567.0f, 1e30f, -3e-38f, 1e-42f,
+	                             FLT_MAX, FLT_MIN, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+	std::mt19937 rng(21);
+	std::uniform_real_distribution<float> mantissa(-10.0f, 10.0f);
+	std::uniform_int_distribution<int> exponent(-12, 12);
+	for (int i = 0; i < 300000; ++i) {
+		floats.push_back(mantissa(rng) * std::pow(10.0f, static_cast<float>(exponent(rng))));
+	}
+	std::vector<int> ints = {0, 1, -1, 9, 10, 12345, INT_MAX, INT_MIN};
+
+	std::ostringstream expected;
+	{
+		TextWriter file(TEXT);
+		for (size_t i = 0; i < floats.size(); ++i) {
+			file << static_cast<int>(i) + 1 << "\t" << floats[i] << "\n";
+			expected << static_cast<int>(i) + 1 << "\t" << floats[i] << "\n";
+		}
+		for (int n : ints) {
+			file << n << ' ' << std::string("x") << "\n";
+			expected << n << ' ' << std::string("x") << "\n";
+		}
+		std::string long_line(3 * TextWriter::SIZE, 'y');
+		file << long_line << "\n";
+		expected << long_line << "\n";
+		file.close();
+	}
+	expect(read_file(TEXT) == expected.str(), "TextWriter should print what an ofstream prints");
+}
+
+void test_binary_writer()
+{
+	{
+		BinaryWriter file(BINARY, {"a", "bc"}, 3);
+		for (float x : {1.0f, -2.0f, 0.5f, 1e-30f, 7.0f, -0.0f}) {
+			file.add(x);
+		}
+		file.close();
+	}
+	BinaryTable table = read_binary(BINARY);
+	expect(table.names == std::vector<std::string>({"a", "bc"}) && table.nrow == 3, "the header should hold the field names and the number of rows");
+	expect(table.values == std::vector<float>({1.0f, -2.0f, 0.5f, 1e-30f, 7.0f, -0.0f}), "the table should hold the floats, row after row");
+
+	bool threw = false;
+	try {
+		BinaryWriter file(BINARY, {"a"}, 2);
+		file.add(1.0f);
+		file.close();
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "an incomplete table should be reported");
+}
+
+/* put() pads as setw does, with the digits of precision() */
+void test_text_fixed_width()
+{
+	std::ostringstream expected;
+	{
+		TextWriter file(TEXT);
+		for (float x : {0.0f, 1.0f, -0.125f, 3.14159f, 1234.5f, 1e-7f, 1e12f}) {
+			file.put(x, 3, 10);
+			expected << std::setprecision(3) << std::setw(10) << x;
+		}
+		file.put(42, 10);
+		file.put(123456789, 4);
+		expected << std::setw(10) << 42 << std::setw(4) << 123456789;
+		file.close();
+	}
+	expect(read_file(TEXT) == expected.str(), "put() should print what setw and precision print");
+}
+
+void test_npy_writer()
+{
+	{
+		BinaryWriter file(NPY, {"a", "bc"}, 3, "npy");
+		for (float x : {1.0f, -2.0f, 0.5f, 1e-30f, 7.0f, -0.0f}) {
+			file.add(x);
+		}
+		file.close();
+	}
+	NpyArray array = read_npy(NPY);
+	expect(array.nrow == 3 && array.ncol == 2, "the shape should be (nrow, nfield)");
+	expect(array.values == std::vector<float>({1.0f, -2.0f, 0.5f, 1e-30f, 7.0f, -0.0f}), "the array should hold the floats, row after row");
+}
+
+/* --format bin holds the same floats as the text, for one statistic,
+ * for the shared table (with -g too) and for the pair matrix */
+void test_statistics_in_binary()
+{
+	AddAllStatistics();
+	run_statistics(TEXT, {"-s", "wentropy"});
+	std::vector<float> text = read_col_stat_file(TEXT);
+	run_statistics(BINARY, {"-s", "wentropy", "-F", "bin"});
+	BinaryTable table = read_binary(BINARY);
+	expect(table.names == std::vector<std::string>({"score"}) && table.nrow == text.size(), "one score per column");
+	for (size_t col = 0; col < text.size(); ++col) {
+		expect(almost_equal(table.values[col], text[col], 1e-5f), "the binary scores should be those of the text");
+	}
+
+	run_statistics(BINARY, {"-s", "wentropy,gap,mvector", "-F", "bin"});
+	table = read_binary(BINARY);
+	expect(table.names == std::vector<std::string>({"wentropy", "gap"}) && table.nrow == text.size(), "the shared table should have one field per Stat1D");
+	expect(almost_equal(table.values[0], text[0], 1e-5f), "the first field should be wentropy");
+	BinaryTable mvector = read_binary("tests/fixtures/.result_writer_test.mvector.bin");
+	expect(mvector.nrow == text.size() && mvector.names.size() == 20 && mvector.names[0] == "A", "mvector should write its K means per column");
+	std::remove("tests/fixtures/.result_writer_test.mvector.bin");
+
+	run_statistics(BINARY, {"-s", "wentropy,gap", "-F", "bin", "-g"});
+	table = read_binary(BINARY);
+	expect(table.nrow == 1 && table.values.size() == 2, "-g should write a single row");
+
+	run_statistics(TEXT, {"-s", "mi", "-P", "matrix"});
+	std::ifstream file(TEXT.c_str());
+	std::vector<float> matrix;
+	float x;
+	while (file >> x) {
+		matrix.push_back(x);
+	}
+	run_statistics(BINARY, {"-s", "mi", "-P", "matrix", "-F", "bin"});
+	table = read_binary(BINARY);
+	expect(table.nrow == 2 && table.names == std::vector<std::string>({"1", "2", "3"}), "the pair matrix should have L - 1 rows of L columns");
+	expect(table.values.size() == matrix.size(), "the binary matrix should have the scores of the text");
+	for (size_t i = 0; i < matrix.size(); ++i) {
+		expect(almost_equal(table.values[i], matrix[i], 1e-5f), "the binary matrix should have the scores of the text");
+	}
+
+	bool threw = false;
+	try {
+		run_statistics(BINARY, {"-s", "mi", "-F", "bin"});
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "the pair thresholds should be text only");
+}
+
+/* --format npy holds the floats of --format bin, the mvector means with
+ * the precision the text rounds to 3 digits */
+void test_statistics_in_npy()
+{
+	const std::string mvector_bin = "tests/fixtures/.result_writer_test.mvector.bin";
+	const std::string mvector_npy = "tests/fixtures/.result_writer_test.mvector.npy";
+	run_statistics(BINARY, {"-s", "wentropy,mvector", "-F", "bin"});
+	BinaryTable table = read_binary(BINARY);
+	BinaryTable means = read_binary(mvector_bin);
+	run_statistics(NPY, {"-s", "wentropy,mvector", "-F", "npy"});
+	NpyArray array = read_npy(NPY);
+	expect(array.nrow == table.nrow && array.ncol == 1 && array.values == table.values, "the npy table should be the binary one");
+	NpyArray mvector = read_npy(mvector_npy);
+	expect(mvector.nrow == means.nrow && mvector.ncol == means.names.size() && mvector.values == means.values, "the npy means should be the binary ones");
+
+	run_statistics(TEXT, {"-s", "mvector"});
+	std::ifstream file(TEXT.c_str());
+	std::string line;
+	std::getline(file, line);
+	expect(line.size() == 10 * (mvector.ncol + 1), "the text header should have one symbol per 10 characters");
+	for (size_t row = 0; row < mvector.nrow; ++row) {
+		int col;
+		expect(static_cast<bool>(file >> col) && col == static_cast<int>(row) + 1, "the text rows should be numbered from 1");
+		for (size_t k = 0; k < mvector.ncol; ++k) {
+			float x;
+			file >> x;
+			float mean = mvector.values[row * mvector.ncol + k];
+			expect(std::fabs(x - mean) <= 5e-3f * std::fabs(mean) + 1e-6f, "the text should round the means to 3 digits");
+		}
+	}
+
+	run_statistics(NPY, {"-s", "mi", "-P", "matrix", "-F", "npy"});
+	array = read_npy(NPY);
+	expect(array.nrow == 2 && array.ncol == 3, "the pair matrix should be (L - 1) x L");
+	std::remove(mvector_bin.c_str());
+	std::remove(mvector_npy.c_str());
+}
+
+void test_format_option_validation()
+{
+	bool threw = false;
+	try {
+		parse_test_options(TEXT, {"-F", "csv"});
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "an unknown output format should be rejected");
+}
+
+} // namespace
+
+int main()
+{
+	test_text_matches_ostream();
+	test_text_fixed_width();
+	test_binary_writer();
+	test_npy_writer();
+	test_statistics_in_binary();
+	test_statistics_in_npy();
+	test_format_option_validation();
+	std::remove(TEXT.c_str());
+	std::remove(BINARY.c_str());
+	std::remove(NPY.c_str());
+	std::cout << "All result writer tests passed\n";
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/sampling.h"
+#include "../src/statistic.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Written by the test itself: 200 sequences x 50 columns */
+const std::string INPUT  = "tests/fixtures/.sampling_test_input.fasta";
+const std::string OUTPUT = "tests/fixtures/.sampling_test_output.txt";
+const int NSEQ = 200;
+const int NCOL = 50;
+
+void parse_test_options(const std::string & tolerance, const std::string & nb_seq, const std::string & stat = "wentropy")
+{
+	parse_args({"mstatx", "-i", INPUT, "-o", OUTPUT, "-s", stat, "-e", tolerance, "-n", nb_seq});
+}
+
+/* wentropy of the sequences of the first n positions of the sample order */
+std::vector<float> wentropy_of_prefix(int n)
+{
+	std::vector<int> order = SampleOrder(NSEQ);
+	std::vector<int> sample(order.begin(), order.begin() + n);
+	std::sort(sample.begin(), sample.end());
+	Msa msa(INPUT, sample);
+	expect(msa.getNseq() == n, "a sample should read its sequences only");
+	std::unique_ptr<Statistic> stat(StatisticFactory::CreateByName("wentropy"));
+	stat->calculate(msa);
+	return dynamic_cast<Stat1D &>(*stat).getColStat();
+}
+
+/* The order is a permutation, the same at every call, and its
+ * prefixes are spread over the whole file, not its first records. */
+void test_sample_order_is_a_reproducible_permutation()
+{
+	std::vector<int> order = SampleOrder(1000);
+	expect(order == SampleOrder(1000), "the sample order should be reproducible");
+	std::vector<int> sorted = order;
+	std::sort(sorted.begin(), sorted.end());
+	for (int i = 0; i < 1000; ++i) {
+		expect(sorted[i] == i, "the sample order should be a permutation of the records");
+	}
+	int in_first_half = static_cast<int>(std::count_if(order.begin(), order.begin() + 500, [](int rec) {return rec < 500;}));
+	expect(in_first_half > 200 && in_first_half < 300, "about half of a sample of half the records should be in the first half of the file");
+}
+
+/* A large tolerance stops at the second sample (twice -n): the scores
+ * are those of that sample, and the errors the changes since the first */
+void test_sampling_stops_within_tolerance()
+{
+	parse_test_options("10", "20");
+	std::vector<std::unique_ptr<Statistic> > stats = make_stats({"wentropy"});
+	std::unique_ptr<Msa> msa = SampleAndCalculate(INPUT, stats);
+	expect(msa->getNseq() == 40, "sampling should stop at the second sample");
+
+	std::vector<float> first  = wentropy_of_prefix(20);
+	std::vector<float> second = wentropy_of_prefix(40);
+	const Stat1D & stat = dynamic_cast<const Stat1D &>(*stats[0]);
+	expect(stat.getColStat() == second, "scores should be those of the last sample");
+	expect(stat.getColError().size() == NCOL, "expected one error estimate per column");
+	for (int col = 0; col < NCOL; ++col) {
+		expect(stat.getColError()[col] == std::fabs(second[col] - first[col]), "the error should be the change since the previous sample");
+	}
+}
+
+/* A tolerance no sample reaches ends with every sequence: exact scores */
+void test_sampling_ends_with_the_whole_file()
+{
+	parse_test_options("0.000001", "30");
+	std::vector<std::unique_ptr<Statistic> > stats = make_stats({"wentropy"});
+	std::unique_ptr<Msa> msa = SampleAndCalculate(INPUT, stats);
+	expect(msa->getNseq() == NSEQ, "the last sample should hold every sequence");
+
+	parse_test_options("0", "1000");
+	Msa whole(INPUT);
+	std::unique_ptr<Statistic> expected(StatisticFactory::CreateByName("wentropy"));
+	expected->calculate(whole);
+	const Stat1D & stat = dynamic_cast<const Stat1D &>(*stats[0]);
+	expect(stat.getColStat() == dynamic_cast<Stat1D &>(*expected).getColStat(), "scores on every sequence should be the usual ones");
+	for (float error : stat.getColError()) {
+		expect(error == 0.0f, "scores on every sequence should have no error");
+	}
+}
+
+/* The error estimates are printed after the scores */
+void test_errors_are_printed()
+{
+	parse_test_options("10", "20", "wentropy,gap");
+	const std::vector<std::string> & names = Options::Get().statistics;
+	std::vector<std::unique_ptr<Statistic> > stats = make_stats(names);
+	std::unique_ptr<Msa> msa = SampleAndCalculate(INPUT, stats);
+	PrintStatistics(*msa, names, stats, OUTPUT);
+	std::ifstream file(OUTPUT.c_str());
+	std::string header;
+	std::getline(file, header);
+	expect(header == "#col\twentropy\twentropy_error\tgap\tgap_error", "the header should name the error columns");
+
+	stats[0]->write(*msa, OUTPUT);
+	std::ifstream single(OUTPUT.c_str());
+	int col;
+	float score, error;
+	single >> col >> score >> error;
+	expect(single.good() && col == 1, "a single statistic should print column, score and error");
+	std::remove(OUTPUT.c_str());
+}
+
+void test_tolerance_option_validation()
+{
+	bool threw = false;
+	try {
+		parse_test_options("-0.1", "20");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "a negative tolerance should be rejected");
+}
+
+} // namespace
+
+int main()
+{
+	AddAllStatistics();
+	write_random_alignment(INPUT, NSEQ, NCOL, "ARNDCQEGHILKMFPSTWYV--", 3);
+	test_sample_order_is_a_reproducible_permutation();
+	test_sampling_stops_within_tolerance();
+	test_sampling_ends_with_the_whole_file();
+	test_errors_are_printed();
+	test_tolerance_option_validation();
+	std::remove(INPUT.c_str());
+	std::cout << "All sampling tests passed\n";
+	return 0;
+}
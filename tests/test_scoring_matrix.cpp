@@ -1,5 +1,9 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <stdexcept>
 
 #include "../src/scoring_matrix.h"
@@ -172,6 +176,141 @@ void test_scoring_matrix_unknown_symbol_throws()
 	expect(threw, "normScore() on a symbol outside the alphabet should throw, not read out of bounds");
 }
 
+/* getNormVector(a) is the whole vector X_a of normScore(., a), as one
+ * 32-byte aligned row padded with zeros up to getStride() floats. */
+void test_scoring_matrix_norm_vectors()
+{
+	parse_test_options();
+	ScoringMatrix sm("tests/fixtures/tiny_scoring_matrix.mat");
+	const std::string alphabet = sm.getAlphabet();
+
+	expect(sm.getStride() == 8, "3 symbols should be padded to a row of 8 floats");
+	for (int a = 0; a < sm.getAlphabetSize(); ++a) {
+		const float * X = sm.getNormVector(a);
+		expect(reinterpret_cast<uintptr_t>(X) % 32 == 0, "each row should be 32-byte aligned");
+		for (int b = 0; b < sm.getAlphabetSize(); ++b) {
+			expect(X[b] == sm.normScore(alphabet[b], alphabet[a]), "the row should hold normScore(b, a)");
+		}
+		for (int b = sm.getAlphabetSize(); b < sm.getStride(); ++b) {
+			expect(X[b] == 0.0f, "the padding should be 0");
+		}
+	}
+}
+
+/* lookupScore() and lookupNormScore() read the symbols themselves,
+ * without check: the same values as score() and normScore(), in either
+ * order, and 0 (instead of an exception) out of the alphabet. */
+void test_scoring_matrix_lookup_tables()
+{
+	parse_test_options();
+	ScoringMatrix sm("tests/fixtures/tiny_scoring_matrix.mat");
+	const std::string alphabet = sm.getAlphabet();
+
+	for (char a : alphabet) {
+		for (char b : alphabet) {
+			expect(sm.lookupScore(a, b) == sm.score(a, b), "lookupScore() should match score()");
+			expect(sm.lookupScore(a, b) == sm.lookupScore(b, a), "lookupScore() should be symmetric");
+			expect(sm.lookupNormScore(a, b) == sm.normScore(a, b), "lookupNormScore() should match normScore()");
+		}
+	}
+	expect(almost_equal(sm.lookupScore('C', 'A'), -1.0f), "C-A score should be -1.0");
+	expect(sm.lookupScore('A', 'Z') == 0.0f && sm.lookupNormScore('-', 'B') == 0.0f, "symbols out of the alphabet should score 0");
+	expect(sm.lookupScore(0xff, 0xff) == 0.0f, "every byte should be in the table");
+}
+
+/* The built-in matrices are the bundled files they were copied from,
+ * and are found by name, before any file: no file is read. */
+void test_scoring_matrix_builtin_matrices_match_their_files()
+{
+	parse_test_options();
+	const std::pair<std::string, std::string> builtins[] = {
+		{"HENS920101", "data/aaindex/HENS920101.mat"},
+		{"HENS920102", "data/aaindex/HENS920102.mat"},
+		{"HENS920103", "data/aaindex/HENS920103.mat"},
+		{"HENS920104", "data/aaindex/HENS920104.mat"},
+		{"DNA", "data/DNA.mat"},
+		{"RNA", "data/RNA.mat"}
+	};
+	for (const auto & builtin : builtins) {
+		ScoringMatrix named(builtin.first);
+		ScoringMatrix file(builtin.second);
+		const std::string alphabet = file.getAlphabet();
+		expect(named.getAlphabet() == alphabet, builtin.first + " should have the alphabet of its file");
+		expect(named.getMin() == file.getMin() && named.getMax() == file.getMax(), builtin.first + " should have the range of its file");
+		for (char a : alphabet) {
+			for (char b : alphabet) {
+				expect(named.score(a, b) == file.score(a, b), builtin.first + " should hold the values of its file");
+			}
+		}
+	}
+	expect(ScoringMatrix::Stride(20) == 24 && ScoringMatrix::Stride(6) == 8, "rows should be rounded up to 8 floats");
+}
+
+/* -m ACCESSION reads only that entry of the AAindex2 database of -D,
+ * found through the index written next to it (DATABASE.idx), which is
+ * built again when the database changes. */
+void test_scoring_matrix_reads_accessions_through_the_index()
+{
+	const std::string database = "tests/fixtures/.aaindex_test_db.txt";
+	const std::string index = database + ".idx";
+	char *argv[] = {
+		const_cast<char*>("mstatx"),
+		const_cast<char*>("-i"), const_cast<char*>("tests/fixtures/jensen_tiny.fasta"),
+		const_cast<char*>("-D"), const_cast<char*>(database.c_str())
+	};
+	Options::Parse(sizeof(argv) / sizeof(argv[0]), argv);
+	std::remove(index.c_str());
+	{
+		std::ofstream file(database.c_str());
+		file << "H FIRST01\nD The first one\nM rows = AB, cols = AB\n 1.\n 2. 3.\n//\n"
+		     << "H SECOND01\nD The second one, with a wrapped\nM.O. header line\nM rows = ABC, cols = ABC\n 5.\n 2. 4.\n -1. 0. 3.\n//\n";
+	}
+	ScoringMatrix second("SECOND01");
+	expect(second.getAlphabet() == "ABC" && almost_equal(second.score('C', 'A'), -1.0f), "the entry of the accession should be read");
+	expect(std::ifstream(index.c_str()).good(), "the index should be written next to the database");
+	ScoringMatrix first("FIRST01");
+	expect(first.getAlphabet() == "AB" && almost_equal(first.score('B', 'B'), 3.0f), "every entry should be indexed");
+
+	{
+		std::ofstream file(database.c_str(), std::ios::app);
+		file << "H THIRD01\nM rows = A, cols = A\n 7.\n//\n";
+	}
+	ScoringMatrix third("THIRD01");
+	expect(almost_equal(third.score('A', 'A'), 7.0f), "a modified database should be indexed again");
+
+	bool threw = false;
+	try {
+		ScoringMatrix none("NONE01");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "an unknown accession should throw");
+	std::remove(index.c_str());
+	std::remove(database.c_str());
+}
+
+/* Get() reads a matrix file once: later calls, for the same file,
+ * share the same object, and another file gives another matrix. */
+void test_scoring_matrix_get_shares_one_copy()
+{
+	parse_test_options();
+	const ScoringMatrix & first  = ScoringMatrix::Get("tests/fixtures/tiny_scoring_matrix.mat");
+	const ScoringMatrix & second = ScoringMatrix::Get("tests/fixtures/tiny_scoring_matrix.mat");
+	const ScoringMatrix & other  = ScoringMatrix::Get("data/aaindex/HENS920102.mat");
+
+	expect(&first == &second, "the same file should give the same matrix object");
+	expect(&first != &other, "another file should give another matrix");
+	expect(almost_equal(first.score('A', 'B'), 2.0f), "the shared matrix should hold the file values");
+
+	bool threw = false;
+	try {
+		ScoringMatrix::Get("tests/fixtures/does_not_exist.mat");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "Get() of a nonexistent file should throw like the constructor");
+}
+
 } // namespace
 
 int main()
@@ -182,6 +321,11 @@ int main()
 	test_scoring_matrix_nonexistent_file_throws();
 	test_scoring_matrix_malformed_row_throws();
 	test_scoring_matrix_unknown_symbol_throws();
+	test_scoring_matrix_get_shares_one_copy();
+	test_scoring_matrix_norm_vectors();
+	test_scoring_matrix_lookup_tables();
+	test_scoring_matrix_builtin_matrices_match_their_files();
+	test_scoring_matrix_reads_accessions_through_the_index();
 	std::cout << "All scoring_matrix tests passed\n";
 	return 0;
 }
@@ -0,0 +1,265 @@
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/statistic.h"
+#include "test_helpers.h"
+
+namespace {
+
+const std::string FIXTURE     = "tests/fixtures/jensen_tiny.fasta";
+const std::string OUTPUT_FILE = "tests/fixtures/.statistic_test_output.txt";
+const std::string SINGLE_FILE = "tests/fixtures/.statistic_test_single.txt";
+const std::string MATRIX      = "data/aaindex/HENS920102.mat";
+
+void parse_test_options(const std::string & stats, const std::string & output, bool global)
+{
+	std::vector<std::string> args = {"mstatx", "-i", FIXTURE, "-m", MATRIX, "-s", stats, "-o", output};
+	if (global) {
+		args.push_back("-g");
+	}
+	parse_args(args);
+}
+
+/* Computes the statistics of the -s list on one Msa and prints them
+ * with PrintStatistics(), the way main() does. */
+void run_statistics()
+{
+	const std::vector<std::string> & names = Options::Get().statistics;
+	std::vector<std::unique_ptr<Statistic> > stats = make_stats(names);
+	Msa msa(FIXTURE);
+	for (auto & stat : stats) {
+		stat->calculate(msa);
+	}
+	PrintStatistics(msa, names, stats);
+}
+
+std::vector<float> run_single(const std::string & name)
+{
+	parse_test_options(name, SINGLE_FILE, false);
+	run_statistics();
+	return read_col_stat_file(SINGLE_FILE);
+}
+
+/* Several statistics computed on the same Msa must give, column by
+ * column, exactly what each one gives when run alone: in particular
+ * trident and mvector must not leave the alignment modified for the
+ * statistics computed after them. */
+void test_several_statistics_share_one_table()
+{
+	AddAllStatistics();
+	std::vector<float> wentropy = run_single("wentropy");
+	std::vector<float> trident  = run_single("trident");
+	std::vector<float> gap      = run_single("gap");
+
+	parse_test_options("trident,mvector,wentropy,gap", OUTPUT_FILE, false);
+	run_statistics();
+
+	std::ifstream file(OUTPUT_FILE.c_str());
+	std::string header;
+	std::getline(file, header);
+	expect(header == "#col\ttrident\twentropy\tgap", "header should name the Stat1D columns in -s order");
+	int col;
+	float t, w, g;
+	int nb_lines = 0;
+	while (file >> col >> t >> w >> g) {
+		expect(col == nb_lines + 1, "lines should be numbered from column 1");
+		expect(t == trident[nb_lines], "trident column should match a trident-only run");
+		expect(w == wentropy[nb_lines], "wentropy column should match a wentropy-only run");
+		expect(g == gap[nb_lines], "gap column should match a gap-only run");
+		nb_lines++;
+	}
+	expect(nb_lines == 3, "expected one line per alignment column");
+
+	/* mvector is one vector per column: printed in its own file */
+	std::ifstream mvector_file("tests/fixtures/.statistic_test_output.mvector.txt");
+	expect(mvector_file.is_open(), "mvector should be printed in <output>.mvector.<ext>");
+}
+
+void test_several_statistics_global_mode()
+{
+	AddAllStatistics();
+	parse_test_options("gap,kabat", OUTPUT_FILE, true);
+	run_statistics();
+
+	std::ifstream file(OUTPUT_FILE.c_str());
+	std::string header;
+	std::getline(file, header);
+	expect(header == "#gap\tkabat", "global header should name the statistics");
+	float gap, kabat;
+	expect(bool(file >> gap >> kabat), "expected one global score per statistic");
+	/* jensen_tiny.fasta: one gap out of 12 symbols */
+	expect(almost_equal(gap, 1.0f / 12.0f), "gap global score should be the mean gap fraction");
+}
+
+/* A column statistic with the given scores, whatever the alignment */
+class FixedStat : public Stat1D
+{
+public:
+	explicit FixedStat(const std::vector<float> & scores) {col_stat = scores;}
+};
+
+std::vector<float> write_smoothed(const std::vector<float> & scores, const std::vector<std::string> & options)
+{
+	std::vector<std::string> args = {"mstatx", "-i", FIXTURE, "-o", OUTPUT_FILE};
+	args.insert(args.end(), options.begin(), options.end());
+	parse_args(args);
+	Msa msa(FIXTURE);
+	FixedStat stat(scores);
+	stat.print(msa);
+	return Options::Get().global ? std::vector<float>(1, read_global_stat_file(OUTPUT_FILE)) : read_col_stat_file(OUTPUT_FILE);
+}
+
+/* The definition, window after window */
+std::vector<float> reference_smoothing(const std::vector<float> & scores, const std::string & smooth, int w)
+{
+	int L = static_cast<int>(scores.size());
+	std::vector<float> smoothed(L);
+	for (int x = 0; x < L; ++x) {
+		double window = 0.0, sides = 0.0;
+		int nb_window = 0, nb_sides = 0;
+		for (int i = x - w; i <= x + w; ++i) {
+			if (i >= 0 && i < L) {
+				window += scores[i];
+				nb_window++;
+				if (i != x) {
+					sides += scores[i];
+					nb_sides++;
+				}
+			}
+		}
+		smoothed[x] = smooth == "mean" ? window / nb_window : 0.5 * scores[x] + 0.5 * (nb_sides ? sides / nb_sides : scores[x]);
+	}
+	return smoothed;
+}
+
+/* Scores 1 2 3 4 10, one side column (-w 1):
+ *   mean:  1.5 2 3 17/3 7
+ *   capra: 1.5 2 3 5.25 7 (half the column, half the mean of its sides) */
+void test_smoothing()
+{
+	const std::vector<float> scores = {1, 2, 3, 4, 10};
+	std::vector<float> mean = write_smoothed(scores, {"-S", "mean", "-w", "1"});
+	std::vector<float> capra = write_smoothed(scores, {"-S", "capra", "-w", "1"});
+	expect(write_smoothed(scores, {"-w", "1"}) == scores, "--smooth none should print the scores unchanged");
+	expect(mean.size() == 5 && almost_equal(mean[0], 1.5f) && almost_equal(mean[1], 2.0f) && almost_equal(mean[3], 17.0f / 3) && almost_equal(mean[4], 7.0f),
+	       "--smooth mean should print the mean of the window, cut at the ends");
+	expect(capra.size() == 5 && almost_equal(capra[0], 1.5f) && almost_equal(capra[2], 3.0f) && almost_equal(capra[3], 5.25f) && almost_equal(capra[4], 7.0f),
+	       "--smooth capra should print half the score plus half the mean of the side columns");
+	std::vector<float> global = write_smoothed(scores, {"-S", "mean", "-w", "1", "-g"});
+	expect(almost_equal(global[0], (1.5f + 2 + 3 + 17.0f / 3 + 7) / 5), "-g should print the mean of the smoothed scores");
+
+	/* Prefix sums against the definition, windows from none to wider
+	 * than the alignment */
+	std::vector<float> random(200);
+	for (size_t x = 0; x < random.size(); ++x) {
+		random[x] = static_cast<float>((x * 7919) % 101) / 10.0f - 3.0f;
+	}
+	for (const std::string smooth : {"mean", "capra"}) {
+		for (int w : {0, 1, 4, 50, 300}) {
+			std::vector<float> values = write_smoothed(random, {"-S", smooth, "-w", std::to_string(w)});
+			std::vector<float> expected = reference_smoothing(random, smooth, w);
+			expect(values.size() == expected.size(), "expected one smoothed score per column");
+			for (size_t x = 0; x < values.size(); ++x) {
+				expect(almost_equal(values[x], expected[x], 1e-4f), "--smooth " + smooth + " -w " + std::to_string(w) + " should match the definition");
+			}
+		}
+	}
+}
+
+void test_smoothing_options_validation()
+{
+	for (const std::vector<std::string> & options : std::vector<std::vector<std::string> >{{"-S", "median"}, {"-S", "mean", "-w", "-1"}}) {
+		bool threw = false;
+		try {
+			write_smoothed({1, 2, 3}, options);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		expect(threw, "invalid smoothing options should be rejected: " + options.back());
+	}
+}
+
+/* A pair statistic scoring (x, y) with x + y / 10, rows checked to come
+ * in order */
+class SumStat : public Stat2D
+{
+public:
+	void forEachRow(Msa & msa, const std::function<void(int, const std::vector<float> &)> & row) override
+	{
+		int L = msa.getNcol();
+		std::vector<float> scores(L, -1.0f);
+		for (int x = 0; x + 1 < L; ++x) {
+			for (int y = x + 1; y < L; ++y) {
+				scores[y] = x + y / 10.0f;
+			}
+			row(x, scores);
+		}
+	}
+};
+
+std::vector<std::string> write_pairs(const std::vector<std::string> & options)
+{
+	std::vector<std::string> args = {"mstatx", "-i", FIXTURE, "-o", OUTPUT_FILE};
+	args.insert(args.end(), options.begin(), options.end());
+	parse_args(args);
+	Msa msa(FIXTURE);
+	SumStat stat;
+	stat.print(msa);
+	std::ifstream file(OUTPUT_FILE.c_str());
+	std::vector<std::string> lines;
+	std::string line;
+	while (std::getline(file, line)) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+/* jensen_tiny.fasta has 3 columns: pairs (1,2) 0.1, (1,3) 0.2, (2,3) 1.2 */
+void test_pair_outputs()
+{
+	std::vector<std::string> lines = write_pairs({"-t", "0.2"});
+	expect(lines == std::vector<std::string>({"1\t3\t0.2", "2\t3\t1.2"}), "threshold output should list the pairs scoring -t or more");
+
+	lines = write_pairs({"-P", "top", "-K", "1"});
+	expect(lines == std::vector<std::string>({"1\t3\t0.2", "2\t3\t1.2", "3\t2\t1.2"}), "top output should list the best pair of each column");
+
+	lines = write_pairs({"-P", "top", "-K", "5"});
+	expect(lines.size() == 6 && lines[0] == "1\t3\t0.2" && lines[1] == "1\t2\t0.1", "top output should list at most the L - 1 pairs of each column, best first");
+
+	lines = write_pairs({"-P", "matrix"});
+	expect(lines == std::vector<std::string>({"0\t0.1\t0.2\t", "0\t0\t1.2\t"}), "matrix output should print the upper triangle");
+}
+
+void test_pair_options_validation()
+{
+	for (const std::vector<std::string> & options : std::vector<std::vector<std::string> >{{"-P", "dense"}, {"-P", "top", "-K", "0"}}) {
+		bool threw = false;
+		try {
+			write_pairs(options);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		expect(threw, "invalid pair output options should be rejected: " + options[1]);
+	}
+}
+
+} // namespace
+
+int main()
+{
+	test_several_statistics_share_one_table();
+	test_several_statistics_global_mode();
+	test_pair_outputs();
+	test_pair_options_validation();
+	test_smoothing();
+	test_smoothing_options_validation();
+	std::cout << "All statistic tests passed\n";
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/options.h"
+#include "../src/scoring_matrix.h"
+#include "../src/statistic.h"
+#include "../src/sumofpairs.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Written by the test itself */
+const std::string SMALL  = "tests/fixtures/.sumofpairs_test_small.fasta";
+const std::string RANDOM = "tests/fixtures/.sumofpairs_test_random.fasta";
+const std::string OUTPUT = "tests/fixtures/.sumofpairs_test_output.txt";
+
+void parse_test_options(const std::string & input, const std::vector<std::string> & extra)
+{
+	std::vector<std::string> args = {"mstatx", "-i", input, "-o", OUTPUT, "-s", "sumofpairs"};
+	args.insert(args.end(), extra.begin(), extra.end());
+	parse_args(args);
+}
+
+/*   col 0: AAAA  col 1: AAAC  col 2: AA-C */
+void write_small_alignment()
+{
+	std::ofstream file(SMALL.c_str());
+	file << ">s1\nAAA\n>s2\nAAA\n>s3\nAA-\n>s4\nACC\n";
+}
+
+/* Random symbols, a few unknown to the matrix (X, B) and gaps, the
+ * columns drawing from alphabets of 3 to 22 symbols */
+void write_column_alphabets_alignment(int nseq, int ncol)
+{
+	const std::string symbols = "ARNDCQEGHILKMFPSTWYVXB-";
+	std::vector<std::string> seqs = random_sequences(nseq, ncol, symbols, 19);
+	for (std::string & seq : seqs) {
+		for (size_t j = 0; j < seq.size(); ++j) {
+			seq[j] = symbols[symbols.find(seq[j]) % (j % 20 + 3)];
+		}
+	}
+	write_fasta(RANDOM, seqs);
+}
+
+std::vector<float> calculate_and_read(Msa & msa)
+{
+	SumOfPairsStat stat;
+	stat.calculate(msa);
+	stat.print(msa);
+	return test_helpers::read_col_stat_file(OUTPUT);
+}
+
+/* The definition: every pair of distinct sequences, O(N^2) per column */
+std::vector<double> reference_sum_of_pairs(Msa & msa)
+{
+	const ScoringMatrix & sm = ScoringMatrix::Get(Options::Get().matrix_fname);
+	const std::string alphabet = sm.getAlphabet();
+	const std::vector<float> & w = msa.getSeqWeights();
+	std::vector<double> sp(msa.getNcol(), 0.0);
+	for (int x = 0; x < msa.getNcol(); ++x) {
+		double total = 0.0, pairs = 0.0;
+		for (int i = 0; i < msa.getNseq(); ++i) {
+			for (int j = 0; j < msa.getNseq(); ++j) {
+				if (i == j) {
+					continue;
+				}
+				char a = msa.getSymbol(i, x), b = msa.getSymbol(j, x);
+				double weight = static_cast<double>(w[i]) * w[j];
+				if (alphabet.find(a) != std::string::npos && alphabet.find(b) != std::string::npos) {
+					total += weight * sm.score(a, b);
+				}
+				pairs += weight;
+			}
+		}
+		sp[x] = total / pairs;
+	}
+	return sp;
+}
+
+/* Unweighted, 12 ordered pairs of distinct sequences per column:
+ *   col 0: 12 A/A
+ *   col 1: 6 A/A, 6 A/C
+ *   col 2: 2 A/A, 4 A/C, 6 with the gap (scoring 0) */
+void test_small_alignment()
+{
+	parse_test_options(SMALL, {"-W", "none"});
+	Msa msa(SMALL);
+	const ScoringMatrix & sm = ScoringMatrix::Get(Options::Get().matrix_fname);
+	float aa = sm.score('A', 'A'), ac = sm.score('A', 'C');
+	std::vector<float> values = calculate_and_read(msa);
+	expect(values.size() == 3, "expected one score per column");
+	expect(test_helpers::almost_equal(values[0], aa), "a conserved column should score M(A,A)");
+	expect(test_helpers::almost_equal(values[1], (6 * aa + 6 * ac) / 12), "column 1: (6 M(A,A) + 6 M(A,C)) / 12");
+	expect(test_helpers::almost_equal(values[2], (2 * aa + 4 * ac) / 12), "column 2: the pairs with a gap should dilute the score");
+
+	parse_test_options(SMALL, {"-W", "none", "-g"});
+	Msa global(SMALL);
+	calculate_and_read(global);
+	expect(test_helpers::almost_equal(test_helpers::read_global_stat_file(OUTPUT), (values[0] + values[1] + values[2]) / 3),
+	       "--global should output the mean of the column scores");
+}
+
+/* The counts give the scores of the definition, with every weighting
+ * and number of threads */
+void test_random_alignment_matches_the_definition()
+{
+	write_column_alphabets_alignment(120, 60);
+	for (const std::string weights : {"none", "henikoff", "identity"}) {
+		for (const std::string threads : {"1", "3"}) {
+			parse_test_options(RANDOM, {"-W", weights, "-I", "0.2", "-j", threads});
+			Msa msa(RANDOM);
+			std::vector<double> expected = reference_sum_of_pairs(msa);
+			std::vector<float> values = calculate_and_read(msa);
+			expect(values.size() == expected.size(), "expected one score per column");
+			for (size_t x = 0; x < values.size(); ++x) {
+				expect(test_helpers::almost_equal(values[x], static_cast<float>(expected[x]), 1e-4f),
+				       "the sum of pairs should match the definition (-W " + weights + ", -j " + threads + ")");
+			}
+		}
+	}
+}
+
+void test_registered_in_the_factory()
+{
+	AddAllStatistics();
+	std::unique_ptr<Statistic> stat(StatisticFactory::CreateByName("sumofpairs"));
+	expect(dynamic_cast<SumOfPairsStat *>(stat.get()) != nullptr, "\"sumofpairs\" should produce a SumOfPairsStat");
+}
+
+} // namespace
+
+int main()
+{
+	write_small_alignment();
+	test_small_alignment();
+	test_random_alignment_matches_the_definition();
+	test_registered_in_the_factory();
+	std::remove(SMALL.c_str());
+	std::remove(RANDOM.c_str());
+	std::remove(OUTPUT.c_str());
+	std::cout << "All sumofpairs tests passed\n";
+	return 0;
+}
@@ -0,0 +1,173 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/msa.h"
+#include "../src/mvector.h"
+#include "../src/options.h"
+#include "../src/statistic.h"
+#include "../src/thread_pool.h"
+#include "test_helpers.h"
+
+namespace {
+
+/* Written by the test itself: 60 sequences x 700 columns, enough
+ * columns for every thread to get several chunks. */
+const std::string INPUT  = "tests/fixtures/.thread_pool_test_input.fasta";
+const std::string MATRIX = "data/aaindex/HENS920102.mat";
+
+void parse_test_options(const std::string & threads)
+{
+	parse_args({"mstatx", "-i", INPUT, "-m", MATRIX, "-j", threads});
+}
+
+/* Every index of the range is given to the body exactly once, for any
+ * number of threads, including more threads than indices. */
+void test_parallel_for_covers_range_once()
+{
+	for (int nthreads : {1, 2, 3, 8}) {
+		for (int n : {0, 1, 5, 1000}) {
+			std::vector<std::atomic<int> > seen(n);
+			for (auto & s : seen) {
+				s = 0;
+			}
+			ThreadPool::Get().parallelFor(0, n, nthreads, [&](int b, int e) {
+				expect(b < e, "chunks should not be empty");
+				for (int i = b; i < e; ++i) {
+					seen[i]++;
+				}
+			});
+			for (int i = 0; i < n; ++i) {
+				expect(seen[i] == 1, "every index should be processed exactly once");
+			}
+		}
+	}
+}
+
+/* A range shorter than the number of threads runs on one thread per
+ * index, without stopping the workers of the longer loops */
+void test_short_range_keeps_the_workers()
+{
+	ThreadPool::Get().parallelFor(0, 1000, 5, [](int, int) {});
+	int nworkers = ThreadPool::Get().size();
+	expect(nworkers >= 4, "a loop on 5 threads should start 4 workers");
+
+	std::mutex mtx;
+	std::set<std::thread::id> threads;
+	ThreadPool::Get().parallelFor(0, 2, 5, [&](int, int) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		std::lock_guard<std::mutex> lock(mtx);
+		threads.insert(std::this_thread::get_id());
+	});
+	expect(threads.size() <= 2, "a range of 2 indices should run on 2 threads at most");
+	expect(ThreadPool::Get().size() == nworkers, "a short range should not stop or start workers");
+
+	std::atomic<int> count(0);
+	ThreadPool::Get().parallelFor(0, 1000, 5, [&](int b, int e) { count += e - b; });
+	expect(count == 1000 && ThreadPool::Get().size() == nworkers, "the workers left asleep should still run the next loops");
+}
+
+/* A parallelFor() inside a loop body runs inline instead of waiting
+ * for the workers already busy with the outer loop. */
+void test_nested_parallel_for_runs_inline()
+{
+	std::atomic<int> total(0);
+	ThreadPool::Get().parallelFor(0, 16, 4, [&](int b, int e) {
+		for (int i = b; i < e; ++i) {
+			ThreadPool::Get().parallelFor(0, 10, 4, [&](int b2, int e2) {
+				total += e2 - b2;
+			});
+		}
+	});
+	expect(total == 160, "nested loops should process all 16 x 10 indices");
+}
+
+void test_exception_reaches_caller()
+{
+	bool threw = false;
+	try {
+		ThreadPool::Get().parallelFor(0, 100, 4, [](int b, int e) {
+			if (b <= 50 && 50 < e) {
+				throw std::runtime_error("column 50");
+			}
+		});
+	} catch (const std::runtime_error & e) {
+		threw = std::string(e.what()) == "column 50";
+	}
+	expect(threw, "an exception thrown by the body should be rethrown by parallelFor");
+
+	/* The pool must still work afterwards */
+	std::atomic<int> count(0);
+	ThreadPool::Get().parallelFor(0, 100, 4, [&](int b, int e) { count += e - b; });
+	expect(count == 100, "the pool should still run loops after an exception");
+}
+
+/* Runs every statistic of -s with -j threads on a fresh Msa. */
+std::vector<std::vector<float> > run_all(const std::string & threads)
+{
+	parse_test_options(threads);
+	Msa msa(INPUT);
+	std::vector<std::vector<float> > results;
+	for (const char * name : {"wentropy", "trident", "jensen", "kabat", "gap"}) {
+		std::unique_ptr<Statistic> stat(StatisticFactory::CreateByName(name));
+		stat->calculate(msa);
+		results.push_back(dynamic_cast<Stat1D &>(*stat).getColStat());
+	}
+	MVectStat mvector;
+	mvector.calculate(msa);
+	for (const auto & mean : mvector.getMeans()) {
+		results.push_back(mean);
+	}
+	return results;
+}
+
+/* The number of threads must not change a single bit of the results */
+void test_statistics_do_not_depend_on_threads()
+{
+	AddAllStatistics();
+	write_random_alignment(INPUT, 60, 700, "ARNDCQEGHILKMFPSTWYVX--", 7);
+	std::vector<std::vector<float> > one = run_all("1");
+	expect(one[0].size() == 700, "expected one score per column");
+	for (const std::string threads : {"2", "4", "7"}) {
+		std::vector<std::vector<float> > several = run_all(threads);
+		expect(several == one, "results with -j " + threads + " should be identical to -j 1");
+	}
+	std::remove(INPUT.c_str());
+}
+
+void test_threads_option_validation()
+{
+	char *argv[] = {const_cast<char*>("mstatx"), const_cast<char*>("-i"), const_cast<char*>(INPUT.c_str())};
+	Options::Parse(sizeof(argv) / sizeof(argv[0]), argv);
+	expect(Options::Get().threads == 1, "default should be a single thread");
+
+	bool threw = false;
+	try {
+		parse_test_options("0");
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	expect(threw, "-j 0 should be rejected");
+}
+
+} // namespace
+
+int main()
+{
+	test_parallel_for_covers_range_once();
+	test_short_range_keeps_the_workers();
+	test_nested_parallel_for_runs_inline();
+	test_exception_reaches_caller();
+	test_statistics_do_not_depend_on_threads();
+	test_threads_option_validation();
+	std::cout << "All thread pool tests passed\n";
+	return 0;
+}